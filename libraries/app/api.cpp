@@ -1,6 +1,7 @@
 /*
  * Acloudbank
  */
+#include <algorithm>
 #include <cctype>
 
 #include <graphene/app/api.hpp>
@@ -8,6 +9,9 @@
 
 #include "database_api_helper.hxx"
 
+#include <graphene/account_history/account_history_plugin.hpp>
+#include <graphene/account_history/account_history_store.hpp>
+
 #include <fc/crypto/base64.hpp>
 #include <fc/rpc/api_connection.hpp>
 #include <fc/thread/future.hpp>
@@ -220,6 +224,21 @@ namespace graphene { namespace app {
        return _app.p2p_node()->set_advanced_node_parameters(params);
     }
 
+    protocol::signature_cache_stats network_node_api::get_signature_cache_stats() const
+    {
+       return protocol::signature_cache::instance().get_stats();
+    }
+
+    graphene::db::undo_history_stats network_node_api::get_undo_history_stats() const
+    {
+       return _app.chain_database()->get_undo_history_stats();
+    }
+
+    graphene::chain::database::object_notification_stats network_node_api::get_object_notification_stats() const
+    {
+       return _app.chain_database()->get_object_notification_stats();
+    }
+
     fc::api<network_broadcast_api> login_api::network_broadcast()
     {
        bool is_allowed = ( _allowed_apis.find("network_broadcast_api") != _allowed_apis.end() );
@@ -351,6 +370,23 @@ namespace graphene { namespace app {
     { // Nothing else to do
     }
 
+    const account_history::account_history_store* history_api::get_account_history_store()const
+    {
+       if( !_app.is_plugin_enabled( "account_history" ) )
+          return nullptr;
+       auto plugin = _app.get_plugin<account_history::account_history_plugin>( "account_history" );
+       return plugin ? plugin->history_store() : nullptr;
+    }
+
+    const account_history::account_history_by_operation_index* history_api::get_account_history_by_operation_index()
+          const
+    {
+       if( !_app.is_plugin_enabled( "account_history" ) )
+          return nullptr;
+       auto plugin = _app.get_plugin<account_history::account_history_plugin>( "account_history" );
+       return plugin ? plugin->history_by_operation_index() : nullptr;
+    }
+
     vector<order_history_object> history_api::get_fill_order_history( const std::string& asset_a,
                                                                       const std::string& asset_b,
                                                                       uint32_t limit )const
@@ -419,6 +455,10 @@ namespace graphene { namespace app {
           }
        }
 
+       const auto* store = get_account_history_store();
+       if( store != nullptr )
+          return store->get_account_history( account, stop, limit, start );
+
        const auto& by_op_idx = db.get_index_type<account_history_index>().indices().get<by_op>();
        auto itr = by_op_idx.lower_bound( boost::make_tuple( account, start ) );
        auto itr_end = by_op_idx.lower_bound( boost::make_tuple( account, stop ) );
@@ -501,6 +541,32 @@ namespace graphene { namespace app {
           database_api_helper db_api_helper( _app );
           account = db_api_helper.get_account_from_string(account_id_or_name)->get_id();
        } catch(...) { return result; }
+
+       const auto* store = get_account_history_store();
+       if( store != nullptr )
+          return store->get_account_history_operations( account, operation_type, start, stop, limit );
+
+       const auto* by_operation = get_account_history_by_operation_index();
+       if( by_operation != nullptr )
+       {
+          // find the most recent entry whose operation is not newer than start
+          const auto& by_op_idx = db.get_index_type<account_history_index>().indices().get<by_op>();
+          auto itr = ( start == operation_history_id_type() ) ? by_op_idx.lower_bound( account )
+                                                              : by_op_idx.lower_bound( boost::make_tuple( account,
+                                                                                                          start ) );
+          if( itr == by_op_idx.end() || itr->account != account )
+             return result;
+          for( const auto& entry_id : by_operation->get_entries( account, operation_type, 0, itr->sequence, limit ) )
+          {
+             const auto& entry = entry_id(db);
+             // a stop of 0 includes the operation with ID 0
+             if( stop.instance.value != 0 && entry.operation_id.instance.value <= stop.instance.value )
+                break;
+             result.push_back( entry.operation_id(db) );
+          }
+          return result;
+       }
+
        const auto& stats = account(db).statistics(db);
        if( stats.most_recent_op == account_history_id_type() ) return result;
        const account_history_object* node = &stats.most_recent_op(db);
@@ -546,6 +612,11 @@ namespace graphene { namespace app {
           database_api_helper db_api_helper( _app );
           account = db_api_helper.get_account_from_string(account_id_or_name)->get_id();
        } catch(...) { return result; }
+
+       const auto* store = get_account_history_store();
+       if( store != nullptr )
+          return store->get_relative_account_history( account, stop, limit, start );
+
        const auto& stats = account(db).statistics(db);
        if( start == 0 )
           start = stats.total_ops;
@@ -621,6 +692,46 @@ namespace graphene { namespace app {
                   ("configured_limit", configured_limit) );
 
        history_operation_detail result;
+
+       const auto* by_operation = get_account_history_by_operation_index();
+       if( by_operation != nullptr && !operation_types.empty() )
+       {
+          // Select from the same sequence window as get_relative_account_history below, but page through the
+          // entries of the requested types only
+          FC_ASSERT( _app.chain_database(), "database unavailable" );
+          const auto& db = *_app.chain_database();
+          account_id_type account;
+          try {
+             database_api_helper db_api_helper( _app );
+             account = db_api_helper.get_account_from_string(account_id_or_name)->get_id();
+          } catch(...) { return result; }
+
+          const auto& stats = account(db).statistics(db);
+          const uint64_t stop = start;
+          uint64_t last = limit + start - 1;
+          last = ( last == 0 ) ? stats.total_ops : std::min( stats.total_ops, last );
+          if( last >= stop && last > stats.removed_ops && limit > 0 )
+          {
+             // the entries of an account have consecutive sequence numbers after the removed ones
+             const uint64_t window_first = ( last >= limit ) ? ( last - limit + 1 ) : 0;
+             const uint64_t first = std::max( window_first, std::max( stop, stats.removed_ops + 1 ) );
+             result.total_count = static_cast<uint32_t>( last - first + 1 );
+
+             vector<const account_history_object*> entries;
+             for( uint16_t operation_type : operation_types )
+                for( const auto& entry_id : by_operation->get_entries( account, operation_type, first, last, limit ) )
+                   entries.push_back( &entry_id(db) );
+             std::sort( entries.begin(), entries.end(),
+                        []( const account_history_object* a, const account_history_object* b ) {
+                           return a->sequence > b->sequence;
+                        } );
+             result.operation_history_objs.reserve( entries.size() );
+             for( const auto* entry : entries )
+                result.operation_history_objs.push_back( entry->operation_id(db) );
+          }
+          return result;
+       }
+
        vector<operation_history_object> objs = get_relative_account_history( account_id_or_name, start, limit,
                                                                              limit + start - 1 );
        result.total_count = objs.size();
@@ -868,6 +979,19 @@ namespace graphene { namespace app {
     { // Nothing else to do
     }
 
+    const graphene::api_helper_indexes::asset_holders_index* asset_api::get_asset_holders_index()const
+    {
+       try
+       {
+          return &_db.get_index_type< primary_index< account_balance_index > >()
+                     .get_secondary_index< graphene::api_helper_indexes::asset_holders_index >();
+       }
+       catch( const fc::assert_exception& )
+       {
+          return nullptr;
+       }
+    }
+
     vector<asset_api::account_asset_balance> asset_api::get_asset_holders( const std::string& asset_symbol_or_id,
                                                                            uint32_t start, uint32_t limit ) const
     {
@@ -878,19 +1002,25 @@ namespace graphene { namespace app {
 
        database_api_helper db_api_helper( _app );
        asset_id_type asset_id = db_api_helper.get_asset_from_string( asset_symbol_or_id )->get_id();
-       const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
-       auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
 
        vector<account_asset_balance> result;
 
+       const auto* holders_index = get_asset_holders_index();
+       if( holders_index != nullptr && start >= holders_index->get_holder_count( asset_id ) )
+          return result;
+
+       const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
+       auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
+
        uint32_t index = 0;
        for( const account_balance_object& bal : boost::make_iterator_range( range.first, range.second ) )
        {
           if( result.size() >= limit )
              break;
 
+          // balances are ordered from the largest, so there is no holder after a zero balance
           if( bal.balance.value == 0 )
-             continue;
+             break;
 
           if( index++ < start )
              continue;
@@ -909,9 +1039,14 @@ namespace graphene { namespace app {
     }
     // get number of asset holders.
     int64_t asset_api::get_asset_holders_count( const std::string& asset_symbol_or_id ) const {
-       const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
        database_api_helper db_api_helper( _app );
        asset_id_type asset_id = db_api_helper.get_asset_from_string( asset_symbol_or_id )->get_id();
+
+       const auto* holders_index = get_asset_holders_index();
+       if( holders_index != nullptr )
+          return static_cast<int64_t>( holders_index->get_balance_count( asset_id ) ) - 1;
+
+       const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
        auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
 
        int64_t count = boost::distance(range) - 1;
@@ -919,20 +1054,39 @@ namespace graphene { namespace app {
        return count;
     }
     // function to get vector of system assets with holders count.
-    vector<asset_api::asset_holders> asset_api::get_all_asset_holders() const {
+    vector<asset_api::asset_holders> asset_api::get_all_asset_holders( const optional<asset_id_type>& start,
+                                                                       const optional<uint32_t>& olimit ) const {
+       uint32_t limit = std::numeric_limits<uint32_t>::max();
+       if( olimit.valid() )
+       {
+          const auto configured_limit = _app.get_options().api_limit_get_assets;
+          limit = *olimit;
+          FC_ASSERT( limit <= configured_limit,
+                     "limit can not be greater than ${configured_limit}",
+                     ("configured_limit", configured_limit) );
+       }
+
+       const auto* holders_index = get_asset_holders_index();
+       const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
+
        vector<asset_holders> result;
-       vector<asset_id_type> total_assets;
-       for( const asset_object& asset_obj : _db.get_index_type<asset_index>().indices() )
+       const auto& assets = _db.get_index_type<asset_index>().indices().get<by_id>();
+       auto itr = start.valid() ? assets.lower_bound( *start ) : assets.begin();
+       for( ; itr != assets.end() && result.size() < limit; ++itr )
        {
-          const auto& dasset_obj = asset_obj.dynamic_asset_data_id(_db);
+          const auto& dasset_obj = itr->dynamic_asset_data_id(_db);
 
           asset_id_type asset_id;
           asset_id = dasset_obj.id;
 
-          const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
-          auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
-
-          int64_t count = boost::distance(range) - 1;
+          int64_t count;
+          if( holders_index != nullptr )
+             count = static_cast<int64_t>( holders_index->get_balance_count( asset_id ) ) - 1;
+          else
+          {
+             auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
+             count = boost::distance(range) - 1;
+          }
 
           asset_holders ah;
           ah.asset_id       = asset_id;
@@ -10,6 +10,7 @@
 #include <graphene/chain/db_with.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
+#include <graphene/protocol/signature_cache.hpp>
 #include <graphene/protocol/types.hpp>
 
 #include <graphene/egenesis/egenesis.hpp>
@@ -535,6 +536,36 @@ void application_impl::open_chain_database() const
       _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
    }
 
+   if( _options->count("enable-parallel-authority-checks") > 0 )
+      _chain_db->enable_parallel_authority_checks( _options->at("enable-parallel-authority-checks").as<bool>() );
+
+   if( _options->count("enable-parallel-vote-tally") > 0 )
+      _chain_db->enable_parallel_vote_tally( _options->at("enable-parallel-vote-tally").as<bool>() );
+
+   if( _options->count("max-pending-transactions-size") > 0 || _options->count("max-pending-transactions-per-account") > 0 )
+   {
+      _chain_db->set_pending_transaction_limits(
+            _options->count("max-pending-transactions-size") > 0 ?
+                  _options->at("max-pending-transactions-size").as<uint64_t>() : 0,
+            _options->count("max-pending-transactions-per-account") > 0 ?
+                  _options->at("max-pending-transactions-per-account").as<uint32_t>() : 0 );
+   }
+
+   if( _options->count("signature-cache-size") > 0 )
+      protocol::signature_cache::instance().set_capacity( _options->at("signature-cache-size").as<uint32_t>() );
+
+   if( _options->count("object-database-checkpoint-interval") > 0 )
+      _chain_db->set_object_database_checkpoint_interval(
+            _options->at("object-database-checkpoint-interval").as<uint32_t>() );
+
+   if( _options->count("replay-lookahead-blocks") > 0 )
+      _chain_db->set_reindex_lookahead( _options->at("replay-lookahead-blocks").as<uint32_t>() );
+
+   if( _options->count("block-write-queue-size") > 0 )
+      _chain_db->set_block_write_queue( _options->at("block-write-queue-size").as<uint32_t>(),
+                                        _options->count("block-sync-interval") > 0 ?
+                                              _options->at("block-sync-interval").as<uint32_t>() : 0 );
+
    if( _options->count("replay-blockchain") > 0 || _options->count("revalidate-blockchain") > 0 )
       _chain_db->wipe( _data_dir / "blockchain", false );
 
@@ -805,13 +836,20 @@ message application_impl::get_item(const item_id& id)
   // ilog("Request for item ${id}", ("id", id));
    if( id.item_type == graphene::net::block_message_type )
    {
-      auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
+      // the same blocks are requested by every syncing peer, and twice for each of them by the p2p code
+      auto& cached = _served_blocks[ block_header::num_from_id(id.item_hash) % served_block_cache_size ];
+      if( cached.valid() && block_message::id_of( *cached ) == id.item_hash )
+         return *cached;
+
+      // serve the block as it is stored, it has been validated already and never changes
+      auto opt_block = _chain_db->fetch_raw_block_by_id(id.item_hash);
       if( !opt_block )
          elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
               ("id", id.item_hash)("id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
       FC_ASSERT( opt_block.valid() );
-      // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-      return block_message(std::move(*opt_block));
+      // ilog("Serving up block #${num}", ("num", block_header::num_from_id(id.item_hash)));
+      cached = block_message::from_packed_block( std::move(*opt_block), id.item_hash );
+      return *cached;
    }
    return trx_message( _chain_db->get_recent_transaction( id.item_hash ) );
 } FC_CAPTURE_AND_RETHROW( (id) ) } // GCOVR_EXCL_LINE
@@ -1207,6 +1245,36 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby witnesses and committee members. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
+         ("enable-parallel-authority-checks", bpo::value<bool>()->implicit_value(true),
+          "Whether to verify the authorities of the transactions in a block on worker threads against the state "
+          "before the block while the block is applied, default to true")
+         ("enable-parallel-vote-tally", bpo::value<bool>()->implicit_value(true),
+          "Whether to tally the votes of accounts on worker threads during chain maintenance, default to true")
+         ("max-pending-transactions-size", bpo::value<uint64_t>()->implicit_value(0),
+          "Maximum total size in bytes of the transactions waiting to be included in a block. When it is reached, "
+          "transactions paying the lowest fees per byte are dropped for new ones paying more. "
+          "Default to 0 which means no limit")
+         ("max-pending-transactions-per-account", bpo::value<uint32_t>()->implicit_value(0),
+          "Maximum number of transactions of one fee paying account waiting to be included in a block, "
+          "default to 0 which means no limit")
+         ("signature-cache-size", bpo::value<uint32_t>()->implicit_value(
+                                        protocol::signature_cache::default_capacity),
+          "Maximum number of public keys recovered from transaction signatures to keep in memory, so that "
+          "transactions seen again, e.g. in a block, are not recovered again. 0 disables the cache")
+         ("object-database-checkpoint-interval", bpo::value<uint32_t>()->implicit_value(0),
+          "Write the objects changed since the previous checkpoint to an append-only log every this many blocks, "
+          "so that the node can restart quickly after a crash instead of replaying the blockchain. "
+          "Default to 0 which disables checkpoints")
+         ("block-write-queue-size", bpo::value<uint32_t>()->implicit_value(0),
+          "Write blocks to disk on a dedicated thread, with at most this many blocks waiting to be written, "
+          "so that slow disks do not delay block processing. "
+          "Default to 0 which writes blocks while they are processed")
+         ("block-sync-interval", bpo::value<uint32_t>()->implicit_value(0),
+          "When blocks are written on a dedicated thread, sync the block log to disk every this many blocks. "
+          "Default to 0 which syncs it only at object database checkpoints and on shutdown")
+         ("replay-lookahead-blocks", bpo::value<uint32_t>()->implicit_value(0),
+          "Maximum number of blocks to read, decode and precompute in parallel ahead of the one being applied "
+          "when replaying the blockchain, default to 0 for auto-configuration based on the number of IO threads")
          ("api-limit-get-account-history-operations",
           bpo::value<uint32_t>()->default_value(default_opts.api_limit_get_account_history_operations),
           "For history_api::get_account_history_operations to set max limit value")
@@ -9,6 +9,8 @@
 #include <graphene/protocol/types.hpp>
 #include <graphene/net/message.hpp>
 
+#include <array>
+
 namespace graphene { namespace app { namespace detail {
 
 
@@ -227,6 +229,10 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
       /// A string defined by the node operator, which can be retrieved via the login_api::get_info API
       string _node_info;
 
+      /// Messages of the blocks served to peers most recently, indexed by block number modulo the size
+      static constexpr size_t served_block_cache_size = 64;
+      std::array<fc::optional<graphene::net::message>, served_block_cache_size> _served_blocks;
+
       fc::serial_valve valve;
    };
 
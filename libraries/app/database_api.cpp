@@ -204,7 +204,11 @@ void database_api_impl::cancel_all_subscriptions( bool reset_callback, bool rese
       _subscribe_callback = std::function<void(const fc::variant&)>();
 
    if ( reset_market_subscriptions )
+   {
       _market_subscriptions.clear();
+      _order_book_depth_subscriptions.clear();
+      _order_book_cache.clear();
+   }
 
    _notify_remove_create = false;
    _subscribed_accounts.clear();
@@ -1367,6 +1371,11 @@ void database_api_impl::unsubscribe_from_market(const std::string& a, const std:
    if(a > b) std::swap(asset_a_id,asset_b_id);
    FC_ASSERT(asset_a_id != asset_b_id);
    _market_subscriptions.erase(std::make_pair(asset_a_id,asset_b_id));
+   if( !is_subscribed_to_order_book( asset_a_id, asset_b_id ) )
+   {
+      _order_book_cache.erase( std::make_pair( asset_a_id, asset_b_id ) );
+      _order_book_cache.erase( std::make_pair( asset_b_id, asset_a_id ) );
+   }
 }
 
 market_ticker database_api::get_ticker( const string& base, const string& quote )const
@@ -1443,6 +1452,27 @@ order_book database_api_impl::get_order_book( const string& base, const string&
 
    auto base_id = assets[0]->get_id();
    auto quote_id = assets[1]->get_id();
+
+   // The result only changes with the orders of the market, so it is kept for the markets being watched
+   const bool cacheable = is_subscribed_to_order_book( base_id, quote_id );
+   std::pair<uint64_t,uint64_t> revisions;
+   if( cacheable )
+   {
+      revisions = get_order_book_revisions( base_id, quote_id );
+      auto cached = _order_book_cache.find( std::make_pair( base_id, quote_id ) );
+      if( cached != _order_book_cache.end() && cached->second.revisions == revisions
+            && cached->second.limit >= limit )
+      {
+         result.bids = cached->second.book.bids;
+         result.asks = cached->second.book.asks;
+         if( result.bids.size() > limit )
+            result.bids.resize( limit );
+         if( result.asks.size() > limit )
+            result.asks.resize( limit );
+         return result;
+      }
+   }
+
    auto orders = get_limit_orders( base_id, quote_id, limit );
 
    for( const auto& o : orders )
@@ -1468,9 +1498,83 @@ order_book database_api_impl::get_order_book( const string& base, const string&
       }
    }
 
+   if( cacheable )
+   {
+      auto& cached = _order_book_cache[ std::make_pair( base_id, quote_id ) ];
+      cached.revisions = revisions;
+      cached.limit = limit;
+      cached.book = result;
+   }
+
    return result;
 }
 
+order_book_depth database_api::get_order_book_depth( const string& base, const string& quote, uint32_t limit )const
+{
+   return my->get_order_book_depth( base, quote, limit );
+}
+
+order_book_depth database_api_impl::get_order_book_depth( const string& base, const string& quote,
+                                                          uint32_t limit )const
+{
+   FC_ASSERT( _app_options, "Internal error" );
+   const auto configured_limit = _app_options->api_limit_get_order_book;
+   FC_ASSERT( limit <= configured_limit,
+              "limit can not be greater than ${configured_limit}",
+              ("configured_limit", configured_limit) );
+
+   auto assets = lookup_asset_symbols( {base, quote} );
+   FC_ASSERT( assets[0], "Invalid base asset symbol: ${s}", ("s",base) );
+   FC_ASSERT( assets[1], "Invalid quote asset symbol: ${s}", ("s",quote) );
+
+   return build_order_book_depth( assets[0]->get_id(), assets[1]->get_id(), limit );
+}
+
+void database_api::subscribe_to_order_book_depth( std::function<void(const variant&)> callback,
+                                                  const string& base, const string& quote, uint32_t limit )
+{
+   my->subscribe_to_order_book_depth( callback, base, quote, limit );
+}
+
+void database_api_impl::subscribe_to_order_book_depth( std::function<void(const variant&)> callback,
+                                                       const string& base, const string& quote, uint32_t limit )
+{
+   FC_ASSERT( _app_options, "Internal error" );
+   const auto configured_limit = _app_options->api_limit_get_order_book;
+   FC_ASSERT( limit <= configured_limit,
+              "limit can not be greater than ${configured_limit}",
+              ("configured_limit", configured_limit) );
+
+   auto base_id = get_asset_from_string( base )->get_id();
+   auto quote_id = get_asset_from_string( quote )->get_id();
+   FC_ASSERT( base_id != quote_id );
+
+   const auto market = std::make_pair( base_id, quote_id );
+   auto& sub = _order_book_depth_subscriptions[ market ];
+   sub.callback = callback;
+   sub.limit = limit;
+   sub.last_depth = order_book_depth();
+   notify_order_book_depth( market, sub, true );
+}
+
+void database_api::unsubscribe_from_order_book_depth( const string& base, const string& quote )
+{
+   my->unsubscribe_from_order_book_depth( base, quote );
+}
+
+void database_api_impl::unsubscribe_from_order_book_depth( const string& base, const string& quote )
+{
+   auto base_id = get_asset_from_string( base )->get_id();
+   auto quote_id = get_asset_from_string( quote )->get_id();
+
+   _order_book_depth_subscriptions.erase( std::make_pair( base_id, quote_id ) );
+   if( !is_subscribed_to_order_book( base_id, quote_id ) )
+   {
+      _order_book_cache.erase( std::make_pair( base_id, quote_id ) );
+      _order_book_cache.erase( std::make_pair( quote_id, base_id ) );
+   }
+}
+
 vector<market_ticker> database_api::get_top_markets(uint32_t limit)const
 {
    return my->get_top_markets(limit);
@@ -3100,34 +3204,137 @@ vector<limit_order_object> database_api_impl::get_limit_orders( const asset_id_t
               "limit can not be greater than ${configured_limit}",
               ("configured_limit", configured_limit) );
 
-   const auto& limit_order_idx = _db.get_index_type<limit_order_index>();
-   const auto& limit_price_idx = limit_order_idx.indices().get<by_price>();
+   const auto& order_books = _db.get_limit_order_books();
 
    vector<limit_order_object> result;
    result.reserve(limit*2);
 
-   uint32_t count = 0;
-   auto limit_itr = limit_price_idx.lower_bound(price::max(a,b));
-   auto limit_end = limit_price_idx.upper_bound(price::min(a,b));
-   while(limit_itr != limit_end && count < limit)
+   for( const auto* side : { order_books.get_book_side( a, b ), order_books.get_book_side( b, a ) } )
    {
-      result.push_back(*limit_itr);
-      ++limit_itr;
-      ++count;
+      if( side == nullptr )
+         continue;
+      uint32_t count = 0;
+      for( auto level = side->begin(); level != side->end() && count < limit; ++level )
+      {
+         const auto& orders = level->second.orders;
+         for( auto order = orders.begin(); order != orders.end() && count < limit; ++order, ++count )
+            result.push_back( *order->second );
+      }
    }
-   count = 0;
-   limit_itr = limit_price_idx.lower_bound(price::max(b,a));
-   limit_end = limit_price_idx.upper_bound(price::min(b,a));
-   while(limit_itr != limit_end && count < limit)
+
+   return result;
+}
+
+// helper function
+order_book_depth database_api_impl::build_order_book_depth( asset_id_type base, asset_id_type quote,
+                                                            uint32_t limit )const
+{
+   const auto& order_books = _db.get_limit_order_books();
+
+   order_book_depth result;
+   result.base = base;
+   result.quote = quote;
+
+   for( bool bids : { true, false } )
    {
-      result.push_back(*limit_itr);
-      ++limit_itr;
-      ++count;
+      const auto* side = bids ? order_books.get_book_side( base, quote ) : order_books.get_book_side( quote, base );
+      if( side == nullptr )
+         continue;
+      auto& levels = bids ? result.bids : result.asks;
+      levels.reserve( std::min<size_t>( limit, side->size() ) );
+      for( auto itr = side->begin(); itr != side->end() && levels.size() < limit; ++itr )
+      {
+         const price& sell_price = itr->first;
+         const share_type for_sale = itr->second.total_for_sale;
+         const share_type to_receive( fc::uint128_t( for_sale.value ) * sell_price.quote.amount.value
+                                      / sell_price.base.amount.value );
+         levels.emplace_back();
+         auto& level = levels.back();
+         level.level_price = bids ? sell_price : ~sell_price;
+         level.base_amount = bids ? for_sale : to_receive;
+         level.quote_amount = bids ? to_receive : for_sale;
+         level.order_count = static_cast<uint32_t>( itr->second.orders.size() );
+      }
    }
 
    return result;
 }
 
+// helper function
+std::pair<uint64_t,uint64_t> database_api_impl::get_order_book_revisions( asset_id_type base,
+                                                                          asset_id_type quote )const
+{
+   const auto& order_books = _db.get_limit_order_books();
+   return std::make_pair( order_books.get_revision( base, quote ), order_books.get_revision( quote, base ) );
+}
+
+bool database_api_impl::is_subscribed_to_order_book( asset_id_type a, asset_id_type b )const
+{
+   const auto market = ( a < b ? std::make_pair( a, b ) : std::make_pair( b, a ) );
+   return _market_subscriptions.find( market ) != _market_subscriptions.end()
+       || _order_book_depth_subscriptions.find( std::make_pair( a, b ) ) != _order_book_depth_subscriptions.end()
+       || _order_book_depth_subscriptions.find( std::make_pair( b, a ) ) != _order_book_depth_subscriptions.end();
+}
+
+vector<order_book_level> database_api_impl::diff_order_book_levels( const vector<order_book_level>& previous,
+                                                                    const vector<order_book_level>& current )
+{
+   std::map<price, const order_book_level*> removed;
+   for( const auto& level : previous )
+      removed[ level.level_price ] = &level;
+
+   vector<order_book_level> result;
+   for( const auto& level : current )
+   {
+      auto itr = removed.find( level.level_price );
+      if( itr == removed.end() )
+      {
+         result.push_back( level );
+         continue;
+      }
+      const auto& old_level = *itr->second;
+      if( old_level.base_amount != level.base_amount || old_level.quote_amount != level.quote_amount
+            || old_level.order_count != level.order_count )
+         result.push_back( level );
+      removed.erase( itr );
+   }
+   for( const auto& item : removed )
+   {
+      result.emplace_back();
+      result.back().level_price = item.first;
+   }
+   return result;
+}
+
+void database_api_impl::notify_order_book_depth( const pair<asset_id_type,asset_id_type>& market,
+                                                 order_book_depth_subscription& sub, bool force )
+{
+   auto revisions = get_order_book_revisions( market.first, market.second );
+   if( !force && revisions == sub.revisions )
+      return;
+   sub.revisions = revisions;
+
+   order_book_depth depth = build_order_book_depth( market.first, market.second, sub.limit );
+   order_book_depth_update update;
+   update.base = market.first;
+   update.quote = market.second;
+   update.block_num = _db.head_block_num();
+   update.bids = diff_order_book_levels( sub.last_depth.bids, depth.bids );
+   update.asks = diff_order_book_levels( sub.last_depth.asks, depth.asks );
+   sub.last_depth = std::move( depth );
+
+   if( !force && update.bids.empty() && update.asks.empty() )
+      return;
+
+   auto capture_this = shared_from_this();
+   fc::variant v( update, GRAPHENE_NET_MAX_NESTED_OBJECTS );
+   fc::async([this,capture_this,market,v](){
+      auto itr = _order_book_depth_subscriptions.find( market );
+      if( itr != _order_book_depth_subscriptions.end() )
+         itr->second.callback( v );
+   });
+}
+
 bool database_api_impl::is_impacted_account( const flat_set<account_id_type>& accounts)
 {
    if( _subscribed_accounts.empty() || accounts.empty() )
@@ -3218,7 +3425,7 @@ void database_api_impl::handle_object_changed( bool force_notify,
                auto obj = find_object(id);
                if( obj )
                {
-                  updates.emplace_back( obj->to_variant() );
+                  updates.emplace_back( _db.get_notified_object_variant( *obj ) );
                }
             }
             else
@@ -3272,6 +3479,9 @@ void database_api_impl::on_applied_block()
       });
    }
 
+   for( auto& item : _order_book_depth_subscriptions )
+      notify_order_book_depth( item.first, item.second, false );
+
    if( _market_subscriptions.empty() )
       return;
 
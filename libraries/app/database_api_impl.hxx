@@ -109,6 +109,11 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       market_volume                      get_24_volume( const string& base, const string& quote )const;
       order_book                         get_order_book( const string& base, const string& quote,
                                                          uint32_t limit )const;
+      order_book_depth                   get_order_book_depth( const string& base, const string& quote,
+                                                               uint32_t limit )const;
+      void subscribe_to_order_book_depth( std::function<void(const variant&)> callback,
+                                          const string& base, const string& quote, uint32_t limit );
+      void unsubscribe_from_order_book_depth( const string& base, const string& quote );
       vector<market_ticker>              get_top_markets( uint32_t limit )const;
       vector<market_trade>               get_trade_history( const string& base, const string& quote,
                                                             fc::time_point_sec start, fc::time_point_sec stop,
@@ -289,6 +294,29 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
          return results;
       }
 
+      ////////////////////////////////////////////////
+      // Order books
+      ////////////////////////////////////////////////
+
+      // Aggregates the best @p limit levels of bids and asks of the market base:quote
+      order_book_depth build_order_book_depth( asset_id_type base, asset_id_type quote, uint32_t limit )const;
+
+      // Returns the revisions of the bids and the asks of the market base:quote
+      std::pair<uint64_t,uint64_t> get_order_book_revisions( asset_id_type base, asset_id_type quote )const;
+
+      // Whether there is a subscription to the market of the two assets, in any direction
+      bool is_subscribed_to_order_book( asset_id_type a, asset_id_type b )const;
+
+      // Returns the levels of @p current which differ from @p previous, and the levels of @p previous which are
+      // not in @p current without orders
+      static vector<order_book_level> diff_order_book_levels( const vector<order_book_level>& previous,
+                                                              const vector<order_book_level>& current );
+
+      struct order_book_depth_subscription;
+      // Notifies @p sub of the changes of the order book, if there are any or @p force is true
+      void notify_order_book_depth( const pair<asset_id_type,asset_id_type>& market,
+                                    order_book_depth_subscription& sub, bool force );
+
       ////////////////////////////////////////////////
       // Subscription
       ////////////////////////////////////////////////
@@ -370,7 +398,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
          auto sub = _market_subscriptions.find( market );
          if( sub != _market_subscriptions.end() ) {
-            queue[market].emplace_back( full_object ? obj->to_variant() : fc::variant(obj->id, 1) );
+            queue[market].emplace_back( full_object ? _db.get_notified_object_variant( *obj )
+                                                    : fc::variant(obj->id, 1) );
          }
       }
 
@@ -411,6 +440,26 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
       map< pair<asset_id_type,asset_id_type>, std::function<void(const variant&)> > _market_subscriptions;
 
+      struct order_book_depth_subscription
+      {
+         std::function<void(const variant&)> callback;
+         uint32_t                            limit = 0;
+         std::pair<uint64_t,uint64_t>        revisions;
+         /// The order book as of the last notification
+         order_book_depth                    last_depth;
+      };
+      /// Subscriptions to aggregated order books, by base and quote asset
+      map< pair<asset_id_type,asset_id_type>, order_book_depth_subscription > _order_book_depth_subscriptions;
+
+      struct cached_order_book
+      {
+         std::pair<uint64_t,uint64_t> revisions;
+         uint32_t                     limit = 0;
+         order_book                   book;
+      };
+      /// Results of get_order_book for subscribed markets, by base and quote asset
+      mutable map< pair<asset_id_type,asset_id_type>, cached_order_book > _order_book_cache;
+
       const graphene::api_helper_indexes::amount_in_collateral_index* amount_in_collateral_index;
       const graphene::api_helper_indexes::asset_in_liquidity_pools_index* asset_in_liquidity_pools_index;
       const graphene::api_helper_indexes::next_object_ids_index* next_object_ids_index;
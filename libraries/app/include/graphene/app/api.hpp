@@ -5,6 +5,7 @@
 
 #include <graphene/app/database_api.hpp>
 
+#include <graphene/protocol/signature_cache.hpp>
 #include <graphene/protocol/types.hpp>
 
 #include <graphene/market_history/market_history_plugin.hpp>
@@ -29,6 +30,11 @@
 #include <string>
 #include <vector>
 
+namespace graphene { namespace account_history {
+   class account_history_store;
+   class account_history_by_operation_index;
+} }
+
 namespace graphene { namespace app {
    using namespace graphene::chain;
    using namespace graphene::market_history;
@@ -280,6 +286,11 @@ namespace graphene { namespace app {
                const optional<int64_t>& operation_type = optional<int64_t>() )const;
 
       private:
+           /// Returns the store of the account_history plugin if it keeps the histories on disk, otherwise nullptr
+           const account_history::account_history_store* get_account_history_store()const;
+           /// Returns the index of the account_history plugin by operation type if it is kept, otherwise nullptr
+           const account_history::account_history_by_operation_index* get_account_history_by_operation_index()const;
+
            application& _app;
    };
 
@@ -409,6 +420,21 @@ namespace graphene { namespace app {
           */
          std::vector<net::potential_peer_record> get_potential_peers() const;
 
+         /**
+          * @brief Get the number of hits and misses of the cache of public keys recovered from signatures
+          */
+         protocol::signature_cache_stats get_signature_cache_stats() const;
+
+         /**
+          * @brief Get the depth and memory usage of the undo history of the chain database
+          */
+         graphene::db::undo_history_stats get_undo_history_stats() const;
+
+         /**
+          * @brief Get the number of objects converted for and shared between the receivers of object notifications
+          */
+         graphene::chain::database::object_notification_stats get_object_notification_stats() const;
+
       private:
          application& _app;
    };
@@ -562,11 +588,18 @@ namespace graphene { namespace app {
 
          /**
           * @brief Get all asset holders
-          * @return A list of all asset holders
+          * @param start ID of the asset to start from, the first page is returned if omitted
+          * @param limit Maximum number of assets to retrieve, must not exceed the configured value of
+          *              @a api_limit_get_assets, all assets from @p start are returned if omitted
+          * @return A list of asset holders counts, ordered by asset ID
           */
-         vector<asset_holders> get_all_asset_holders() const;
+         vector<asset_holders> get_all_asset_holders( const optional<asset_id_type>& start = optional<asset_id_type>(),
+                                                      const optional<uint32_t>& limit = optional<uint32_t>() )const;
 
       private:
+         /// Returns the holders index of the api_helper_indexes plugin if it is enabled, otherwise nullptr
+         const graphene::api_helper_indexes::asset_holders_index* get_asset_holders_index()const;
+
          graphene::app::application& _app;
          graphene::chain::database& _db;
    };
@@ -832,6 +865,9 @@ FC_API(graphene::app::network_node_api,
        (get_potential_peers)
        (get_advanced_node_parameters)
        (set_advanced_node_parameters)
+       (get_signature_cache_stats)
+       (get_undo_history_stats)
+       (get_object_notification_stats)
      )
 FC_API(graphene::app::crypto_api,
        (blind)
@@ -89,6 +89,38 @@ namespace graphene { namespace app {
      order_book( const string& _base, const string& _quote );
    };
 
+   /// Orders at one price in the order book of a market, amounts are in satoshis
+   struct order_book_level
+   {
+      /// Price in base asset per quote asset
+      price                      level_price;
+      share_type                 base_amount;
+      share_type                 quote_amount;
+      /// Number of orders, 0 if the level has been removed
+      uint32_t                   order_count = 0;
+   };
+
+   /// Order book of a market aggregated by price, best prices first
+   struct order_book_depth
+   {
+      asset_id_type              base;
+      asset_id_type              quote;
+      vector< order_book_level > bids;
+      vector< order_book_level > asks;
+   };
+
+   /// Changes of the aggregated order book of a market since the previous notification
+   struct order_book_depth_update
+   {
+      asset_id_type              base;
+      asset_id_type              quote;
+      /// Block after which the changes were observed
+      uint32_t                   block_num = 0;
+      /// Levels which were added, changed or removed
+      vector< order_book_level > bids;
+      vector< order_book_level > asks;
+   };
+
    struct market_ticker
    {
       time_point_sec             time;
@@ -196,6 +228,9 @@ FC_REFLECT( graphene::app::full_account,
 
 FC_REFLECT( graphene::app::order, (price)(quote)(base)(id)(owner_id)(owner_name)(expiration) )
 FC_REFLECT( graphene::app::order_book, (base)(quote)(bids)(asks) )
+FC_REFLECT( graphene::app::order_book_level, (level_price)(base_amount)(quote_amount)(order_count) )
+FC_REFLECT( graphene::app::order_book_depth, (base)(quote)(bids)(asks) )
+FC_REFLECT( graphene::app::order_book_depth_update, (base)(quote)(block_num)(bids)(asks) )
 FC_REFLECT( graphene::app::market_ticker,
             (time)(base)(quote)(latest)(lowest_ask)(lowest_ask_base_size)(lowest_ask_quote_size)
             (highest_bid)(highest_bid_base_size)(highest_bid_quote_size)(percent_change)(base_volume)(quote_volume)
@@ -616,6 +616,43 @@ class database_api
       order_book get_order_book( const string& base, const string& quote,
             uint32_t limit = application_options::get_default().api_limit_get_order_book )const;
 
+      /**
+       * @brief Returns the order book for the market base:quote aggregated by price
+       * @param base symbol name or ID of the base asset
+       * @param quote symbol name or ID of the quote asset
+       * @param limit number of price levels to retrieve, for bids and asks each, capped at the configured value of
+       *              @a api_limit_get_order_book
+       * @return Price levels of the market with amounts in satoshis
+       *
+       * Unlike @ref get_order_book, this does not list individual orders, and no amounts are formatted.
+       */
+      order_book_depth get_order_book_depth( const string& base, const string& quote,
+            uint32_t limit = application_options::get_default().api_limit_get_order_book )const;
+
+      /**
+       * @brief Request notification when the aggregated order book of the market base:quote changes
+       * @param callback Callback method which is called when the order book changes
+       * @param base symbol name or ID of the base asset
+       * @param quote symbol name or ID of the quote asset
+       * @param limit number of price levels to follow, for bids and asks each, capped at the configured value of
+       *              @a api_limit_get_order_book
+       *
+       * Callback will be passed a variant containing an @ref order_book_depth_update with the price levels among
+       * the best @p limit ones which changed after a block was applied, in the form returned by
+       * @ref get_order_book_depth. The first notification contains all levels. Levels which are removed or fall
+       * out of the best @p limit ones are reported with no orders.
+       */
+      void subscribe_to_order_book_depth( std::function<void(const variant&)> callback,
+            const string& base, const string& quote,
+            uint32_t limit = application_options::get_default().api_limit_get_order_book );
+
+      /**
+       * @brief Unsubscribe from updates to the aggregated order book of a market
+       * @param base symbol name or ID of the base asset
+       * @param quote symbol name or ID of the quote asset
+       */
+      void unsubscribe_from_order_book_depth( const string& base, const string& quote );
+
       /**
        * @brief Returns vector of tickers sorted by reverse base_volume
        * @note this API is experimental and subject to change in next releases
@@ -1503,6 +1540,7 @@ FC_API(graphene::app::database_api,
 
    // Markets / feeds
    (get_order_book)
+   (get_order_book_depth)
    (get_limit_orders)
    (get_limit_orders_by_account)
    (get_account_limit_orders)
@@ -1514,6 +1552,8 @@ FC_API(graphene::app::database_api,
    (get_collateral_bids)
    (subscribe_to_market)
    (unsubscribe_from_market)
+   (subscribe_to_order_book_depth)
+   (unsubscribe_from_order_book_depth)
    (get_ticker)
    (get_24_volume)
    (get_top_markets)
@@ -3,9 +3,18 @@
  */
 #include <graphene/chain/block_database.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/raw.hpp>
 #include <boost/endian/buffers.hpp>
 
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace graphene { namespace chain {
 
 struct index_entry
@@ -23,40 +32,343 @@ FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
 namespace graphene { namespace chain {
 
+namespace {
+
+   void seek_file( FILE* f, uint64_t pos )
+   {
+#ifdef _WIN32
+      int r = _fseeki64( f, int64_t(pos), SEEK_SET );
+#else
+      int r = fseeko( f, off_t(pos), SEEK_SET );
+#endif
+      FC_ASSERT( r == 0, "Unable to seek to position ${pos} in block database", ("pos",pos) );
+   }
+
+   void write_file( FILE* f, uint64_t pos, const char* data, size_t size )
+   {
+      seek_file( f, pos );
+      FC_ASSERT( fwrite( data, 1, size, f ) == size, "Unable to write to block database" );
+   }
+
+   void sync_file( FILE* f )
+   {
+      FC_ASSERT( fflush( f ) == 0, "Unable to flush block database" );
+#ifdef _WIN32
+      _commit( _fileno( f ) );
+#else
+      fsync( fileno( f ) );
+#endif
+   }
+
+   /**
+    * A read-only mapping of a prefix of one of the block database files.
+    * The mapping is kept alive for as long as any reader holds a reference to it.
+    */
+   struct mapped_file
+   {
+      mapped_file() = default;
+      mapped_file( const fc::path& filename, uint64_t file_size ) : size( file_size )
+      {
+         if( size == 0 )
+            return;
+         mapping.reset( new fc::file_mapping( filename.generic_string().c_str(), fc::read_only ) );
+         region.reset( new fc::mapped_region( *mapping, fc::read_only, 0, size ) );
+         data = (const char*)region->get_address();
+      }
+
+      std::unique_ptr<fc::file_mapping>  mapping;
+      std::unique_ptr<fc::mapped_region> region;
+      const char*                        data = nullptr;
+      uint64_t                           size = 0;
+   };
+
+}
+
+struct block_database::log_view
+{
+   std::shared_ptr<const mapped_file> index  = std::make_shared<const mapped_file>();
+   std::shared_ptr<const mapped_file> blocks = std::make_shared<const mapped_file>();
+};
+
+block_database::block_database()
+   : _view( std::make_shared<const log_view>() ), _blocks_read_pos( 0 ), _queued_count( 0 )
+{
+}
+
+block_database::~block_database()
+{
+   if( is_open() )
+      close();
+}
+
 void block_database::open( const fc::path& dbdir )
 { try {
    fc::create_directories(dbdir);
-   _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-   _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
+   std::lock_guard<std::mutex> guard( _write_mutex );
    _index_filename = dbdir / "index";
-   if( !fc::exists( _index_filename ) )
-   {
-     _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-   }
-   else
+   _blocks_filename = dbdir / "blocks";
+   // Only create missing files, an index without its blocks is useless and must not be overwritten silently
+   const bool index_exists = fc::exists( _index_filename );
+   const bool blocks_exist = fc::exists( _blocks_filename );
+   FC_ASSERT( blocks_exist || !index_exists || fc::file_size( _index_filename ) == 0,
+              "Block database file ${f} is missing, but its index ${i} is not",
+              ("f",_blocks_filename)("i",_index_filename) );
+   _index_file = fopen( _index_filename.generic_string().c_str(), index_exists ? "r+b" : "w+b" );
+   FC_ASSERT( _index_file != nullptr, "Unable to open ${f}", ("f",_index_filename) );
+   _blocks_file = fopen( _blocks_filename.generic_string().c_str(), blocks_exist ? "r+b" : "w+b" );
+   if( _blocks_file == nullptr )
    {
-     _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+      fclose( _index_file );
+      _index_file = nullptr;
+      FC_THROW( "Unable to open ${f}", ("f",_blocks_filename) );
    }
+   _index_size = fc::file_size( _index_filename );
+   _blocks_size = fc::file_size( _blocks_filename );
+   _blocks_read_pos = 0;
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
 bool block_database::is_open()const
 {
-  return _blocks.is_open();
+  return _blocks_file != nullptr;
+}
+
+void block_database::start_writer( uint32_t max_queued_blocks, uint32_t sync_interval )
+{
+   FC_ASSERT( is_open(), "The block database is not open" );
+   FC_ASSERT( max_queued_blocks > 0, "The block write queue must hold at least one block" );
+   FC_ASSERT( !_writer.joinable(), "The block writer is already running" );
+   {
+      std::lock_guard<std::mutex> guard( _queue_mutex );
+      _max_queued_blocks = max_queued_blocks;
+      _sync_interval = sync_interval;
+      _stopping = false;
+      _write_error = nullptr;
+   }
+   {
+      std::lock_guard<std::mutex> guard( _write_mutex );
+      _unsynced_blocks = 0;
+   }
+   _writer = std::thread( [this] () { writer_loop(); } );
+}
+
+void block_database::stop_writer()
+{
+   if( !_writer.joinable() )
+      return;
+   {
+      std::lock_guard<std::mutex> guard( _queue_mutex );
+      _stopping = true;
+   }
+   _queue_cond.notify_all();
+   _writer.join();
+
+   std::lock_guard<std::mutex> guard( _queue_mutex );
+   if( _write_error )
+      elog( "${n} queued blocks could not be written to the block database", ("n", _queued_by_num.size()) );
+   _queue.clear();
+   _queued_by_num.clear();
+   _queued_count = 0;
+   _write_error = nullptr;
+   _stopping = false;
+}
+
+void block_database::writer_loop()
+{
+   std::unique_lock<std::mutex> lock( _queue_mutex );
+   while( true )
+   {
+      _queue_cond.wait( lock, [this] () { return _stopping || ( !_queue.empty() && !_write_error ); } );
+      // when stopping, drain the queue first
+      if( _queue.empty() || _write_error )
+         return;
+
+      std::deque<queued_block_ptr> batch;
+      batch.swap( _queue );
+      _writing = true;
+      lock.unlock();
+      _queue_cond.notify_all(); // the queue has room again
+
+      std::exception_ptr error;
+      try
+      {
+         write_blocks( batch );
+         // flush() may sync the files in another thread at the same time
+         std::lock_guard<std::mutex> guard( _write_mutex );
+         _unsynced_blocks += batch.size();
+         if( _sync_interval > 0 && _unsynced_blocks >= _sync_interval )
+         {
+            sync_file( _blocks_file );
+            sync_file( _index_file );
+            _unsynced_blocks = 0;
+         }
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Unable to write blocks to the block database: ${e}", ("e", e.to_detail_string()) );
+         error = std::current_exception();
+      }
+      catch( ... )
+      {
+         elog( "Unable to write blocks to the block database" );
+         error = std::current_exception();
+      }
+
+      lock.lock();
+      _writing = false;
+      if( error )
+         _write_error = error; // keep the blocks queued, so that they can still be read
+      else
+      {
+         // the blocks are visible in the files now
+         for( const auto& item : batch )
+         {
+            auto itr = _queued_by_num.find( block_header::num_from_id( item->id ) );
+            if( itr != _queued_by_num.end() && itr->second == item )
+               _queued_by_num.erase( itr );
+         }
+      }
+      _queued_count = _queued_by_num.size();
+      _queue_cond.notify_all();
+   }
+}
+
+void block_database::wait_for_writes()const
+{
+   if( _queued_count == 0 )
+      return;
+   std::unique_lock<std::mutex> lock( _queue_mutex );
+   _queue_cond.wait( lock, [this] () { return ( _queue.empty() && !_writing ) || _write_error; } );
+   if( _write_error )
+      std::rethrow_exception( _write_error );
+}
+
+block_database::queued_block_ptr block_database::find_queued( uint32_t block_num )const
+{
+   if( _queued_count == 0 )
+      return queued_block_ptr();
+   std::lock_guard<std::mutex> guard( _queue_mutex );
+   auto itr = _queued_by_num.find( block_num );
+   return itr == _queued_by_num.end() ? queued_block_ptr() : itr->second;
 }
 
 void block_database::close()
 {
-  _blocks.close();
-  _block_num_to_pos.close();
+   stop_writer();
+
+   std::lock_guard<std::mutex> guard( _write_mutex );
+   std::atomic_store( &_view, std::make_shared<const log_view>() );
+   if( _blocks_file != nullptr )
+   {
+      sync_file( _blocks_file );
+      fclose( _blocks_file );
+      _blocks_file = nullptr;
+   }
+   if( _index_file != nullptr )
+   {
+      sync_file( _index_file );
+      fclose( _index_file );
+      _index_file = nullptr;
+   }
+   _index_size = 0;
+   _blocks_size = 0;
 }
 
 void block_database::flush()
 {
-  _blocks.flush();
-  _block_num_to_pos.flush();
+   wait_for_writes();
+   std::lock_guard<std::mutex> guard( _write_mutex );
+   if( _blocks_file == nullptr )
+      return;
+   // blocks first, so that a synced index entry never points to unsynced block data
+   sync_file( _blocks_file );
+   sync_file( _index_file );
+   _unsynced_blocks = 0;
+}
+
+block_database::log_view_ptr block_database::current_view()const
+{
+   return std::atomic_load( &_view );
+}
+
+block_database::log_view_ptr block_database::refresh_view()const
+{
+   std::lock_guard<std::mutex> guard( _write_mutex );
+   log_view_ptr view = std::atomic_load( &_view );
+   if( view->index->size == _index_size && view->blocks->size == _blocks_size )
+      return view;
+
+   auto new_view = std::make_shared<log_view>();
+   new_view->index = ( view->index->size == _index_size ) ? view->index
+                                                         : std::make_shared<const mapped_file>( _index_filename,
+                                                                                                _index_size );
+   new_view->blocks = ( view->blocks->size == _blocks_size ) ? view->blocks
+                                                            : std::make_shared<const mapped_file>( _blocks_filename,
+                                                                                                   _blocks_size );
+   view = new_view;
+   std::atomic_store( &_view, view );
+   return view;
+}
+
+bool block_database::read_index_entry( uint32_t block_num, index_entry& e, log_view_ptr& view )const
+{
+   const uint64_t index_pos = sizeof(index_entry) * uint64_t(block_num);
+   view = current_view();
+   if( index_pos + sizeof(index_entry) > view->index->size )
+   {
+      view = refresh_view();
+      if( index_pos + sizeof(index_entry) > view->index->size )
+         return false;
+   }
+   memcpy( (char*)&e, view->index->data + index_pos, sizeof(e) );
+   return true;
+}
+
+optional<signed_block> block_database::read_block( const index_entry& e, log_view_ptr& view )const
+{
+   const uint64_t block_end = e.block_pos.value() + e.block_size.value();
+   if( block_end > view->blocks->size )
+   {
+      view = refresh_view();
+      FC_ASSERT( block_end <= view->blocks->size, "Block ${id} lies beyond the end of the block database",
+                 ("id", e.block_id) );
+   }
+   fc::datastream<const char*> ds( view->blocks->data + e.block_pos.value(), e.block_size.value() );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   FC_ASSERT( result.id() == e.block_id );
+   _blocks_read_pos = block_end;
+   return result;
+}
+
+vector<char> block_database::read_raw_block( const index_entry& e, log_view_ptr& view )const
+{
+   FC_ASSERT( e.block_size.value() > 0, "Block ${id} has been removed from the block database", ("id", e.block_id) );
+   const uint64_t block_end = e.block_pos.value() + e.block_size.value();
+   if( block_end > view->blocks->size )
+   {
+      view = refresh_view();
+      FC_ASSERT( block_end <= view->blocks->size, "Block ${id} lies beyond the end of the block database",
+                 ("id", e.block_id) );
+   }
+   const char* begin = view->blocks->data + e.block_pos.value();
+   // the packed block starts with its header, which is all that is needed to check the id against the index
+   fc::datastream<const char*> ds( begin, e.block_size.value() );
+   signed_block_header header;
+   fc::raw::unpack( ds, header );
+   FC_ASSERT( header.id() == e.block_id, "Block ${id} in the block database does not match its index entry",
+              ("id", e.block_id) );
+   vector<char> result( begin, begin + e.block_size.value() );
+   _blocks_read_pos = block_end;
+   return result;
+}
+
+void block_database::write_index_entry( uint32_t block_num, const index_entry& e )
+{
+   const uint64_t index_pos = sizeof(index_entry) * uint64_t(block_num);
+   write_file( _index_file, index_pos, (const char*)&e, sizeof(e) );
+   if( index_pos + sizeof(e) > _index_size )
+      _index_size = index_pos + sizeof(e);
 }
 
 void block_database::store( const block_id_type& _id, const signed_block& b )
@@ -67,33 +379,84 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       id = b.id();
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
-   _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
-   index_entry e;
-   _blocks.seekp( 0, _blocks.end );
-   auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
-   e.block_size = vec.size();
-   e.block_id   = id;
-   _blocks.write( vec.data(), vec.size() );
-   _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   if( _writer.joinable() )
+      store( id, std::make_shared<const signed_block>( b ) );
+   else // written right away, no need to copy the block
+      store( id, std::shared_ptr<const signed_block>( std::shared_ptr<const signed_block>(), &b ) );
+}
+
+void block_database::store( const block_id_type& _id, std::shared_ptr<const signed_block> b )
+{
+   block_id_type id = _id;
+   if( id == block_id_type() )
+   {
+      id = b->id();
+      elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
+   }
+   auto item = std::make_shared<const queued_block>( queued_block{ id, std::move( b ) } );
+
+   if( !_writer.joinable() )
+   {
+      write_blocks( { item } );
+      return;
+   }
+
+   std::unique_lock<std::mutex> lock( _queue_mutex );
+   _queue_cond.wait( lock, [this] () { return _queue.size() < _max_queued_blocks || _write_error; } );
+   if( _write_error )
+      std::rethrow_exception( _write_error );
+   _queue.push_back( item );
+   _queued_by_num[ block_header::num_from_id( id ) ] = item;
+   _queued_count = _queued_by_num.size();
+   lock.unlock();
+   _queue_cond.notify_all();
+}
+
+void block_database::write_blocks( const std::deque<queued_block_ptr>& blocks )
+{
+   vector<char> data;
+   vector<std::pair<uint64_t, uint32_t>> sizes; // offset in data and size of every block
+   sizes.reserve( blocks.size() );
+   for( const auto& item : blocks )
+   {
+      const size_t offset = data.size();
+      data.resize( offset + fc::raw::pack_size( *item->block ) );
+      fc::datastream<char*> ds( data.data() + offset, data.size() - offset );
+      fc::raw::pack( ds, *item->block );
+      sizes.emplace_back( offset, data.size() - offset );
+   }
+
+   std::lock_guard<std::mutex> guard( _write_mutex );
+   // Write the blocks before their index entries, readers only ever look at blocks referenced by the index
+   write_file( _blocks_file, _blocks_size, data.data(), data.size() );
+   FC_ASSERT( fflush( _blocks_file ) == 0, "Unable to flush block database" );
+   const uint64_t blocks_pos = _blocks_size;
+   _blocks_size += data.size();
+   for( size_t i = 0; i < blocks.size(); ++i )
+   {
+      index_entry e;
+      e.block_pos  = blocks_pos + sizes[i].first;
+      e.block_size = sizes[i].second;
+      e.block_id   = blocks[i]->id;
+      write_index_entry( block_header::num_from_id( e.block_id ), e );
+   }
+   FC_ASSERT( fflush( _index_file ) == 0, "Unable to flush block database" );
 }
 
 void block_database::remove( const block_id_type& id )
 { try {
+   wait_for_writes();
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
+   log_view_ptr view;
+   if( !read_index_entry( block_header::num_from_id(id), e, view ) )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
    if( e.block_id == id )
    {
       e.block_size = 0;
-      _block_num_to_pos.seekp( sizeof(e) * int64_t(block_header::num_from_id(id)) );
-      _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      std::lock_guard<std::mutex> guard( _write_mutex );
+      write_index_entry( block_header::num_from_id(id), e );
+      FC_ASSERT( fflush( _index_file ) == 0, "Unable to flush block database" );
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -102,13 +465,13 @@ bool block_database::contains( const block_id_type& id )const
    if( id == block_id_type() )
       return false;
 
+   if( auto queued = find_queued( block_header::num_from_id(id) ) )
+      return queued->id == id;
+
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
+   log_view_ptr view;
+   if( !read_index_entry( block_header::num_from_id(id), e, view ) )
       return false;
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
    return e.block_id == id && e.block_size.value() > 0;
 }
@@ -116,15 +479,14 @@ bool block_database::contains( const block_id_type& id )const
 block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
+   if( auto queued = find_queued( block_num ) )
+      return queued->id;
+
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_num);
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
+   log_view_ptr view;
+   if( !read_index_entry( block_num, e, view ) )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
    FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
    return e.block_id;
 }
@@ -133,24 +495,20 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
 {
    try
    {
+      if( auto queued = find_queued( block_header::num_from_id(id) ) )
+      {
+         if( queued->id != id ) return optional<signed_block>();
+         return *queued->block;
+      }
+
       index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      log_view_ptr view;
+      if( !read_index_entry( block_header::num_from_id(id), e, view ) )
          return {};
 
-      _block_num_to_pos.seekg( index_pos );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      if (e.block_size.value())
-         _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      return read_block( e, view );
    }
    catch (const fc::exception&)
    {
@@ -165,21 +523,15 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
 {
    try
    {
+      if( auto queued = find_queued( block_num ) )
+         return *queued->block;
+
       index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_num);
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      log_view_ptr view;
+      if( !read_index_entry( block_num, e, view ) )
          return {};
 
-      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      return read_block( e, view );
    }
    catch (const fc::exception&)
    {
@@ -190,38 +542,81 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
+optional<vector<char>> block_database::fetch_raw_by_number( uint32_t block_num )const
+{
+   try
+   {
+      if( auto queued = find_queued( block_num ) )
+         return fc::raw::pack( *queued->block );
+
+      index_entry e;
+      log_view_ptr view;
+      if( !read_index_entry( block_num, e, view ) )
+         return {};
+
+      return read_raw_block( e, view );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<vector<char>>();
+}
+
+optional<vector<char>> block_database::fetch_raw_optional( const block_id_type& id )const
+{
+   try
+   {
+      if( auto queued = find_queued( block_header::num_from_id(id) ) )
+      {
+         if( queued->id != id ) return optional<vector<char>>();
+         return fc::raw::pack( *queued->block );
+      }
+
+      index_entry e;
+      log_view_ptr view;
+      if( !read_index_entry( block_header::num_from_id(id), e, view ) )
+         return {};
+
+      if( e.block_id != id ) return optional<vector<char>>();
+
+      return read_raw_block( e, view );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<vector<char>>();
+}
+
 optional<index_entry> block_database::last_index_entry()const {
    try
    {
       index_entry e;
+      log_view_ptr view = refresh_view();
 
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      std::streampos pos = _block_num_to_pos.tellg();
-      if( pos < long(sizeof(index_entry)) )
+      uint64_t pos = view->index->size;
+      if( pos < sizeof(index_entry) )
          return optional<index_entry>();
 
       pos -= pos % sizeof(index_entry);
 
-      _blocks.seekg( 0, _block_num_to_pos.end );
-      const std::streampos blocks_size = _blocks.tellg();
       while( pos > 0 )
       {
          pos -= sizeof(index_entry);
-         _block_num_to_pos.seekg( pos );
-         _block_num_to_pos.read( (char*)&e, sizeof(e) );
-         if( _block_num_to_pos.gcount() == sizeof(e) && e.block_size.value() > 0
-                && int64_t(e.block_pos.value() + e.block_size.value()) <= blocks_size )
+         memcpy( (char*)&e, view->index->data + pos, sizeof(e) );
+         if( e.block_size.value() > 0 && e.block_pos.value() + e.block_size.value() <= view->blocks->size )
             try
             {
-               vector<char> data( e.block_size.value() );
-               _blocks.seekg( e.block_pos.value() );
-               _blocks.read( data.data(), e.block_size.value() );
-               if( _blocks.gcount() == long(e.block_size.value()) )
-               {
-                  const signed_block block = fc::raw::unpack<signed_block>(data);
-                  if( block.id() == e.block_id )
-                     return e;
-               }
+               fc::datastream<const char*> ds( view->blocks->data + e.block_pos.value(), e.block_size.value() );
+               signed_block block;
+               fc::raw::unpack( ds, block );
+               if( block.id() == e.block_id )
+                  return e;
             }
             catch (const fc::exception&)
             {
@@ -229,7 +624,20 @@ optional<index_entry> block_database::last_index_entry()const {
             catch (const std::exception&)
             {
             }
+         // Drop the invalid tail of the index.  This only happens after an unclean shutdown, i.e. on startup,
+         // before there are concurrent readers which could still access the truncated part of the mapping.
+         std::lock_guard<std::mutex> guard( _write_mutex );
+         const auto blocks = view->blocks;
+         view.reset();
+         std::atomic_store( &_view, std::make_shared<const log_view>() );
+         FC_ASSERT( fflush( _index_file ) == 0, "Unable to flush block database" );
          fc::resize_file( _index_filename, pos );
+         _index_size = pos;
+         auto new_view = std::make_shared<log_view>();
+         new_view->index = std::make_shared<const mapped_file>( _index_filename, _index_size );
+         new_view->blocks = blocks;
+         view = new_view;
+         std::atomic_store( &_view, view );
       }
    }
    catch (const fc::exception&)
@@ -243,6 +651,7 @@ optional<index_entry> block_database::last_index_entry()const {
 
 optional<signed_block> block_database::last()const
 {
+   wait_for_writes();
    optional<index_entry> entry = last_index_entry();
    if( entry.valid() ) return fetch_by_number( block_header::num_from_id(entry->block_id) );
    return optional<signed_block>();
@@ -250,6 +659,7 @@ optional<signed_block> block_database::last()const
 
 optional<block_id_type> block_database::last_id()const
 {
+   wait_for_writes();
    optional<index_entry> entry = last_index_entry();
    if( entry.valid() ) return entry->block_id;
    return optional<block_id_type>();
@@ -257,13 +667,14 @@ optional<block_id_type> block_database::last_id()const
 
 size_t block_database::blocks_current_position()const
 {
-   return (size_t)_blocks.tellg();
+   return _blocks_read_pos;
 }
 
 size_t block_database::total_block_size()const
 {
-   _blocks.seekg( 0, _blocks.end );
-   return (size_t)_blocks.tellg();
+   wait_for_writes();
+   std::lock_guard<std::mutex> guard( _write_mutex );
+   return (size_t)_blocks_size;
 }
 
 } }
@@ -7,6 +7,7 @@
 #include <graphene/chain/hardfork.hpp>
 
 #include <graphene/chain/block_summary_object.hpp>
+#include <graphene/chain/custom_authority_object.hpp>
 #include <graphene/chain/global_property_object.hpp>
 #include <graphene/chain/operation_history_object.hpp>
 
@@ -22,6 +23,15 @@
 
 #include <fc/io/raw.hpp>
 #include <fc/thread/parallel.hpp>
+#include <fc/uint128.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <queue>
 
 namespace graphene { namespace chain {
 
@@ -53,6 +63,17 @@ optional<signed_block> database::fetch_block_by_id( const block_id_type& id )con
    return b->data;
 }
 
+optional<vector<char>> database::fetch_raw_block_by_id( const block_id_type& id )const
+{
+   auto raw = _block_id_to_block.fetch_raw_optional(id);
+   if( raw )
+      return raw;
+   auto b = _fork_db.fetch_block( id );
+   if( b )
+      return fc::raw::pack( b->data );
+   return {};
+}
+
 optional<signed_block> database::fetch_block_by_number( uint32_t num )const
 {
    auto results = _fork_db.fetch_block_by_number(num);
@@ -151,7 +172,7 @@ bool database::_push_block(const signed_block& new_block)
                   undo_database::session session = _undo_db.start_undo_session();
                   apply_block( (*ritr)->data, skip );
                   update_witnesses( **ritr );
-                  _block_id_to_block.store( (*ritr)->id, (*ritr)->data );
+                  _block_id_to_block.store( (*ritr)->id, std::shared_ptr<const signed_block>( *ritr, &(*ritr)->data ) );
                   session.commit();
                }
                catch ( const fc::exception& e ) { except = e; }
@@ -182,12 +203,14 @@ bool database::_push_block(const signed_block& new_block)
                      ilog( "pushing block #${n} ${id}", ("n",(*ritr2)->data.block_num())("id",(*ritr2)->id) );
                      auto session = _undo_db.start_undo_session();
                      apply_block( (*ritr2)->data, skip );
-                     _block_id_to_block.store( (*ritr2)->id, (*ritr2)->data );
+                     _block_id_to_block.store( (*ritr2)->id,
+                                               std::shared_ptr<const signed_block>( *ritr2, &(*ritr2)->data ) );
                      session.commit();
                   }
                   throw *except;
                }
          }
+         checkpoint_object_database_if_due();
          return true;
       }
       else return false;
@@ -198,13 +221,15 @@ bool database::_push_block(const signed_block& new_block)
       apply_block(new_block, skip);
       if( new_block.timestamp.sec_since_epoch() > now - 86400 )
          update_witnesses( *new_head );
-      _block_id_to_block.store(new_block.id(), new_block);
+      // shares the copy held by the fork database instead of copying the block again
+      _block_id_to_block.store( new_head->id, std::shared_ptr<const signed_block>( new_head, &new_head->data ) );
       session.commit();
    } catch ( const fc::exception& e ) {
       elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
       _fork_db.remove( new_block.id() );
       throw;
    }
+   checkpoint_object_database_if_due();
 
    return false;
 } FC_CAPTURE_AND_RETHROW( (new_block) ) } // GCOVR_EXCL_LINE
@@ -259,8 +284,152 @@ processed_transaction database::push_transaction( const precomputable_transactio
    return result;
 } FC_CAPTURE_AND_RETHROW( (trx) ) } // GCOVR_EXCL_LINE
 
+namespace {
+
+struct operation_fee_getter
+{
+   using result_type = std::pair<account_id_type, asset>;
+
+   template<typename T>
+   result_type operator()( const T& op )const { return std::make_pair( op.fee_payer(), op.fee ); }
+};
+
+} // anonymous namespace
+
+database::pending_transaction_info database::get_pending_transaction_info( const precomputable_transaction& trx )const
+{
+   pending_transaction_info info;
+   info.size = trx.get_packed_size();
+   fc::uint128_t core_fees = 0;
+   for( const operation& op : trx.operations )
+   {
+      const auto payer_and_fee = op.visit( operation_fee_getter() );
+      if( info.fee_payer == account_id_type() )
+         info.fee_payer = payer_and_fee.first;
+      const asset& fee = payer_and_fee.second;
+      if( fee.amount <= 0 )
+         continue;
+      if( fee.asset_id == asset_id_type() )
+         core_fees += fee.amount.value;
+      else
+      {
+         const asset_object* fee_asset = find( fee.asset_id );
+         if( fee_asset == nullptr )
+            continue;
+         try
+         {
+            const asset core_fee = fee * fee_asset->options.core_exchange_rate;
+            if( core_fee.amount > 0 )
+               core_fees += core_fee.amount.value;
+         }
+         catch( const fc::exception& )
+         { // invalid fees are rejected when the transaction is applied
+         }
+      }
+   }
+   if( info.size > 0 )
+   {
+      const fc::uint128_t priority = core_fees * 1024 / info.size;
+      const uint64_t max_priority = std::numeric_limits<uint64_t>::max();
+      info.priority = ( priority > max_priority ) ? max_priority : static_cast<uint64_t>( priority );
+   }
+   return info;
+}
+
+void database::make_room_for_pending_transaction( const pending_transaction_info& info )
+{
+   if( _max_pending_tx_per_account > 0 )
+   {
+      auto itr = _pending_tx_per_account.find( info.fee_payer );
+      FC_ASSERT( itr == _pending_tx_per_account.end() || itr->second < _max_pending_tx_per_account,
+                 "Account ${a} has too many pending transactions", ("a", info.fee_payer) );
+   }
+   if( _max_pending_tx_size == 0 || _pending_tx_size + info.size <= _max_pending_tx_size )
+      return;
+   // Evicting rebuilds the pending state, which must not happen while a pending_transactions_restorer is
+   // rebuilding it, e.g. after a block was pushed.  The transactions restored later are dropped instead.
+   FC_ASSERT( _pending_tx_restorers == 0,
+              "Too many pending transactions, not evicting any while the pending transactions are restored" );
+
+   // Evict pending transactions of lower priority than the new one, newest first among equal priorities.
+   // Make room down to 90% of the limit, so that the pending state does not need to be rebuilt for every
+   // new transaction while the limit is reached.
+   const uint64_t target_size = _max_pending_tx_size - _max_pending_tx_size / 10;
+   vector<size_t> by_priority( _pending_tx.size() );
+   for( size_t i = 0; i < by_priority.size(); ++i )
+      by_priority[i] = i;
+   std::sort( by_priority.begin(), by_priority.end(), [this]( size_t a, size_t b ) {
+      return _pending_tx_info[a].priority < _pending_tx_info[b].priority
+             || ( _pending_tx_info[a].priority == _pending_tx_info[b].priority && a > b );
+   });
+
+   vector<bool> evict( _pending_tx.size(), false );
+   uint64_t remaining_size = _pending_tx_size;
+   size_t evicted = 0;
+   for( size_t i : by_priority )
+   {
+      if( remaining_size + info.size <= target_size || _pending_tx_info[i].priority >= info.priority )
+         break;
+      evict[i] = true;
+      remaining_size -= _pending_tx_info[i].size;
+      ++evicted;
+   }
+   FC_ASSERT( remaining_size + info.size <= _max_pending_tx_size,
+              "Too many pending transactions, the fee of the transaction is too low to replace any of them" );
+
+   wlog( "Evicting ${n} pending transactions of low priority", ("n", evicted) );
+   vector<processed_transaction> kept;
+   kept.reserve( _pending_tx.size() - evicted );
+   for( size_t i = 0; i < _pending_tx.size(); ++i )
+      if( !evict[i] )
+         kept.push_back( std::move( _pending_tx[i] ) );
+   // re-apply the remaining transactions on top of the head block
+   detail::without_pending_transactions( *this, std::move( kept ), [](){} );
+}
+
+vector<size_t> database::get_pending_transactions_by_priority()const
+{
+   vector<size_t> result;
+   result.reserve( _pending_tx.size() );
+   if( _pending_tx_info.size() != _pending_tx.size() ) // defensive, should not happen
+   {
+      for( size_t i = 0; i < _pending_tx.size(); ++i )
+         result.push_back( i );
+      return result;
+   }
+
+   // Transactions of the same fee payer stay in arrival order, since later ones may depend on earlier ones
+   std::map<account_id_type, std::deque<size_t>> queues;
+   for( size_t i = 0; i < _pending_tx.size(); ++i )
+      queues[ _pending_tx_info[i].fee_payer ].push_back( i );
+
+   using queue_head = std::pair<uint64_t, size_t>; // priority and index of the first transaction of a queue
+   auto lower = []( const queue_head& a, const queue_head& b ) {
+      return a.first < b.first || ( a.first == b.first && a.second > b.second );
+   };
+   std::priority_queue<queue_head, vector<queue_head>, decltype(lower)> heads( lower );
+   for( const auto& queue : queues )
+      heads.emplace( _pending_tx_info[ queue.second.front() ].priority, queue.second.front() );
+   while( !heads.empty() )
+   {
+      const size_t i = heads.top().second;
+      heads.pop();
+      result.push_back( i );
+      auto& queue = queues[ _pending_tx_info[i].fee_payer ];
+      queue.pop_front();
+      if( !queue.empty() )
+         heads.emplace( _pending_tx_info[ queue.front() ].priority, queue.front() );
+   }
+   return result;
+}
+
 processed_transaction database::_push_transaction( const precomputable_transaction& trx )
 {
+   // Locally generated transactions are exempt from the limits of pending transactions, see push_transaction()
+   const pending_transaction_info info = get_pending_transaction_info( trx );
+   if( 0 == (get_node_properties().skip_flags & skip_block_size_check) )
+      make_room_for_pending_transaction( info );
+
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
    if( !_pending_tx_session.valid() )
@@ -272,8 +441,27 @@ processed_transaction database::_push_transaction( const precomputable_transacti
    // apply the changes.
 
    auto temp_session = _undo_db.start_undo_session();
-   auto processed_trx = _apply_transaction( trx );
+   // Record what the verification of the authorities reads, see pending_transactions_restorer
+   const bool verify_authorities = ( 0 == (get_node_properties().skip_flags & skip_transaction_signatures) );
+   authority_reads reads;
+   _authority_reads = verify_authorities ? &reads : nullptr;
+   processed_transaction processed_trx;
+   try
+   {
+      processed_trx = _apply_transaction( trx );
+   }
+   catch( ... )
+   {
+      _authority_reads = nullptr;
+      throw;
+   }
+   _authority_reads = nullptr;
    _pending_tx.push_back(processed_trx);
+   _pending_tx_info.push_back( info );
+   _pending_tx_size += info.size;
+   ++_pending_tx_per_account[ info.fee_payer ];
+   if( verify_authorities )
+      _pending_tx_authority_reads[ trx.id() ] = std::move( reads );
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
@@ -427,8 +615,10 @@ signed_block database::_generate_block(
    _pending_tx_session = _undo_db.start_undo_session();
 
    uint64_t postponed_tx_count = 0;
-   for( const processed_transaction& tx : _pending_tx )
+   // Include the most valuable transactions first
+   for( size_t pending_index : get_pending_transactions_by_priority() )
    {
+      const processed_transaction& tx = _pending_tx[pending_index];
       size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
       // postpone transaction if it would make block too big
@@ -522,6 +712,10 @@ void database::clear_pending()
 { try {
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
    _pending_tx.clear();
+   _pending_tx_info.clear();
+   _pending_tx_size = 0;
+   _pending_tx_per_account.clear();
+   _pending_tx_authority_reads.clear();
    _pending_tx_session.reset();
 } FC_CAPTURE_AND_RETHROW() } // GCOVR_EXCL_LINE
 
@@ -570,6 +764,228 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    return;
 }
 
+/// Outcome of verifying the authorities of a transaction before the transactions ahead of it in its block were applied
+struct authority_speculation
+{
+   bool                       verified = false;
+   /// Accounts whose active or owner authorities were read by the verification
+   flat_set<account_id_type>  accounts;
+};
+
+/**
+ * Verifies the authorities of the transactions of a block on worker threads while the transactions are applied.
+ *
+ * The verifications do not read the database, which is modified meanwhile, but a read-only snapshot of the
+ * authorities they may need, taken before the block is applied.  The thread applying the transactions fetches the
+ * results in block order with @ref get, verifying transactions itself if the workers have not started them yet.
+ */
+class authority_speculations
+{
+   public:
+      struct account_authorities
+      {
+         authority active;
+         authority owner;
+      };
+
+      authority_speculations( const vector<processed_transaction>& trxs, const chain_id_type& chain_id,
+                              bool allow_non_immediate_owner, bool ignore_custom_op_reqd_auths,
+                              uint32_t max_authority_depth )
+      : _trxs( trxs ), _chain_id( chain_id ), _allow_non_immediate_owner( allow_non_immediate_owner ),
+        _ignore_custom_op_reqd_auths( ignore_custom_op_reqd_auths ), _max_authority_depth( max_authority_depth ),
+        _results( trxs.size() ), _done( trxs.size(), false )
+      {}
+
+      ~authority_speculations()
+      {
+         stop();
+      }
+
+      /// Copies the authorities which the verification of the transactions may read from @p db
+      void take_snapshot( const database& db )
+      {
+         const auto& custom_idx = db.get_index_type<custom_authority_index>().indices().get<by_account_custom>();
+         flat_set<account_id_type> accounts;
+         vector<authority> other;
+         for( const auto& trx : _trxs )
+            trx.get_required_authorities( accounts, accounts, other, _ignore_custom_op_reqd_auths );
+
+         // accounts of the current level of the authority walk
+         vector<account_id_type> level;
+         auto add_authority = [this,&level]( const authority& auth ) {
+            for( const auto& a : auth.account_auths )
+               if( _snapshot.find( a.first ) == _snapshot.end() )
+                  level.push_back( a.first );
+         };
+         for( const auto& auth : other )
+            add_authority( auth );
+         level.insert( level.end(), accounts.begin(), accounts.end() );
+
+         for( uint32_t depth = 0; depth <= _max_authority_depth && !level.empty(); ++depth )
+         {
+            vector<account_id_type> current;
+            std::swap( current, level );
+            for( const account_id_type id : current )
+            {
+               const account_object* account = db.find( id );
+               if( account == nullptr || _snapshot.find( id ) != _snapshot.end() )
+                  continue;
+               _snapshot[id] = account_authorities{ account->active, account->owner };
+               auto custom = custom_idx.lower_bound( id );
+               if( custom != custom_idx.end() && custom->account == id )
+                  _accounts_with_custom_authorities.insert( id );
+               add_authority( account->active );
+               add_authority( account->owner );
+            }
+         }
+      }
+
+      /// Starts verifying in @p num_workers threads of the thread pool
+      void start( size_t num_workers )
+      {
+         _workers.reserve( num_workers );
+         for( size_t t = 0; t < num_workers; ++t )
+         {
+            auto done = std::make_shared<std::promise<void>>();
+            _workers.push_back( done->get_future() );
+            fc::do_parallel( [this,done]() {
+               for( size_t i = _next_trx++; i < _trxs.size(); i = _next_trx++ )
+                  verify( i );
+               done->set_value();
+            });
+         }
+      }
+
+      /// Returns the result of transaction @p trx_in_block, waiting for it if it is being verified by a worker
+      const authority_speculation& get( size_t trx_in_block )
+      {
+         for( size_t next = _next_trx; next <= trx_in_block; next = _next_trx )
+         {
+            const size_t i = _next_trx++;
+            if( i < _trxs.size() )
+               verify( i );
+         }
+         // Block instead of waiting on a fc::future, which would let other tasks of this thread run
+         std::unique_lock<std::mutex> lock( _mutex );
+         _verified.wait( lock, [this,trx_in_block]() { return _done[trx_in_block]; } );
+         return _results[trx_in_block];
+      }
+
+      /// Skips the verifications which have not started yet and waits for the workers to finish
+      void stop()
+      {
+         _next_trx = _trxs.size();
+         for( auto& worker : _workers )
+            worker.wait();
+         _workers.clear();
+      }
+
+   private:
+      void verify( size_t i )
+      {
+         authority_speculation& result = _results[i];
+         auto get_authorities = [this,&result]( account_id_type id ) -> const account_authorities& {
+            result.accounts.insert( id );
+            auto itr = _snapshot.find( id );
+            FC_ASSERT( itr != _snapshot.end(), "Account is not in the authority snapshot" );
+            return itr->second;
+         };
+         auto get_active = [&get_authorities]( account_id_type id ) { return &get_authorities( id ).active; };
+         auto get_owner  = [&get_authorities]( account_id_type id ) { return &get_authorities( id ).owner; };
+         // Custom authorities cache their predicates lazily, which is not thread safe, so transactions which
+         // may need them are left to the serial verification
+         auto get_custom = [this]( account_id_type id, const operation&, rejected_predicate_map* ) {
+            FC_ASSERT( _accounts_with_custom_authorities.find( id ) == _accounts_with_custom_authorities.end(),
+                       "Custom authorities are not verified speculatively" );
+            return vector<authority>();
+         };
+         try
+         {
+            _trxs[i].verify_authority( _chain_id, get_active, get_owner, get_custom, _allow_non_immediate_owner,
+                                       _ignore_custom_op_reqd_auths, _max_authority_depth );
+            result.verified = true;
+         }
+         catch( ... )
+         {
+            // verified again when the transaction is applied, which reports the error
+         }
+
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _done[i] = true;
+         }
+         _verified.notify_all();
+      }
+
+      const vector<processed_transaction>&             _trxs;
+      const chain_id_type                              _chain_id;
+      const bool                                       _allow_non_immediate_owner;
+      const bool                                       _ignore_custom_op_reqd_auths;
+      const uint32_t                                   _max_authority_depth;
+
+      /// Read-only while the verifications are running
+      flat_map<account_id_type, account_authorities>   _snapshot;
+      flat_set<account_id_type>                        _accounts_with_custom_authorities;
+
+      vector<authority_speculation>                    _results;
+      std::atomic<size_t>                              _next_trx{ 0 };
+      std::mutex                                       _mutex;
+      std::condition_variable                          _verified;
+      /// Whether the result of each transaction is available, guarded by @ref _mutex
+      vector<bool>                                     _done;
+      vector<std::future<void>>                        _workers;
+};
+
+namespace {
+
+/**
+ * Tracks the objects written while the transactions of a block are applied, to tell whether an authority
+ * speculation is still valid, i.e. whether nothing it has read was changed by an earlier transaction in the block.
+ */
+class speculation_validator
+{
+   public:
+      speculation_validator( database& db, const std::shared_ptr<authority_speculations>& speculations )
+      : _speculations( speculations )
+      {
+         if( _speculations )
+            _tracker.reset( new detail::authority_write_tracker( db ) );
+      }
+      ~speculation_validator()
+      {
+         if( _speculations )
+            _speculations->stop();
+      }
+
+      bool is_valid( size_t trx_in_block )
+      {
+         if( !_speculations )
+            return false;
+         const authority_speculation& speculation = _speculations->get( trx_in_block );
+         return speculation.verified && _tracker->unchanged( speculation.accounts );
+      }
+
+   private:
+      std::shared_ptr<authority_speculations>            _speculations;
+      std::unique_ptr<detail::authority_write_tracker>   _tracker;
+};
+
+} // anonymous namespace
+
+std::shared_ptr<authority_speculations> database::speculate_authorities( const vector<processed_transaction>& trxs )const
+{
+   if( !_parallel_authority_checks || trxs.size() < 2 )
+      return nullptr;
+
+   auto speculations = std::make_shared<authority_speculations>( trxs, get_chain_id(),
+                                                                 head_block_time() >= HARDFORK_CORE_584_TIME,
+                                                                 MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( head_block_time() ),
+                                                                 get_global_properties().parameters.max_authority_depth );
+   speculations->take_snapshot( *this );
+   speculations->start( std::min<size_t>( fc::asio::default_io_service_scope::get_num_threads(), trxs.size() ) );
+   return speculations;
+}
+
 void database::_apply_block( const signed_block& next_block )
 { try {
    uint32_t next_block_num = next_block.block_num();
@@ -606,16 +1022,28 @@ void database::_apply_block( const signed_block& next_block )
    _issue_453_affected_assets.clear();
 
    signed_block processed_block( next_block ); // make a copy
-   for( auto& trx : processed_block.transactions )
+
+   // Authorities of all transactions are verified in parallel against the state before the block, while the
+   // transactions are applied.  A transaction is applied without verifying them again, unless an earlier
+   // transaction has changed what was read.
+   std::shared_ptr<authority_speculations> speculations;
+   if( 0 == (skip & skip_transaction_signatures) )
+      speculations = speculate_authorities( processed_block.transactions );
    {
-      /* We do not need to push the undo state for each transaction
-       * because they either all apply and are valid or the
-       * entire block fails to apply.  We only need an "undo" state
-       * for transactions when validating broadcast transactions or
-       * when building a block.
-       */
-      trx.operation_results = apply_transaction( trx, skip ).operation_results;
-      ++_current_trx_in_block;
+      speculation_validator validator( *this, speculations );
+      for( auto& trx : processed_block.transactions )
+      {
+         /* We do not need to push the undo state for each transaction
+          * because they either all apply and are valid or the
+          * entire block fails to apply.  We only need an "undo" state
+          * for transactions when validating broadcast transactions or
+          * when building a block.
+          */
+         const uint32_t trx_skip = validator.is_valid( _current_trx_in_block ) ? ( skip | skip_transaction_signatures )
+                                                                                : skip;
+         trx.operation_results = apply_transaction( trx, trx_skip ).operation_results;
+         ++_current_trx_in_block;
+      }
    }
 
    _current_op_in_trx    = 0;
@@ -697,10 +1125,21 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
    if( 0 == (skip & skip_transaction_signatures) )
    {
       bool allow_non_immediate_owner = ( head_block_time() >= HARDFORK_CORE_584_TIME );
-      auto get_active = [this]( account_id_type id ) { return &id(*this).active; };
-      auto get_owner  = [this]( account_id_type id ) { return &id(*this).owner;  };
+      auto get_active = [this]( account_id_type id ) {
+         if( _authority_reads != nullptr )
+            _authority_reads->accounts.insert( id );
+         return &id(*this).active;
+      };
+      auto get_owner  = [this]( account_id_type id ) {
+         if( _authority_reads != nullptr )
+            _authority_reads->accounts.insert( id );
+         return &id(*this).owner;
+      };
       auto get_custom = [this]( account_id_type id, const operation& op, rejected_predicate_map* rejects ) {
-         return get_viable_custom_authorities(id, op, rejects);
+         vector<authority> viable = get_viable_custom_authorities(id, op, rejects);
+         if( _authority_reads != nullptr && !viable.empty() )
+            _authority_reads->custom_authorities = true;
+         return viable;
       };
 
       trx.verify_authority(chain_id, get_active, get_owner, get_custom, allow_non_immediate_owner,
@@ -903,6 +1342,16 @@ fc::future<void> database::precompute_parallel( const signed_block& block, const
    return *first;
 } FC_LOG_AND_RETHROW() }
 
+void database::_precompute_block( const signed_block& block, const uint32_t skip )const
+{
+   _precompute_parallel( block.transactions.data(), block.transactions.size(), skip );
+   if( 0 == (skip&skip_witness_signature) )
+      block.signee();
+   if( 0 == (skip&skip_merkle_check) )
+      block.calculate_merkle_root();
+   block.id();
+}
+
 fc::future<void> database::precompute_parallel( const precomputable_transaction& trx )const
 {
    return fc::do_parallel([this,&trx] () {
@@ -2,8 +2,13 @@
  * Acloudbank
  */
 
+#include <fc/asio.hpp>
+#include <fc/thread/parallel.hpp>
 #include <fc/uint128.hpp>
 
+#include <future>
+#include <memory>
+
 #include <graphene/protocol/market.hpp>
 
 #include <graphene/chain/database.hpp>
@@ -55,8 +60,9 @@ vector<std::reference_wrapper<const typename Index::object_type>> database::sort
 }
 
 template<class Type>
-void database::perform_account_maintenance(Type tally_helper)
+void database::perform_account_maintenance(Type& tally_helper)
 {
+   auto phase_start = fc::time_point::now();
    const auto& bal_idx = get_index_type< account_balance_index >().indices().get< by_maintenance_flag >();
    if( bal_idx.begin() != bal_idx.end() )
    {
@@ -77,14 +83,89 @@ void database::perform_account_maintenance(Type tally_helper)
       }
    }
 
+   auto now = fc::time_point::now();
+   _chain_maintenance_stats.balances_us = ( now - phase_start ).count();
+   phase_start = now;
+
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_maintenance_seq >();
    auto stats_itr = stats_idx.lower_bound( true );
 
+   const size_t num_threads = fc::asio::default_io_service_scope::get_num_threads();
+   if( _parallel_vote_tally && tally_helper.can_tally_in_parallel() && num_threads > 1 )
+   {
+      // The accounts are processed in the same order as in the serial loop below
+      vector< std::pair<const account_object*, const account_statistics_object*> > accounts;
+      for( ; stats_itr != stats_idx.end(); ++stats_itr )
+         accounts.emplace_back( &stats_itr->owner( *this ), &*stats_itr );
+
+      // Every worker tallies a contiguous range of accounts into buffers of its own.  Nothing is modified until
+      // all workers are done, so they only read the database.
+      using buffers_type = typename Type::tally_buffers;
+      using update_type = typename Type::voting_power_update;
+      const size_t min_accounts_per_worker = 256;
+      const size_t chunks = std::max<size_t>( 1, std::min( num_threads, accounts.size() / min_accounts_per_worker ) );
+      const size_t chunk_size = ( accounts.size() + chunks - 1 ) / chunks;
+      vector< buffers_type > buffers( chunks, tally_helper.new_buffers() );
+      vector< optional<update_type> > updates( accounts.size() );
+      const auto tally_range = [&tally_helper,&accounts,&updates,&buffers,chunk_size]( size_t chunk ) {
+         const size_t end = std::min( accounts.size(), ( chunk + 1 ) * chunk_size );
+         for( size_t i = chunk * chunk_size; i < end; ++i )
+            if( accounts[i].second->has_some_core_voting() )
+               updates[i] = tally_helper.tally( *accounts[i].first, *accounts[i].second, buffers[chunk] );
+      };
+      if( chunks == 1 )
+         tally_range( 0 );
+      else
+      {
+         vector< std::future<void> > workers;
+         workers.reserve( chunks );
+         for( size_t chunk = 0; chunk < chunks; ++chunk )
+         {
+            auto done = std::make_shared< std::promise<void> >();
+            workers.push_back( done->get_future() );
+            fc::do_parallel( [&tally_range,chunk,done] () {
+               try { tally_range( chunk ); done->set_value(); }
+               catch( ... ) { done->set_exception( std::current_exception() ); }
+            });
+         }
+         // Block instead of waiting on fc::future, which would let other tasks of this thread run in the middle of
+         // the maintenance.  The workers reference local data, so wait for all of them before rethrowing.
+         std::exception_ptr error;
+         for( auto& worker : workers )
+         {
+            try { worker.get(); } catch( ... ) { if( !error ) error = std::current_exception(); }
+         }
+         if( error )
+            std::rethrow_exception( error );
+      }
+      // sums of integers, the result does not depend on how the accounts were split
+      for( const auto& b : buffers )
+         tally_helper.add( b );
+
+      now = fc::time_point::now();
+      _chain_maintenance_stats.tally_us = ( now - phase_start ).count();
+      _chain_maintenance_stats.tally_threads = chunks;
+      phase_start = now;
+
+      for( size_t i = 0; i < accounts.size(); ++i )
+      {
+         if( updates[i].valid() )
+            tally_helper.apply( *updates[i] );
+         if( accounts[i].second->has_pending_fees() )
+            accounts[i].second->process_fees( *accounts[i].first, *this );
+      }
+      _chain_maintenance_stats.accounts = accounts.size();
+      _chain_maintenance_stats.account_updates_us = ( fc::time_point::now() - phase_start ).count();
+      return;
+   }
+
+   uint32_t count = 0;
    while( stats_itr != stats_idx.end() )
    {
       const account_statistics_object& acc_stat = *stats_itr;
       const account_object& acc_obj = acc_stat.owner( *this );
       ++stats_itr;
+      ++count;
 
       if( acc_stat.has_some_core_voting() )
          tally_helper( acc_obj, acc_stat );
@@ -93,6 +174,10 @@ void database::perform_account_maintenance(Type tally_helper)
          acc_stat.process_fees( acc_obj, *this );
    }
 
+   _chain_maintenance_stats.accounts = count;
+   _chain_maintenance_stats.tally_threads = 0;
+   _chain_maintenance_stats.tally_us = ( fc::time_point::now() - phase_start ).count();
+   _chain_maintenance_stats.account_updates_us = 0;
 }
 
 /// @brief A visitor for @ref worker_type which calls pay_worker on the worker within
@@ -1225,6 +1310,7 @@ namespace detail {
 
 void database::perform_chain_maintenance( const signed_block& next_block )
 {
+   const auto maintenance_start = fc::time_point::now();
    const auto& gpo = get_global_properties();
    const auto& dgpo = get_dynamic_global_properties();
    auto last_vote_tally_time = head_block_time();
@@ -1233,6 +1319,25 @@ void database::perform_chain_maintenance( const signed_block& next_block )
    create_buyback_orders(*this);
 
    struct vote_tally_helper {
+      /// Sums of voting stake, moved to the buffers of the database of the same names by @ref finish
+      struct tally_buffers
+      {
+         vector<uint64_t>       vote_tally;
+         vector<uint64_t>       witness_count_histogram;
+         vector<uint64_t>       committee_count_histogram;
+         std::array<uint64_t,2> total_voting_stake {{ 0, 0 }}; // 0=committee, 1=witness
+      };
+      /// Voting power to add to the statistics of an opinion account
+      struct voting_power_update
+      {
+         const account_statistics_object* stats;
+         uint64_t vp_all;
+         uint64_t vp_active;
+         uint64_t vp_committee;
+         uint64_t vp_witness;
+         uint64_t vp_worker;
+      };
+
       database& d;
       const global_property_object& props;
       const dynamic_global_property_object& dprops;
@@ -1250,17 +1355,15 @@ void database::perform_chain_maintenance( const signed_block& next_block )
       optional<detail::vote_recalc_times> worker_recalc_times;
       optional<detail::vote_recalc_times> delegator_recalc_times;
 
+      tally_buffers totals;
+
       explicit vote_tally_helper( database& db )
          : d(db), props( d.get_global_properties() ), dprops( d.get_dynamic_global_properties() ),
            now( d.head_block_time() ), hf2103_passed( HARDFORK_CORE_2103_PASSED( now ) ),
            hf2262_passed( HARDFORK_CORE_2262_PASSED( now ) ),
            pob_activated( dprops.total_pob > 0 || dprops.total_inactive > 0 )
       {
-         d._vote_tally_buffer.resize( props.next_available_vote_id, 0 );
-         d._witness_count_histogram_buffer.resize( (props.parameters.maximum_witness_count / two) + 1, 0 );
-         d._committee_count_histogram_buffer.resize( (props.parameters.maximum_committee_count / two) + 1, 0 );
-         d._total_voting_stake[vid_committee] = 0;
-         d._total_voting_stake[vid_witness] = 0;
+         totals = new_buffers();
          if( hf2103_passed )
          {
             witness_recalc_times   = detail::vote_recalc_options::witness().get_vote_recalc_times( now );
@@ -1270,11 +1373,36 @@ void database::perform_chain_maintenance( const signed_block& next_block )
          }
       }
 
+      tally_buffers new_buffers()const
+      {
+         tally_buffers result;
+         result.vote_tally.resize( props.next_available_vote_id, 0 );
+         result.witness_count_histogram.resize( (props.parameters.maximum_witness_count / two) + 1, 0 );
+         result.committee_count_histogram.resize( (props.parameters.maximum_committee_count / two) + 1, 0 );
+         return result;
+      }
+
+      /**
+       * Whether all accounts can be tallied before the fees of any account are processed.  Before hard fork
+       * core-2262 the balances of cashback vesting balances count as voting stake, and processing the fees of an
+       * account pays into the cashback vesting balances of other accounts, so accounts have to be tallied in turn.
+       */
+      bool can_tally_in_parallel()const { return hf2262_passed; }
+
       void operator()( const account_object& stake_account, const account_statistics_object& stats )
+      {
+         auto update = tally( stake_account, stats, totals );
+         if( update.valid() )
+            apply( *update );
+      }
+
+      /// Adds the voting stake of @p stake_account to @p out, only reads the database
+      optional<voting_power_update> tally( const account_object& stake_account,
+                                           const account_statistics_object& stats, tally_buffers& out )const
       {
          // PoB activation
          if( pob_activated && stats.total_core_pob == 0 && stats.total_core_inactive == 0 )
-            return;
+            return {};
 
          if( props.parameters.count_non_member_votes || stake_account.is_member( now ) )
          {
@@ -1348,7 +1476,7 @@ void database::perform_chain_maintenance( const signed_block& next_block )
 
             // Shortcut
             if( 0 == voting_stake[vid_worker] )
-               return;
+               return {};
 
             const auto& opinion_account_stats = ( directly_voting ? stats : opinion_account.statistics( d ) );
 
@@ -1388,35 +1516,13 @@ void database::perform_chain_maintenance( const signed_block& next_block )
                vp_worker = voting_stake[vid_worker];
             }
 
-            // update voting power
-            d.modify( opinion_account_stats, [vp_all,vp_active,vp_committee,vp_witness,vp_worker,this]
-                                             ( account_statistics_object& update_stats ) {
-               if (update_stats.vote_tally_time != now)
-               {
-                  update_stats.vp_all = vp_all;
-                  update_stats.vp_active = vp_active;
-                  update_stats.vp_committee = vp_committee;
-                  update_stats.vp_witness = vp_witness;
-                  update_stats.vp_worker = vp_worker;
-                  update_stats.vote_tally_time = now;
-               }
-               else
-               {
-                  update_stats.vp_all += vp_all;
-                  update_stats.vp_active += vp_active;
-                  update_stats.vp_committee += vp_committee;
-                  update_stats.vp_witness += vp_witness;
-                  update_stats.vp_worker += vp_worker;
-               }
-            });
-
             for( vote_id_type id : opinion_account.options.votes )
             {
                uint32_t offset = id.instance();
                uint32_t type = std::min( id.type(), vote_id_type::vote_type::worker ); // cap the data
                // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset < d._vote_tally_buffer.size() )
-                  d._vote_tally_buffer[offset] += voting_stake[type];
+               if( offset < out.vote_tally.size() )
+                  out.vote_tally[offset] += voting_stake[type];
             }
 
             // votes for a number greater than maximum_witness_count are skipped here
@@ -1424,25 +1530,76 @@ void database::perform_chain_maintenance( const signed_block& next_block )
                   && opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
             {
                uint16_t offset = opinion_account.options.num_witness / two;
-               d._witness_count_histogram_buffer[offset] += voting_stake[vid_witness];
+               out.witness_count_histogram[offset] += voting_stake[vid_witness];
             }
             // votes for a number greater than maximum_committee_count are skipped here
             if( num_committee_voting_stake > 0
                   && opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
             {
                uint16_t offset = opinion_account.options.num_committee / two;
-               d._committee_count_histogram_buffer[offset] += num_committee_voting_stake;
+               out.committee_count_histogram[offset] += num_committee_voting_stake;
             }
 
-            d._total_voting_stake[vid_committee] += num_committee_voting_stake;
-            d._total_voting_stake[vid_witness] += voting_stake[vid_witness];
+            out.total_voting_stake[vid_committee] += num_committee_voting_stake;
+            out.total_voting_stake[vid_witness] += voting_stake[vid_witness];
+
+            return voting_power_update{ &opinion_account_stats, vp_all, vp_active, vp_committee, vp_witness,
+                                        vp_worker };
          }
+         return {};
+      }
+
+      /// Updates the voting power of the opinion account, in the order the accounts were tallied
+      void apply( const voting_power_update& update )const
+      {
+         d.modify( *update.stats, [&update,this]( account_statistics_object& update_stats ) {
+            if (update_stats.vote_tally_time != now)
+            {
+               update_stats.vp_all = update.vp_all;
+               update_stats.vp_active = update.vp_active;
+               update_stats.vp_committee = update.vp_committee;
+               update_stats.vp_witness = update.vp_witness;
+               update_stats.vp_worker = update.vp_worker;
+               update_stats.vote_tally_time = now;
+            }
+            else
+            {
+               update_stats.vp_all += update.vp_all;
+               update_stats.vp_active += update.vp_active;
+               update_stats.vp_committee += update.vp_committee;
+               update_stats.vp_witness += update.vp_witness;
+               update_stats.vp_worker += update.vp_worker;
+            }
+         });
+      }
+
+      /// Adds the sums of @p other to the totals
+      void add( const tally_buffers& other )
+      {
+         for( size_t i = 0; i < other.vote_tally.size(); ++i )
+            totals.vote_tally[i] += other.vote_tally[i];
+         for( size_t i = 0; i < other.witness_count_histogram.size(); ++i )
+            totals.witness_count_histogram[i] += other.witness_count_histogram[i];
+         for( size_t i = 0; i < other.committee_count_histogram.size(); ++i )
+            totals.committee_count_histogram[i] += other.committee_count_histogram[i];
+         totals.total_voting_stake[vid_committee] += other.total_voting_stake[vid_committee];
+         totals.total_voting_stake[vid_witness] += other.total_voting_stake[vid_witness];
+      }
+
+      /// Moves the totals to the buffers of the database
+      void finish()
+      {
+         d._vote_tally_buffer = std::move( totals.vote_tally );
+         d._witness_count_histogram_buffer = std::move( totals.witness_count_histogram );
+         d._committee_count_histogram_buffer = std::move( totals.committee_count_histogram );
+         d._total_voting_stake = totals.total_voting_stake;
       }
    };
 
    vote_tally_helper tally_helper(*this);
 
    perform_account_maintenance( tally_helper );
+   tally_helper.finish();
 
    struct clear_canary {
       explicit clear_canary(vector<uint64_t>& target): target(target){}
@@ -1455,10 +1612,12 @@ void database::perform_chain_maintenance( const signed_block& next_block )
    clear_canary b(_committee_count_histogram_buffer);
    clear_canary c(_vote_tally_buffer);
 
+   const auto vote_updates_start = fc::time_point::now();
    update_top_n_authorities(*this);
    update_active_witnesses();
    update_active_committee_members();
    update_worker_votes();
+   _chain_maintenance_stats.vote_updates_us = ( fc::time_point::now() - vote_updates_start ).count();
 
    modify(gpo, [&dgpo](global_property_object& p) {
       // Remove scaling of account registration fee
@@ -1575,6 +1734,13 @@ void database::perform_chain_maintenance( const signed_block& next_block )
    // process_budget needs to run at the bottom because
    //   it needs to know the next_maintenance_time
    process_budget();
+
+   const auto& stats = _chain_maintenance_stats;
+   _chain_maintenance_stats.total_us = ( fc::time_point::now() - maintenance_start ).count();
+   dlog( "Chain maintenance of ${n} accounts took ${t}us: balances ${b}us, tally ${v}us on ${w} threads, "
+         "account updates ${a}us, vote updates ${u}us",
+         ("n",stats.accounts)("t",stats.total_us)("b",stats.balances_us)("v",stats.tally_us)
+         ("w",stats.tally_threads)("a",stats.account_updates_us)("u",stats.vote_updates_us) );
 }
 
 } }
@@ -11,13 +11,15 @@
 
 #include <graphene/protocol/fee_schedule.hpp>
 
+#include <fc/asio.hpp>
 #include <fc/io/fstream.hpp>
+#include <fc/thread/parallel.hpp>
 
+#include <atomic>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <queue>
-#include <tuple>
 
 namespace graphene { namespace chain {
 
@@ -30,6 +32,8 @@ database::database()
 database::~database()
 {
    clear_pending();
+   // the checkpoint writer may still access the block database
+   wait_for_checkpoint();
 }
 
 void database::reindex( fc::path data_dir )
@@ -56,87 +60,186 @@ void database::reindex( fc::path data_dir )
    else
       _undo_db.disable();
 
-   uint32_t skip = node_properties().skip_flags;
+   const uint32_t initial_skip = node_properties().skip_flags;
+
+   uint32_t lookahead = _reindex_lookahead;
+   if( lookahead == 0 )
+      lookahead = std::max( 20u, 4u * fc::asio::default_io_service_scope::get_num_threads() );
+   ilog( "Preparing up to ${n} blocks ahead of the one being applied", ("n",lookahead) );
+
+   /// A block making its way through the replay pipeline
+   struct replay_item
+   {
+      uint32_t         block_num;
+      size_t           block_pos;
+      uint32_t         skip;
+      vector<char>     packed;
+      signed_block     block;
+      bool             decoded = false;
+      fc::future<void> prepared;
+   };
+   /// Time spent in each stage of the pipeline, summed over all threads
+   struct replay_stats
+   {
+      std::atomic<int64_t> read_us{0};
+      std::atomic<int64_t> decode_us{0};
+      std::atomic<int64_t> precompute_us{0};
+      std::atomic<int64_t> apply_us{0};
+   } stats;
+   const auto log_stats = [&stats]( uint32_t count ) {
+      const auto per_sec = [count]( const std::atomic<int64_t>& us ) {
+         return us > 0 ? uint64_t( 1000000.0 * count / us ) : 0;
+      };
+      ilog( "   [stage throughput in blocks/sec/thread: read ${r}, decode ${d}, precompute ${p}, apply ${a}]",
+            ("r", per_sec( stats.read_us ))("d", per_sec( stats.decode_us ))
+            ("p", per_sec( stats.precompute_us ))("a", per_sec( stats.apply_us )) );
+   };
 
    size_t total_block_size = _block_id_to_block.total_block_size();
    const auto& gpo = get_global_properties();
-   std::queue< std::tuple< size_t, signed_block, fc::future< void > > > blocks;
-   uint32_t next_block_num = head_block_num() + 1;
+   const fc::time_point_sec dupe_check_start = last_block->timestamp - gpo.parameters.maximum_time_until_expiration;
+   std::deque< replay_item > blocks; // note: references to elements stay valid on push_back() and pop_front()
+   // make sure no worker still references a queued block when we leave
+   const auto drain = [&blocks]() {
+      for( auto& queued : blocks )
+      {
+         try { queued.prepared.wait(); } catch( ... ) {}
+      }
+      blocks.clear();
+   };
+   const uint32_t first_block_num = head_block_num() + 1;
+   uint32_t next_block_num = first_block_num;
    uint32_t i = next_block_num;
-   while( next_block_num <= last_block_num || !blocks.empty() )
+   bool gap_found = false;
+   try
    {
-      if( next_block_num <= last_block_num && blocks.size() < 20 )
+      while( next_block_num <= last_block_num || !blocks.empty() )
       {
-         const size_t processed_block_size = _block_id_to_block.blocks_current_position();
-         fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( next_block_num );
-         ++next_block_num;
-         if( block.valid() )
+         if( next_block_num <= last_block_num && blocks.size() < lookahead )
          {
-            if( block->timestamp >= (last_block->timestamp - gpo.parameters.maximum_time_until_expiration) )
-               skip &= (uint32_t)(~skip_transaction_dupe_check);
-            blocks.emplace( processed_block_size, std::move(*block), fc::future<void>() );
-            std::get<2>(blocks.back()) = precompute_parallel( std::get<1>(blocks.back()), skip );
+            // read stage: copy the packed block out of the block database
+            auto read_start = fc::time_point::now();
+            const size_t processed_block_size = _block_id_to_block.blocks_current_position();
+            fc::optional< vector<char> > packed = _block_id_to_block.fetch_raw_by_number( next_block_num );
+            stats.read_us += ( fc::time_point::now() - read_start ).count();
+            if( !packed.valid() )
+            {
+               // apply what is already queued, then handle the gap
+               gap_found = true;
+               next_block_num = last_block_num + 1; // don't load more blocks
+               continue;
+            }
+            blocks.emplace_back();
+            replay_item& item = blocks.back();
+            item.block_num = next_block_num;
+            item.block_pos = processed_block_size;
+            item.packed = std::move( *packed );
+            // decode and precompute stages run on the thread pool
+            item.prepared = fc::do_parallel( [this,&item,&stats,initial_skip,dupe_check_start] () {
+               auto decode_start = fc::time_point::now();
+               try
+               {
+                  item.block = fc::raw::unpack<signed_block>( item.packed );
+                  item.decoded = ( item.block.block_num() == item.block_num );
+               }
+               catch( const fc::exception& e )
+               {
+                  wlog( "Unable to decode block ${n}: ${e}", ("n",item.block_num)("e",e.to_detail_string()) );
+               }
+               vector<char>().swap( item.packed );
+               auto precompute_start = fc::time_point::now();
+               stats.decode_us += ( precompute_start - decode_start ).count();
+               if( !item.decoded )
+                  return;
+               item.skip = initial_skip;
+               if( item.block.timestamp >= dupe_check_start )
+                  item.skip &= (uint32_t)(~skip_transaction_dupe_check);
+               _precompute_block( item.block, item.skip );
+               stats.precompute_us += ( fc::time_point::now() - precompute_start ).count();
+            });
+            ++next_block_num;
          }
          else
          {
-            wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
-            uint32_t dropped_count = 0;
-            while( true )
+            replay_item& item = blocks.front();
+            item.prepared.wait();
+            if( !item.decoded )
+            {
+               // treat an undecodable block like a missing one
+               drain();
+               gap_found = true;
+               next_block_num = last_block_num + 1; // don't load more blocks
+               continue;
+            }
+            const signed_block& block = item.block;
+
+            if( i % 10000 == 0 )
+            {
+               std::stringstream bysize;
+               std::stringstream bynum;
+               size_t current_pos = item.block_pos;
+               if( current_pos > total_block_size )
+                  total_block_size = current_pos;
+               bysize << std::fixed << std::setprecision(5) << (100 * double(current_pos) / total_block_size);
+               bynum << std::fixed << std::setprecision(5) << (100 * double(i) / last_block_num);
+               ilog(
+                  "   [by size: ${size}%   ${processed} of ${total}]   [by num: ${num}%   ${i} of ${last}]",
+                  ("size", bysize.str())
+                  ("processed", current_pos)
+                  ("total", total_block_size)
+                  ("num", bynum.str())
+                  ("i", i)
+                  ("last", last_block_num)
+               );
+               log_stats( i - first_block_num );
+            }
+            if( i == undo_point )
             {
-               fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
-               // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
-               // OR
-               // we've caught up to the gap
-               if( !last_id.valid() || block_header::num_from_id( *last_id ) <= i )
-                  break;
-               _block_id_to_block.remove( *last_id );
-               ++dropped_count;
+               ilog( "Writing object database to disk at block ${i}, please DO NOT kill the program", ("i", i) );
+               flush();
+               ilog( "Done writing object database to disk" );
             }
-            wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
-            next_block_num = last_block_num + 1; // don't load more blocks
+            auto apply_start = fc::time_point::now();
+            if( i < undo_point )
+            {
+               apply_block( block, item.skip );
+               checkpoint_object_database_if_due();
+            }
+            else
+            {
+               _undo_db.enable();
+               push_block( block, item.skip );
+            }
+            stats.apply_us += ( fc::time_point::now() - apply_start ).count();
+            blocks.pop_front();
+            ++i;
          }
       }
-      else
-      {
-         std::get<2>(blocks.front()).wait();
-         const signed_block& block = std::get<1>(blocks.front());
+   }
+   catch( ... )
+   {
+      drain();
+      throw;
+   }
 
-         if( i % 10000 == 0 )
-         {
-            std::stringstream bysize;
-            std::stringstream bynum;
-            size_t current_pos = std::get<0>(blocks.front());
-            if( current_pos > total_block_size )
-               total_block_size = current_pos;
-            bysize << std::fixed << std::setprecision(5) << (100 * double(current_pos) / total_block_size);
-            bynum << std::fixed << std::setprecision(5) << (100 * double(i) / last_block_num);
-            ilog(
-               "   [by size: ${size}%   ${processed} of ${total}]   [by num: ${num}%   ${i} of ${last}]",
-               ("size", bysize.str())
-               ("processed", current_pos)
-               ("total", total_block_size)
-               ("num", bynum.str())
-               ("i", i)
-               ("last", last_block_num)
-            );
-         }
-         if( i == undo_point )
-         {
-            ilog( "Writing object database to disk at block ${i}, please DO NOT kill the program", ("i", i) );
-            flush();
-            ilog( "Done writing object database to disk" );
-         }
-         if( i < undo_point )
-            apply_block( block, skip );
-         else
-         {
-            _undo_db.enable();
-            push_block( block, skip );
-         }
-         blocks.pop();
-         ++i;
+   if( gap_found )
+   {
+      wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
+      uint32_t dropped_count = 0;
+      while( true )
+      {
+         fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
+         // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
+         // OR
+         // we've caught up to the gap
+         if( !last_id.valid() || block_header::num_from_id( *last_id ) <= i )
+            break;
+         _block_id_to_block.remove( *last_id );
+         ++dropped_count;
       }
+      wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
    }
+   log_stats( i - first_block_num );
    _undo_db.enable();
    auto end = fc::time_point::now();
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
@@ -179,8 +282,31 @@ void database::open(
       }
 
       object_database::open(data_dir);
+      enable_checkpoints( _object_db_checkpoint_interval > 0 );
 
       _block_id_to_block.open(data_dir / "database" / "block_num_to_block");
+      if( _block_write_queue_size > 0 )
+         _block_id_to_block.start_writer( _block_write_queue_size, _block_sync_interval );
+
+      optional<signed_block> snapshot_head_block;
+      if( !find(global_property_id_type()) && !_snapshot_to_load.empty() )
+      {
+         const auto packed_head_block = object_database::load_snapshot( _snapshot_to_load );
+         FC_ASSERT( !packed_head_block.empty(), "The snapshot does not contain its head block" );
+         snapshot_head_block = fc::raw::unpack<signed_block>( packed_head_block );
+         const auto& snapshot_dgp = get( dynamic_global_property_id_type() );
+         FC_ASSERT( snapshot_head_block->id() == snapshot_dgp.head_block_id,
+                    "The head block of the snapshot does not match its objects",
+                    ("block",snapshot_head_block->id())("head_block_id",snapshot_dgp.head_block_id) );
+         // Blocks before the snapshot are unknown, the head block is the first one stored.  It lets peers
+         // build a synopsis of our chain and is the root of the fork database.
+         if( !_block_id_to_block.contains( snapshot_head_block->id() ) )
+            _block_id_to_block.store( snapshot_head_block->id(), *snapshot_head_block );
+         _block_id_to_block.flush();
+         // save the loaded objects right away, checkpoints only contain the changes made after this point
+         object_database::flush();
+         ilog( "Loaded the object database at block ${n} from a snapshot", ("n",snapshot_dgp.head_block_number) );
+      }
 
       if( !find(global_property_id_type()) )
          init_genesis(genesis_loader());
@@ -202,11 +328,35 @@ void database::open(
                     ("last_block->id", last_block)("head_block_id",head_block_num()) );
          reindex( data_dir );
       }
+      // unless blocks after the snapshot have been replayed, blocks are pushed on top of the snapshot
+      if( snapshot_head_block.valid() && !_fork_db.head() )
+         _fork_db.start_block( *snapshot_head_block );
       _opened = true;
    }
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
 }
 
+std::shared_ptr<const graphene::db::object_snapshot> database::take_snapshot()const
+{ try {
+   // the head block is still only in the fork database while its applied_block signal is emitted
+   const auto head_block = fetch_block_by_id( head_block_id() );
+   FC_ASSERT( head_block.valid(), "Head block ${id} not found", ("id",head_block_id()) );
+   return object_database::take_snapshot( fc::raw::pack( *head_block ) );
+} FC_CAPTURE_AND_RETHROW() }
+
+void database::checkpoint_object_database_if_due()
+{
+   if( _object_db_checkpoint_interval == 0 || head_block_num() % _object_db_checkpoint_interval != 0 )
+      return;
+   // Only the state at the last irreversible block is written, a restarted node could not unwind later blocks.
+   // While replaying without undo history all applied blocks are far below the end of the chain, i.e. irreversible.
+   const auto& dgp = get_dynamic_global_properties();
+   const uint32_t reversible_blocks = _undo_db.enabled()
+                                      ? dgp.head_block_number - dgp.last_irreversible_block_num : 0;
+   // blocks must be on disk before the objects referring to them, otherwise we could not reopen the database
+   object_database::checkpoint( reversible_blocks, [this] () { _block_id_to_block.flush(); } );
+}
+
 void database::close(bool rewinding)
 {
    if (!_opened)
@@ -241,6 +391,10 @@ void database::close(bool rewinding)
    // DB state (issue #336).
    clear_pending();
 
+   // the object database must not refer to blocks which are still waiting to be written
+   if( _block_id_to_block.is_open() )
+      _block_id_to_block.flush();
+
    ilog( "Writing object database to disk at block ${i}, please DO NOT kill the program", ("i", head_block_num()) );
    object_database::flush();
    ilog( "Done writing object database to disk" );
@@ -722,18 +722,13 @@ bool database::apply_order(const limit_order_object& new_order_object)
    asset_id_type recv_asset_id = new_order_object.receive_asset_id();
 
    // We only need to check if the new order will match with others if it is at the front of the book
-   const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
-   auto limit_itr = limit_price_idx.iterator_to( new_order_object );
-   if( limit_itr != limit_price_idx.begin() )
-   {
-      --limit_itr;
-      if( limit_itr->sell_asset_id() == sell_asset_id && limit_itr->receive_asset_id() == recv_asset_id )
-         return false;
-   }
+   if( get_limit_order_books().get_best_order( sell_asset_id, recv_asset_id ) != &new_order_object )
+      return false;
 
    // this is the opposite side (on the book)
+   const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
    auto max_price = ~new_order_object.sell_price;
-   limit_itr = limit_price_idx.lower_bound( max_price.max() );
+   auto limit_itr = limit_price_idx.lower_bound( max_price.max() );
    auto limit_end = limit_price_idx.upper_bound( max_price );
 
    // Order matching should be in favor of the taker.
@@ -650,6 +650,22 @@ void database::notify_on_pending_transaction( const signed_transaction& tx )
    GRAPHENE_TRY_NOTIFY( on_pending_transaction, tx )
 }
 
+fc::variant database::get_notified_object_variant( const object& obj )const
+{
+   if( !_notifying_objects )
+      return obj.to_variant();
+
+   auto itr = _notified_object_variants.find( obj.id );
+   if( itr != _notified_object_variants.end() )
+   {
+      ++_object_notification_stats.cache_hits;
+      return itr->second;
+   }
+   ++_object_notification_stats.conversions;
+   // Copies of the variant share the converted object
+   return _notified_object_variants.emplace( obj.id, obj.to_variant() ).first->second;
+}
+
 void database::notify_changed_objects()
 { try {
    if( _undo_db.enabled() )
@@ -657,6 +673,22 @@ void database::notify_changed_objects()
       const auto& head_undo = _undo_db.head();
       auto chain_time = head_block_time();
 
+      // Shares the variants of the notified objects between all receivers until the signals have been emitted
+      struct notification_scope
+      {
+         database& db;
+         const fc::time_point start = fc::time_point::now();
+         explicit notification_scope( database& d ) : db(d) { db._notifying_objects = true; }
+         ~notification_scope()
+         {
+            db._notifying_objects = false;
+            db._notified_object_variants.clear();
+            auto& stats = db._object_notification_stats;
+            ++stats.notifications;
+            stats.fan_out_us += ( fc::time_point::now() - start ).count();
+         }
+      } scope( *this );
+
       // New
       if( !new_objects.empty() )
       {
@@ -685,7 +717,7 @@ void database::notify_changed_objects()
         for( const auto& item : head_undo.old_values )
         {
           changed_ids.push_back(item.first);
-          get_relevant_accounts(item.second.get(), changed_accounts_impacted,
+          get_relevant_accounts(item.second, changed_accounts_impacted,
                                 MUST_IGNORE_CUSTOM_OP_REQD_AUTHS(chain_time));
         }
 
@@ -704,7 +736,7 @@ void database::notify_changed_objects()
         for( const auto& item : head_undo.removed )
         {
           removed_ids.emplace_back( item.first );
-          auto* obj = item.second.get();
+          const object* obj = item.second;
           removed.emplace_back( obj );
           get_relevant_accounts(obj, removed_accounts_impacted,
                                 MUST_IGNORE_CUSTOM_OP_REQD_AUTHS(chain_time));
@@ -2,38 +2,136 @@
  * Acloudbank
  */
 #pragma once
-#include <fstream>
 #include <graphene/protocol/block.hpp>
 
 #include <fc/filesystem.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 namespace graphene { namespace chain {
    struct index_entry;
    using namespace graphene::protocol;
 
-   class block_database 
+   /**
+    * @brief Append-only on-disk log of blocks, indexed by block number
+    *
+    * Blocks are appended to the "blocks" file, and a fixed-size @ref index_entry per block number is kept in the
+    * "index" file, so every lookup is O(1).  Readers access both files through read-only memory mappings and
+    * never lock, so any number of threads may fetch blocks concurrently.  All modifications go through a
+    * single writer which appends to the files and only syncs them to disk at explicit @ref flush points.
+    *
+    * With @ref start_writer the writer runs on a dedicated thread: @ref store only queues the block, which stays
+    * visible to readers until it has been written.  Queued blocks are written in batches and synced every
+    * configured number of blocks.  Blocks still queued at a crash are lost, which is safe as long as the
+    * object database never refers to them, i.e. as long as it is only persisted after a @ref flush.
+    */
+   class block_database
    {
       public:
+         block_database();
+         ~block_database();
+
          void open( const fc::path& dbdir );
          bool is_open()const;
+         /**
+          * Write blocks on a dedicated thread from now on
+          * @param max_queued_blocks maximum number of blocks waiting to be written, @ref store blocks when full
+          * @param sync_interval fsync the files every this many blocks written, 0 to sync only on @ref flush
+          */
+         void start_writer( uint32_t max_queued_blocks, uint32_t sync_interval );
+         /// Write all pending data to the files and fsync them
          void flush();
          void close();
 
          void store( const block_id_type& id, const signed_block& b );
+         /// Same as above, but the block is not copied when it is queued for the writer thread
+         void store( const block_id_type& id, std::shared_ptr<const signed_block> b );
          void remove( const block_id_type& id );
 
          bool                   contains( const block_id_type& id )const;
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /// Returns the packed block stored for @p block_num without unpacking or verifying it
+         optional<vector<char>> fetch_raw_by_number( uint32_t block_num )const;
+         /// Returns the packed block @p id without unpacking it, if it is stored
+         optional<vector<char>> fetch_raw_optional( const block_id_type& id )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
+         /// Position in the blocks file right after the most recently fetched block
          size_t                 blocks_current_position()const;
          size_t                 total_block_size()const;
       private:
+         struct log_view;
+         struct queued_block
+         {
+            block_id_type                       id;
+            std::shared_ptr<const signed_block> block;
+         };
+         using queued_block_ptr = std::shared_ptr<const queued_block>;
+         using log_view_ptr = std::shared_ptr<const log_view>;
+
+         /// Returns the current mappings, without locking
+         log_view_ptr current_view()const;
+         /// Re-maps the files if they have grown since the current mappings were created
+         log_view_ptr refresh_view()const;
+         /// Reads the index entry of @p block_num, refreshing @p view if the entry lies beyond its mapping
+         bool read_index_entry( uint32_t block_num, index_entry& e, log_view_ptr& view )const;
+         /// Reads and unpacks the block referenced by @p e, refreshing @p view if needed
+         optional<signed_block> read_block( const index_entry& e, log_view_ptr& view )const;
+         /// Copies the packed block referenced by @p e, refreshing @p view if needed
+         vector<char> read_raw_block( const index_entry& e, log_view_ptr& view )const;
+         void write_index_entry( uint32_t block_num, const index_entry& e );
+         /// Appends @p blocks to the blocks file and then writes their index entries
+         void write_blocks( const std::deque<queued_block_ptr>& blocks );
+
+         /// Returns the block queued for @p block_num, if any
+         queued_block_ptr find_queued( uint32_t block_num )const;
+         /// Blocks until all queued blocks have been written, rethrows the error of a failed write
+         void wait_for_writes()const;
+         void stop_writer();
+         void writer_loop();
+
          optional<index_entry> last_index_entry()const;
+
          fc::path _index_filename;
-         mutable std::fstream _blocks;
-         mutable std::fstream _block_num_to_pos;
+         fc::path _blocks_filename;
+
+         /// Serializes the writer and re-mapping of the files
+         mutable std::mutex _write_mutex;
+         FILE* _blocks_file = nullptr;
+         FILE* _index_file = nullptr;
+         /// Logical sizes of the files as seen by the writer
+         mutable uint64_t _blocks_size = 0;
+         mutable uint64_t _index_size = 0;
+         /// Number of blocks written by the writer thread since the files were last synced
+         uint32_t _unsynced_blocks = 0;
+
+         mutable log_view_ptr _view;
+         mutable std::atomic<size_t> _blocks_read_pos;
+
+         /// Guards the members below, which are only used while the writer thread runs
+         mutable std::mutex              _queue_mutex;
+         mutable std::condition_variable _queue_cond;
+         std::deque<queued_block_ptr>    _queue;
+         /// Latest queued block of every block number, until it has been written
+         std::map<uint32_t, queued_block_ptr> _queued_by_num;
+         /// Number of blocks in @ref _queued_by_num, so that readers only lock when something is queued
+         std::atomic<size_t>             _queued_count;
+         /// Whether the writer thread is writing a batch taken from the queue
+         bool                            _writing = false;
+         bool                            _stopping = false;
+         std::exception_ptr              _write_error;
+         uint32_t                        _max_queued_blocks = 0;
+         uint32_t                        _sync_interval = 0;
+         std::thread                     _writer;
    };
 } }
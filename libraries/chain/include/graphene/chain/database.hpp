@@ -23,6 +23,7 @@
 #include <fc/log/logger.hpp>
 
 #include <map>
+#include <unordered_map>
 
 namespace graphene { namespace protocol { struct predicate_result; } }
 
@@ -40,8 +41,10 @@ namespace graphene { namespace chain {
    class limit_order_object;
    class collateral_bid_object;
    class call_order_object;
+   class limit_order_book_index;
 
    struct budget_record;
+   class authority_speculations;
    enum class vesting_balance_type;
 
    /**
@@ -106,6 +109,30 @@ namespace graphene { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(bool rewind = true);
 
+         /// Set every how many blocks to write an incremental checkpoint of the object database, 0 to disable
+         void set_object_database_checkpoint_interval( uint32_t blocks ) { _object_db_checkpoint_interval = blocks; }
+         /**
+          * Write blocks to disk on a dedicated thread instead of while applying them, must be set before @ref open
+          * @param max_queued_blocks maximum number of blocks waiting to be written, 0 to write them synchronously
+          * @param sync_interval fsync the block database every this many blocks, 0 to sync only at checkpoints
+          */
+         void set_block_write_queue( uint32_t max_queued_blocks, uint32_t sync_interval )
+         {
+            _block_write_queue_size = max_queued_blocks;
+            _block_sync_interval = sync_interval;
+         }
+         /// Depth and memory usage of the undo history
+         undo_history_stats get_undo_history_stats()const { return _undo_db.get_stats(); }
+         /**
+          * Packs the objects together with the head block, which a node started from the snapshot needs to link
+          * the blocks following it, see @ref set_snapshot_to_load
+          */
+         std::shared_ptr<const graphene::db::object_snapshot> take_snapshot()const;
+      private:
+         /// Writes an incremental checkpoint of the object database if one is due at the current head block
+         void checkpoint_object_database_if_due();
+      public:
+
          //////////////////// db_witness_schedule.cpp ////////////////////
 
          /**
@@ -158,6 +185,8 @@ namespace graphene { namespace chain {
 
       public:
          const chain_id_type&                   get_chain_id()const;
+         /// The limit orders of every market in price levels
+         const limit_order_book_index&          get_limit_order_books()const { return *_limit_order_books; }
          const asset_object&                    get_core_asset()const;
          const asset_dynamic_data_object&       get_core_dynamic_data()const;
          const chain_property_object&           get_chain_properties()const;
@@ -544,6 +573,8 @@ namespace graphene { namespace chain {
          bool                       is_known_transaction( const transaction_id_type& id )const;
          block_id_type              get_block_id_for_num( uint32_t block_num )const;
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
+         /// Returns block @p id packed as it is stored, without unpacking it where possible
+         optional<vector<char>>     fetch_raw_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
          const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
@@ -628,6 +659,37 @@ namespace graphene { namespace chain {
          fc::signal<void(const vector<object_id_type>&,
                          const vector<const object*>&, const flat_set<account_id_type>&)>  removed_objects;
 
+         /// Counters of the conversions of notified objects to variants
+         struct object_notification_stats
+         {
+            uint64_t notifications = 0; ///< Number of times the object signals were emitted
+            uint64_t conversions = 0;   ///< Objects converted to variants
+            uint64_t cache_hits = 0;    ///< Conversions saved by sharing a variant between receivers
+            uint64_t fan_out_us = 0;    ///< Time spent emitting the object signals, in microseconds
+         };
+
+         /**
+          * Returns the variant of @p obj for receivers of @ref new_objects, @ref changed_objects and
+          * @ref removed_objects.  While these signals are emitted, every object is converted once and the
+          * variant is shared by all receivers, otherwise the object is converted on every call.
+          */
+         fc::variant get_notified_object_variant( const object& obj )const;
+         const object_notification_stats& get_object_notification_stats()const
+         { return _object_notification_stats; }
+
+         /// Number of accounts processed and time spent in each phase of the latest chain maintenance
+         struct chain_maintenance_stats
+         {
+            uint32_t accounts = 0;           ///< Accounts whose votes were tallied or fees processed
+            uint32_t tally_threads = 0;      ///< Threads which tallied votes, 0 if tallied together with the fees
+            int64_t  balances_us = 0;        ///< Updating the core balances of the account statistics
+            int64_t  tally_us = 0;           ///< Tallying votes, including fee processing when tallied serially
+            int64_t  account_updates_us = 0; ///< Updating voting power and processing fees after a parallel tally
+            int64_t  vote_updates_us = 0;    ///< Updating authorities, witnesses, committee members and workers
+            int64_t  total_us = 0;           ///< The whole chain maintenance
+         };
+         const chain_maintenance_stats& get_chain_maintenance_stats()const { return _chain_maintenance_stats; }
+
          ///@{
          /**
           *  This method validates transactions without adding it to the pending state.
@@ -640,6 +702,21 @@ namespace graphene { namespace chain {
           * can be reapplied at the proper time */
          std::deque< precomputable_transaction > _popped_tx;
 
+         /// What the verification of the authorities of a transaction depended on
+         struct authority_reads
+         {
+            /// Accounts whose active or owner authorities were read
+            flat_set<account_id_type> accounts;
+            /// Whether a viable custom authority was found, custom authorities expire without being written
+            bool custom_authorities = false;
+         };
+         /// What the authorities of each pending transaction were verified against, so that
+         /// pending_transactions_restorer only verifies them again if some of it may have changed
+         std::map< transaction_id_type, authority_reads > _pending_tx_authority_reads;
+
+         /// Number of pending_transactions_restorer objects which have not restored the pending transactions yet
+         uint32_t _pending_tx_restorers = 0;
+
          /**
           * @}
           */
@@ -666,6 +743,8 @@ namespace graphene { namespace chain {
       private:
          template<typename Trx>
          void _precompute_parallel( const Trx* trx, const size_t count, const uint32_t skip )const;
+         /// Performs the precomputations of @ref precompute_parallel for a whole block in the calling thread
+         void _precompute_block( const signed_block& block, const uint32_t skip )const;
 
       protected:
          // Mark pop_undo() as protected -- we do not want outside calling pop_undo(),
@@ -689,6 +768,10 @@ namespace graphene { namespace chain {
       private:
          void                  _apply_block( const signed_block& next_block );
          processed_transaction _apply_transaction( const signed_transaction& trx );
+         /// Starts verifying the authorities of @p trxs against the current state in parallel threads.
+         /// @return the running verifications, or nothing if they are disabled or not worth to run in parallel
+         std::shared_ptr<authority_speculations> speculate_authorities(
+               const vector<processed_transaction>& trxs )const;
 
          /// Validate, evaluate and apply a virtual operation using a temporary undo_database session,
          /// if fail, rewind any changes made
@@ -749,12 +832,45 @@ namespace graphene { namespace chain {
          void process_bids( const asset_bitasset_data_object& bad );
          void process_bitassets();
 
+         /// Tallies the votes of all accounts and processes their pending fees, on several threads if
+         /// @p tally_helper allows it
          template<class Type>
-         void perform_account_maintenance( Type tally_helper );
+         void perform_account_maintenance( Type& tally_helper );
          ///@}
          ///@}
 
          vector< processed_transaction >        _pending_tx;
+
+         /// Ranking data of a pending transaction
+         struct pending_transaction_info
+         {
+            account_id_type fee_payer;
+            uint64_t        size = 0;
+            /// Fees converted to the core asset per KiB
+            uint64_t        priority = 0;
+         };
+         /// Ranking data of each transaction in @ref _pending_tx
+         vector< pending_transaction_info >     _pending_tx_info;
+         /// Total packed size of @ref _pending_tx
+         uint64_t                               _pending_tx_size = 0;
+         /// Number of transactions in @ref _pending_tx per fee paying account
+         std::map< account_id_type, uint32_t >  _pending_tx_per_account;
+         /// Limits of the pending transactions, 0 for no limit
+         ///@{
+         uint64_t                               _max_pending_tx_size = 0;
+         uint32_t                               _max_pending_tx_per_account = 0;
+         ///@}
+
+         pending_transaction_info get_pending_transaction_info( const precomputable_transaction& trx )const;
+         /// Checks the limits of the pending transactions for a new transaction, evicting pending transactions of
+         /// lower priority if the total size limit would be exceeded.  While pending transactions are being
+         /// restored, nothing is evicted and the new transaction is rejected instead.
+         void make_room_for_pending_transaction( const pending_transaction_info& info );
+         /// Indexes of @ref _pending_tx in the order to include them in a block
+         vector<size_t> get_pending_transactions_by_priority()const;
+
+         /// While set, what the authority verification in @ref _apply_transaction reads is recorded in it
+         authority_reads*                       _authority_reads = nullptr;
          fork_database                          _fork_db;
 
          /**
@@ -776,6 +892,12 @@ namespace graphene { namespace chain {
           */
          vector<optional<operation_history_object> >  _applied_ops;
 
+         /// Variants of the objects notified by the current call of notify_changed_objects()
+         mutable std::unordered_map<object_id_type, fc::variant> _notified_object_variants;
+         bool                              _notifying_objects = false;
+         mutable object_notification_stats _object_notification_stats;
+         chain_maintenance_stats           _chain_maintenance_stats;
+
       public:
          fc::time_point_sec                _current_block_time;
          uint32_t                          _current_block_num    = 0;
@@ -794,10 +916,31 @@ namespace graphene { namespace chain {
 
          node_property_object              _node_property_object;
 
+         /// Every how many blocks an incremental checkpoint of the object database is written, 0 if disabled
+         uint32_t                          _object_db_checkpoint_interval = 0;
+
+         /// Maximum number of blocks waiting for the block writer thread, 0 if blocks are written synchronously
+         uint32_t                          _block_write_queue_size = 0;
+         /// Every how many written blocks the block database is synced to disk, 0 for checkpoints only
+         uint32_t                          _block_sync_interval = 0;
+
+         /// Maximum number of blocks read, decoded and precomputed ahead of the one being applied during replay,
+         /// 0 means to derive it from the number of IO threads
+         uint32_t                          _reindex_lookahead = 0;
+
+         /// Snapshot of the object database to start from if the object database is empty when opened
+         fc::path                          _snapshot_to_load;
+
          /// Whether to update votes of standby witnesses and committee members when performing chain maintenance.
          /// Set it to true to provide accurate data to API clients, set to false to have better performance.
          bool                              _track_standby_votes = true;
 
+         /// Whether to verify the authorities of the transactions of a block in parallel while the block is applied
+         bool                              _parallel_authority_checks = true;
+
+         /// Whether to tally the votes of accounts on several threads during chain maintenance
+         bool                              _parallel_vote_tally = true;
+
          /**
           * Whether database is successfully opened or not.
           *
@@ -822,9 +965,30 @@ namespace graphene { namespace chain {
          const chain_property_object*           _p_chain_property_obj      = nullptr;
          const witness_schedule_object*         _p_witness_schedule_obj    = nullptr;
          ///@}
+
+         /// Secondary index of the limit orders, see @ref get_limit_order_books
+         const limit_order_book_index*          _limit_order_books = nullptr;
       public:
          /// Enable or disable tracking of votes of standby witnesses and committee members
          inline void enable_standby_votes_tracking(bool enable)  { _track_standby_votes = enable; }
+         /// Set the maximum total packed size of pending transactions and the maximum number of pending
+         /// transactions per fee paying account, 0 for no limit
+         inline void set_pending_transaction_limits(uint64_t max_size, uint32_t max_per_account)
+         {
+            _max_pending_tx_size = max_size;
+            _max_pending_tx_per_account = max_per_account;
+         }
+         /// Enable or disable verifying the authorities of block transactions in parallel
+         inline void enable_parallel_authority_checks(bool enable)  { _parallel_authority_checks = enable; }
+         /// Enable or disable tallying votes on several threads during chain maintenance
+         inline void enable_parallel_vote_tally(bool enable)  { _parallel_vote_tally = enable; }
+         /// Set how many blocks may be prepared ahead of the one being applied during replay, 0 for automatic
+         inline void set_reindex_lookahead(uint32_t blocks)  { _reindex_lookahead = blocks; }
+         /// Set a snapshot written by object_database::save_snapshot to load instead of the genesis state
+         inline void set_snapshot_to_load(const fc::path& snapshot)  { _snapshot_to_load = snapshot; }
    };
 
 } }
+
+FC_REFLECT( graphene::chain::database::object_notification_stats,
+            (notifications)(conversions)(cache_hits)(fan_out_us) )
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/hardfork.hpp>
 
 /*
  * This file provides with() functions which modify the database
@@ -40,6 +41,59 @@ struct skip_flags_restorer
    uint32_t _old_skip_flags;      // initialized in ctor
 };
 
+/**
+ * Records the objects written to the database while it exists, to tell whether the active or owner authorities
+ * of accounts have been changed meanwhile.  Trackers may be nested, the writes seen by an inner tracker are passed
+ * on to the outer one when the inner tracker is destroyed.
+ */
+class authority_write_tracker
+{
+   public:
+      explicit authority_write_tracker( database& db )
+         : _db( db ), _outer( db.tracked_writes() )
+      {
+         _db.track_writes( &_written );
+      }
+
+      ~authority_write_tracker()
+      {
+         _db.track_writes( _outer );
+         if( _outer != nullptr )
+            _outer->insert( _outer->end(), _written.begin(), _written.end() );
+      }
+
+      /// Whether no authority of @p accounts has been written since the tracker was created
+      bool unchanged( const flat_set<account_id_type>& accounts )
+      {
+         for( ; _scanned < _written.size(); ++_scanned )
+         {
+            const object_id_type& id = _written[_scanned];
+            if( id.is<account_id_type>() )
+               _changed_accounts.insert( account_id_type( id ) );
+            // Every verification reads custom authorities and the maximum authority depth
+            else if( id.is<custom_authority_id_type>() || id.is<global_property_id_type>() )
+               _invalidate_all = true;
+         }
+         if( _invalidate_all )
+            return false;
+         for( const account_id_type& account : accounts )
+            if( _changed_accounts.find( account ) != _changed_accounts.end() )
+               return false;
+         return true;
+      }
+
+      /// Makes @ref unchanged return false from now on
+      void invalidate_all() { _invalidate_all = true; }
+
+   private:
+      database&                    _db;
+      std::vector<object_id_type>* _outer;
+      std::vector<object_id_type>  _written;
+      size_t                       _scanned = 0;
+      flat_set<account_id_type>    _changed_accounts;
+      bool                         _invalidate_all = false;
+};
+
 /**
  * Class used to help the without_pending_transactions
  * implementation.
@@ -50,14 +104,21 @@ struct skip_flags_restorer
 struct pending_transactions_restorer
 {
    pending_transactions_restorer( database& db, std::vector<processed_transaction>&& pending_transactions )
-      : _db(db), _pending_transactions( std::move(pending_transactions) )
+      : _db(db), _pending_transactions( std::move(pending_transactions) ),
+        _authority_reads( std::move(db._pending_tx_authority_reads) ),
+        _authority_tracker( db ), _pending_time( db.head_block_time() )
    {
+      // The tracker is created first, so that undoing the pending transactions counts as writes as well
       _db.clear_pending();
+      ++_db._pending_tx_restorers;
    }
 
    ~pending_transactions_restorer()
    {
-      for( const auto& tx : _db._popped_tx )
+      // Pushing the transactions may not evict pending transactions, see make_room_for_pending_transaction()
+      const std::deque<precomputable_transaction> popped_tx = std::move( _db._popped_tx );
+      _db._popped_tx.clear();
+      for( const auto& tx : popped_tx )
       {
          try {
             if( !_db.is_known_transaction( tx.id() ) ) {
@@ -66,23 +127,48 @@ struct pending_transactions_restorer
          } catch ( const fc::exception& ) { // ignore invalid transactions
          }
       }
-      _db._popped_tx.clear();
+
+      const fc::time_point_sec now = _db.head_block_time();
+      if( ( _pending_time >= HARDFORK_CORE_584_TIME ) != ( now >= HARDFORK_CORE_584_TIME )
+            || MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( _pending_time ) != MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( now ) )
+         _authority_tracker.invalidate_all();
+
       for( const processed_transaction& tx : _pending_transactions )
       {
          try
          {
             if( !_db.is_known_transaction( tx.id() ) ) {
-               _db._push_transaction( tx );
+               // Authorities which were verified when the transaction was pushed are not verified again,
+               // unless something they depend on has been written since.  Custom authorities may have expired
+               // meanwhile, so transactions which were approved through one are always verified again.
+               auto reads = _authority_reads.find( tx.id() );
+               if( reads != _authority_reads.end() && !reads->second.custom_authorities
+                     && _authority_tracker.unchanged( reads->second.accounts ) )
+               {
+                  node_property_object& npo = _db.node_properties();
+                  skip_flags_restorer restorer( npo, npo.skip_flags );
+                  npo.skip_flags |= database::skip_transaction_signatures;
+                  _db._push_transaction( tx );
+                  _db._pending_tx_authority_reads[ tx.id() ] = std::move( reads->second );
+               }
+               else
+                  _db._push_transaction( tx );
             }
          }
          catch( const fc::exception& )
          { // ignore invalid transactions
          }
       }
+      --_db._pending_tx_restorers;
    }
 
    database& _db;
    std::vector< processed_transaction > _pending_transactions;
+   /// See @ref database::_pending_tx_authority_reads
+   std::map< transaction_id_type, database::authority_reads > _authority_reads;
+   authority_write_tracker _authority_tracker;
+   /// Head block time when the pending transactions were verified
+   fc::time_point_sec _pending_time;
 };
 
 /**
@@ -10,6 +10,10 @@
 
 #include <boost/multi_index/composite_key.hpp>
 
+#include <map>
+#include <stack>
+#include <tuple>
+
 namespace graphene { namespace chain {
 
 using namespace graphene::db;
@@ -110,6 +114,52 @@ typedef multi_index_container<
 
 typedef generic_index<limit_order_object, limit_order_multi_index_type> limit_order_index;
 
+/**
+ * @brief Keeps the limit orders of every market in price levels
+ *
+ * Reading one side of a market only touches the orders of that market, instead of searching the @ref by_price
+ * index of the orders of all markets.  Within a price level, orders are kept in the order they were created,
+ * like in the @ref by_price index.
+ */
+class limit_order_book_index : public secondary_index
+{
+   public:
+      /// Orders selling at the same price
+      struct price_level
+      {
+         /// Total amount for sale of the orders
+         share_type total_for_sale;
+         std::map< limit_order_id_type, const limit_order_object* > orders;
+      };
+      /// The orders selling one asset for another, best price first
+      using book_side = std::map< price, price_level, std::greater<price> >;
+
+      void object_inserted( const object& obj ) override;
+      void object_removed( const object& obj ) override;
+      void about_to_modify( const object& before ) override;
+      void object_modified( const object& after ) override;
+
+      /// Returns the orders selling @p sell_asset for @p receive_asset, or nullptr if there are none
+      const book_side* get_book_side( asset_id_type sell_asset, asset_id_type receive_asset )const;
+      /// Returns the order selling @p sell_asset for @p receive_asset at the best price, or nullptr
+      const limit_order_object* get_best_order( asset_id_type sell_asset, asset_id_type receive_asset )const;
+      /// Returns a number which changes whenever the orders selling @p sell_asset for @p receive_asset change,
+      /// 0 if they never existed
+      uint64_t get_revision( asset_id_type sell_asset, asset_id_type receive_asset )const;
+
+   private:
+      void add( const limit_order_object& order );
+      void remove( limit_order_id_type order_id, const price& sell_price, share_type for_sale );
+
+      /// Sides of all markets, by sold and received asset
+      std::map< std::pair< asset_id_type, asset_id_type >, book_side > _books;
+      /// Revisions of all sides which ever existed, by sold and received asset
+      std::map< std::pair< asset_id_type, asset_id_type >, uint64_t > _revisions;
+      uint64_t _last_revision = 0;
+      /// Orders being modified, with their prices and amounts before the modification
+      std::stack< std::tuple< limit_order_id_type, price, share_type > > _orders_being_modified;
+};
+
 /**
  * @class call_order_object
  * @brief tracks debt and call price information
@@ -80,6 +80,7 @@ namespace graphene { namespace chain {
          operation_history_id_type            operation_id;
          uint64_t                             sequence = 0; /// the operation position within the given account
          account_history_id_type              next;
+         int64_t                              operation_type = 0; /// the type of the operation, its tag
    };
 
    struct by_block;
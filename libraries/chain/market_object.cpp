@@ -286,6 +286,84 @@ share_type call_order_object::get_max_debt_to_cover( price match_price,
 
 } FC_CAPTURE_AND_RETHROW( (*this)(feed_price)(match_price)(maintenance_collateral_ratio) ) }
 
+void limit_order_book_index::add( const limit_order_object& order )
+{
+   const auto key = std::make_pair( order.sell_asset_id(), order.receive_asset_id() );
+   price_level& level = _books[ key ][ order.sell_price ];
+   level.total_for_sale += order.for_sale;
+   _revisions[ key ] = ++_last_revision;
+   level.orders[ order.get_id() ] = &order;
+}
+
+void limit_order_book_index::remove( limit_order_id_type order_id, const price& sell_price, share_type for_sale )
+{
+   auto book = _books.find( std::make_pair( sell_price.base.asset_id, sell_price.quote.asset_id ) );
+   if( book == _books.end() )
+      return;
+   auto level = book->second.find( sell_price );
+   if( level == book->second.end() || level->second.orders.erase( order_id ) == 0 )
+      return;
+   _revisions[ book->first ] = ++_last_revision;
+   level->second.total_for_sale -= for_sale;
+   if( level->second.orders.empty() )
+   {
+      book->second.erase( level );
+      if( book->second.empty() )
+         _books.erase( book );
+   }
+}
+
+void limit_order_book_index::object_inserted( const object& obj )
+{
+   add( static_cast< const limit_order_object& >( obj ) );
+}
+
+void limit_order_book_index::object_removed( const object& obj )
+{
+   const auto& order = static_cast< const limit_order_object& >( obj );
+   remove( order.get_id(), order.sell_price, order.for_sale );
+}
+
+void limit_order_book_index::about_to_modify( const object& before )
+{
+   const auto& order = static_cast< const limit_order_object& >( before );
+   _orders_being_modified.emplace( order.get_id(), order.sell_price, order.for_sale );
+}
+
+void limit_order_book_index::object_modified( const object& after )
+{
+   const auto& order = static_cast< const limit_order_object& >( after );
+   FC_ASSERT( !_orders_being_modified.empty() && std::get<0>( _orders_being_modified.top() ) == order.get_id(),
+              "Modification of ID is not supported!" );
+   const auto& before = _orders_being_modified.top();
+   remove( std::get<0>( before ), std::get<1>( before ), std::get<2>( before ) );
+   _orders_being_modified.pop();
+   add( order );
+}
+
+const limit_order_book_index::book_side* limit_order_book_index::get_book_side( asset_id_type sell_asset,
+                                                                               asset_id_type receive_asset )const
+{
+   auto book = _books.find( std::make_pair( sell_asset, receive_asset ) );
+   return book == _books.end() ? nullptr : &book->second;
+}
+
+const limit_order_object* limit_order_book_index::get_best_order( asset_id_type sell_asset,
+                                                                 asset_id_type receive_asset )const
+{
+   const book_side* side = get_book_side( sell_asset, receive_asset );
+   if( side == nullptr )
+      return nullptr;
+   // empty levels are removed
+   return side->begin()->second.orders.begin()->second;
+}
+
+uint64_t limit_order_book_index::get_revision( asset_id_type sell_asset, asset_id_type receive_asset )const
+{
+   auto revision = _revisions.find( std::make_pair( sell_asset, receive_asset ) );
+   return revision == _revisions.end() ? 0 : revision->second;
+}
+
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::limit_order_object,
                     (graphene::db::object),
                     (expiration)(seller)(for_sale)(sell_price)(filled_amount)(deferred_fee)(deferred_paid_fee)
@@ -7,6 +7,9 @@
 #include <fc/io/raw.hpp>
 #include <fc/crypto/city.hpp>
 
+#include <cstddef>
+#include <new>
+
 #define MAX_NESTING (200)
 
 namespace graphene { namespace db {
@@ -51,6 +54,9 @@ namespace graphene { namespace db {
          /// these methods are implemented for derived classes by inheriting base_abstract_object<DerivedClass>
          /// @{
          virtual std::unique_ptr<object> clone()const = 0;
+         /// Copy-constructs this object into @p buffer which must hold at least @ref object_size bytes
+         virtual object*                 clone_at( void* buffer )const = 0;
+         virtual size_t                  object_size()const = 0;
          virtual void                    move_from( object& obj ) = 0;
          virtual fc::variant             to_variant()const  = 0;
          virtual std::vector<char>       pack()const = 0;
@@ -73,6 +79,12 @@ namespace graphene { namespace db {
          {
             return std::make_unique<DerivedClass>( *static_cast<const DerivedClass*>(this) );
          }
+         object* clone_at( void* buffer )const override
+         {
+            static_assert( alignof(DerivedClass) <= alignof(std::max_align_t), "over-aligned objects are not supported" );
+            return new( buffer ) DerivedClass( *static_cast<const DerivedClass*>(this) );
+         }
+         size_t object_size()const override { return sizeof(DerivedClass); }
 
          void    move_from( object& obj ) override
          {
@@ -7,11 +7,34 @@
 #include <graphene/db/undo_database.hpp>
 
 #include <fc/log/logger.hpp>
+#include <fc/thread/future.hpp>
 
+#include <functional>
 #include <map>
+#include <memory>
+#include <unordered_set>
+#include <vector>
 
 namespace graphene { namespace db {
 
+   /// Packed objects of one index, see @ref object_database::take_snapshot
+   struct object_snapshot_index
+   {
+      /// Space and type of the index, and the ID the index assigns to the next object
+      object_id_type    next_id;
+      uint64_t          object_count = 0;
+      /// Objects packed one after another, each one prefixed by its size
+      std::vector<char> data;
+   };
+
+   /// Packed objects of all indexes, see @ref object_database::take_snapshot
+   struct object_snapshot
+   {
+      std::vector<object_snapshot_index> indexes;
+      /// Data stored together with the objects by the user of the database, e.g. the head block of a blockchain
+      std::vector<char>                  attachment;
+   };
+
    /**
     *   @class object_database
     *   @brief maintains a set of indexed objects that can be modified with multi-level rollback support
@@ -20,7 +43,7 @@ namespace graphene { namespace db {
    {
       public:
          object_database();
-         virtual ~object_database() = default;
+         virtual ~object_database();
 
          static constexpr uint8_t _index_size = 255;
 
@@ -36,6 +59,36 @@ namespace graphene { namespace db {
           * Saves the complete state of the object_database to disk, this could take a while
           */
          void flush();
+         /**
+          * Appends all objects created, modified or removed since the last checkpoint or @ref flush to the
+          * checkpoint log, which is replayed on top of the last full save by @ref open.  The cost is bounded by
+          * the number of changed objects rather than the size of the database.
+          *
+          * Only state which cannot be undone anymore is written: objects changed in the newest
+          * @p reversible_states undo states are written as they were before these states, and are written
+          * again by a later checkpoint.  Thus the log never contains changes which a restarted node could not
+          * unwind.  Nothing is written if there are less than @p reversible_states undo states.
+          *
+          * Objects are serialized in the calling thread, writing and compacting the log happens in a separate
+          * thread.  @p before_write is called in that thread right before the log is written.
+          */
+         void checkpoint( uint32_t reversible_states,
+                          std::function<void()> before_write = std::function<void()>() );
+         /// Start or stop tracking the objects which need to be written by @ref checkpoint
+         void enable_checkpoints( bool enable );
+         bool checkpoints_enabled()const { return _checkpoints_enabled; }
+         /**
+          * Packs the objects of all indexes.  The result does not refer to the database any more, so it may be
+          * written by @ref save_snapshot in any thread while the database is being modified.
+          */
+         std::shared_ptr<const object_snapshot> take_snapshot( std::vector<char> attachment = std::vector<char>() )const;
+         /// Writes @p snapshot to @p filename in a binary format with a header per index
+         static void save_snapshot( const object_snapshot& snapshot, const fc::path& filename );
+         /**
+          * Loads the objects of a file written by @ref save_snapshot into the indexes, which must be empty
+          * @return the attachment of the snapshot
+          */
+         std::vector<char> load_snapshot( const fc::path& filename );
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
@@ -144,6 +197,14 @@ namespace graphene { namespace db {
 
          void pop_undo();
 
+         /**
+          * While @p written is set, the id of every object created, modified or removed is appended to it.
+          * Ids are appended once per change, so the same id may appear multiple times.
+          */
+         void track_writes( std::vector<object_id_type>* written ) { _written_objects = written; }
+         /// Returns the vector set by @ref track_writes, if any
+         std::vector<object_id_type>* tracked_writes()const { return _written_objects; }
+
          fc::path get_data_dir()const { return _data_dir; }
 
          /** public for testing purposes only... should be private in practice. */
@@ -160,6 +221,9 @@ namespace graphene { namespace db {
          index& get_mutable_index(const object_id_type& id)  { return get_mutable_index(id.space(),id.type());   }
          index& get_mutable_index(uint8_t space_id, uint8_t type_id);
 
+         /// Waits until the last checkpoint has been written
+         void wait_for_checkpoint();
+
      private:
 
          friend class base_primary_index;
@@ -168,8 +232,24 @@ namespace graphene { namespace db {
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
+         fc::path checkpoint_log_filename()const { return _data_dir / "object_database.log"; }
+         /// Applies all complete records of the checkpoint log to the loaded objects
+         void replay_checkpoint_log();
+         /// Rewrites the checkpoint log so that it contains only the latest version of every object
+         void compact_checkpoint_log();
+
          fc::path                                                  _data_dir;
          std::vector< std::vector< std::unique_ptr<index> > >      _index;
+
+         bool                                                      _checkpoints_enabled = false;
+         /// Objects created, modified or removed since the last checkpoint
+         std::unordered_set<object_id_type>                        _dirty_objects;
+         fc::future<void>                                          _checkpoint_task;
+         /// Size of the checkpoint log right after it was last compacted
+         uint64_t                                                  _compacted_log_size = 0;
+
+         /// See @ref track_writes
+         std::vector<object_id_type>*                              _written_objects = nullptr;
    };
 
 } } // graphene::db
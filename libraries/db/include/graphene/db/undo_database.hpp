@@ -2,25 +2,115 @@
 #pragma once
 #include <graphene/db/object.hpp>
 #include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <fc/exception/exception.hpp>
 
 namespace graphene { namespace db {
 
    class object_database;
 
+   /**
+    * @class undo_arena
+    * @brief Memory owned by one undo state
+    *
+    * Memory is handed out from large chunks and released all at once when the arena is destroyed, so recording
+    * changes in an undo state costs a pointer bump instead of a heap allocation per object and container node.
+    */
+   class undo_arena
+   {
+      public:
+         /// @param usage counter of the bytes handed out by all arenas sharing it, may be null
+         explicit undo_arena( size_t* usage = nullptr ) : _usage( usage ) {}
+         undo_arena( const undo_arena& ) = delete;
+         undo_arena& operator=( const undo_arena& ) = delete;
+         ~undo_arena();
+
+         /// @return @p size bytes of memory aligned for any fundamental type
+         void*   allocate( size_t size );
+         /// Copies @p obj into the arena, the copy is destroyed together with the arena
+         object* clone( const object& obj );
+         /// Takes over all memory and objects owned by @p other
+         void    absorb( undo_arena& other );
+
+         /// Total number of bytes handed out by this arena
+         size_t  bytes_allocated()const { return _bytes_allocated; }
+
+      private:
+         static constexpr size_t chunk_size = 64 * 1024;
+
+         std::vector< std::unique_ptr<char[]> > _chunks;
+         char*                                  _free = nullptr;
+         size_t                                 _free_size = 0;
+         size_t                                 _bytes_allocated = 0;
+         size_t*                                _usage = nullptr;
+         /// Objects to destroy together with the arena
+         std::vector< object* >                 _objects;
+   };
+
+   /// A standard allocator which takes its memory from an @ref undo_arena and never frees it individually
+   template<typename T>
+   class undo_allocator
+   {
+      public:
+         using value_type = T;
+
+         explicit undo_allocator( undo_arena* arena ) : _arena( arena ) {}
+         template<typename U>
+         undo_allocator( const undo_allocator<U>& other ) : _arena( other.arena() ) {}
+
+         T*   allocate( size_t n )     { return static_cast<T*>( _arena->allocate( n * sizeof(T) ) ); }
+         void deallocate( T*, size_t ) {}
+
+         undo_arena* arena()const { return _arena; }
+
+         template<typename U>
+         bool operator==( const undo_allocator<U>& other )const { return _arena == other.arena(); }
+         template<typename U>
+         bool operator!=( const undo_allocator<U>& other )const { return _arena != other.arena(); }
+
+      private:
+         undo_arena* _arena;
+   };
+
    struct undo_state
    {
-      std::unordered_map<object_id_type, std::unique_ptr<object> > old_values;
-      std::unordered_map<object_id_type, object_id_type>           old_index_next_ids;
-      std::unordered_set<object_id_type>                           new_ids;
-      std::unordered_map<object_id_type, std::unique_ptr<object> > removed;
+      template<typename Value>
+      using id_map = std::unordered_map< object_id_type, Value, std::hash<object_id_type>,
+                                         std::equal_to<object_id_type>,
+                                         undo_allocator< std::pair<const object_id_type, Value> > >;
+      using id_set = std::unordered_set< object_id_type, std::hash<object_id_type>, std::equal_to<object_id_type>,
+                                         undo_allocator<object_id_type> >;
+
+      /// @param usage counter of the memory held by undo states, passed to the arena
+      explicit undo_state( size_t* usage = nullptr );
+
+      /// Owns the bookkeeping of the containers below and the object copies, declared first to be destroyed last
+      std::unique_ptr<undo_arena>  arena;
+      /// Copies of objects as they were before the first modification in this state, owned by the arena
+      id_map<object*>              old_values;
+      id_map<object_id_type>       old_index_next_ids;
+      id_set                       new_ids;
+      /// Copies of removed objects, owned by the arena
+      id_map<object*>              removed;
    };
 
 
+   /// Size and memory usage of the undo history
+   struct undo_history_stats
+   {
+      uint32_t depth = 0;       ///< Number of undo states
+      uint32_t max_depth = 0;   ///< Number of undo states kept when starting a new one
+      uint64_t bytes = 0;       ///< Memory held by the undo states
+   };
+
    /**
     * @class undo_database
     * @brief tracks changes to the state and allows changes to be undone
     *
+    * The memory of every undo state is accounted by its arena, see @ref memory_usage.
     */
    class undo_database
    {
@@ -100,7 +190,13 @@ namespace graphene { namespace db {
          size_t max_size()const { return _max_size; }
          uint32_t active_sessions()const { return _active_sessions; }
 
+         /// Memory held by the undo states, including the bookkeeping of their containers
+         size_t memory_usage()const { return _memory_usage; }
+         undo_history_stats get_stats()const;
+
          const undo_state& head()const;
+         /// Returns the undo state @p depth states below the newest one, which is at depth 0
+         const undo_state& at_depth( size_t depth )const;
 
       private:
          void undo();
@@ -112,6 +208,9 @@ namespace graphene { namespace db {
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
+         size_t                  _memory_usage = 0;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::undo_history_stats, (depth)(max_depth)(bytes) )
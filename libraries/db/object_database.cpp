@@ -5,10 +5,148 @@
 
 #include <fc/io/raw.hpp>
 #include <fc/container/flat.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/thread/parallel.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace graphene { namespace db { namespace detail {
+
+   /// Objects changed between two checkpoints
+   struct checkpoint_record
+   {
+      /// next_id of every index
+      std::vector<object_id_type>                                   next_ids;
+      /// packed objects, data is empty if the object has been removed
+      std::vector< std::pair< object_id_type, std::vector<char> > > objects;
+   };
+
+   /// Start of a snapshot file written by object_database::save_snapshot
+   struct snapshot_header
+   {
+      /// Format 2 appends the attachment to the indexes
+      static constexpr uint32_t current_format = 2;
+
+      uint32_t format = current_format;
+      uint32_t index_count = 0;
+   };
+
+   /// Precedes the packed objects of every index in a snapshot file
+   struct snapshot_index_header
+   {
+      object_id_type next_id;
+      uint64_t       object_count = 0;
+      uint64_t       data_size = 0;
+      fc::sha256     data_hash;
+   };
+
+} } }
+FC_REFLECT( graphene::db::detail::checkpoint_record, (next_ids)(objects) )
+FC_REFLECT( graphene::db::detail::snapshot_header, (format)(index_count) )
+FC_REFLECT( graphene::db::detail::snapshot_index_header, (next_id)(object_count)(data_size)(data_hash) )
+
 namespace graphene { namespace db {
 
+namespace {
+
+   /// Minimum size of the checkpoint log before it is compacted
+   constexpr uint64_t min_checkpoint_log_compaction_size = 16 * 1024 * 1024;
+
+   /// Appends @p data to the file and syncs it to disk
+   void append_to_file( const fc::path& filename, const std::vector<char>& data )
+   {
+      FILE* f = fopen( filename.generic_string().c_str(), "ab" );
+      FC_ASSERT( f != nullptr, "Unable to open ${f}", ("f",filename) );
+      bool ok = ( fwrite( data.data(), 1, data.size(), f ) == data.size() );
+      ok = ( fflush( f ) == 0 ) && ok;
+#ifdef _WIN32
+      ok = ( _commit( _fileno( f ) ) == 0 ) && ok;
+#else
+      ok = ( fsync( fileno( f ) ) == 0 ) && ok;
+#endif
+      fclose( f );
+      FC_ASSERT( ok, "Unable to write to ${f}", ("f",filename) );
+   }
+
+   /// A record is stored as its packed payload followed by the hash of the payload
+   std::vector<char> pack_checkpoint_record( const detail::checkpoint_record& record )
+   {
+      const auto payload = fc::raw::pack( record );
+      std::vector<char> result = fc::raw::pack( payload );
+      const auto hash = fc::raw::pack( fc::sha256::hash( payload.data(), payload.size() ) );
+      result.insert( result.end(), hash.begin(), hash.end() );
+      return result;
+   }
+
+   /// Hashes data which may be larger than the encoder accepts at once
+   fc::sha256 hash_data( const char* data, uint64_t size )
+   {
+      constexpr uint64_t max_chunk_size = 1u << 30;
+      fc::sha256::encoder enc;
+      while( size > 0 )
+      {
+         const auto chunk_size = std::min( size, max_chunk_size );
+         enc.write( data, static_cast<uint32_t>( chunk_size ) );
+         data += chunk_size;
+         size -= chunk_size;
+      }
+      return enc.result();
+   }
+
+   /**
+    * Calls @p apply for every complete record in the checkpoint log, stops at the first incomplete or corrupted
+    * record, which may be left behind by a crash while writing.
+    * @return the size of the valid part of the log
+    */
+   uint64_t read_checkpoint_log( const fc::path& filename,
+                                 const std::function<void(detail::checkpoint_record&)>& apply )
+   {
+      if( !fc::exists( filename ) )
+         return 0;
+      const uint64_t file_size = fc::file_size( filename );
+      if( file_size == 0 )
+         return 0;
+      fc::file_mapping fm( filename.generic_string().c_str(), fc::read_only );
+      fc::mapped_region mr( fm, fc::read_only, 0, file_size );
+      fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+      uint64_t valid_size = 0;
+      while( ds.remaining() > 0 )
+      {
+         detail::checkpoint_record record;
+         try
+         {
+            std::vector<char> payload;
+            fc::sha256 hash;
+            fc::raw::unpack( ds, payload );
+            fc::raw::unpack( ds, hash );
+            if( fc::sha256::hash( payload.data(), payload.size() ) != hash )
+               break;
+            record = fc::raw::unpack<detail::checkpoint_record>( payload );
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "Ignoring incomplete record at position ${p} of ${f}", ("p",valid_size)("f",filename) );
+            break;
+         }
+         apply( record );
+         valid_size = file_size - ds.remaining();
+      }
+      return valid_size;
+   }
+
+}
+
 object_database::object_database()
 :_undo_db(*this)
 {
@@ -16,8 +154,14 @@ object_database::object_database()
    _undo_db.enable();
 }
 
+object_database::~object_database()
+{
+   wait_for_checkpoint();
+}
+
 void object_database::close()
 {
+   wait_for_checkpoint();
 }
 
 const object* object_database::find_object( const object_id_type& id )const
@@ -60,6 +204,8 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
 
 void object_database::flush()
 {
+   wait_for_checkpoint();
+
    const auto tmp_dir = _data_dir / "object_database.tmp";
    const auto old_dir = _data_dir / "object_database.old";
    const auto target_dir = _data_dir / "object_database";
@@ -89,6 +235,12 @@ void object_database::flush()
    for( auto& task : tasks )
       task.wait();
    fc::remove_all( tmp_dir / "lock" );
+   // The checkpoint log is based on the previous full save, it must not be applied to the new one.
+   // If we crash right after removing it, the previous full save is still a consistent state.
+   if( fc::exists( checkpoint_log_filename() ) )
+      fc::remove( checkpoint_log_filename() );
+   _compacted_log_size = 0;
+   _dirty_objects.clear();
    if( fc::exists( target_dir ) )
    {
       if( fc::exists( old_dir ) )
@@ -99,11 +251,114 @@ void object_database::flush()
    fc::remove_all( old_dir );
 }
 
+std::shared_ptr<const object_snapshot> object_database::take_snapshot( std::vector<char> attachment )const
+{ try {
+   auto result = std::make_shared<object_snapshot>();
+   result->attachment = std::move( attachment );
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+      {
+         if( !idx )
+            continue;
+         result->indexes.emplace_back();
+         auto& section = result->indexes.back();
+         section.next_id = idx->get_next_id();
+         idx->inspect_all_objects( [&section]( const object& o ) {
+            const auto packed = fc::raw::pack( o.pack() );
+            section.data.insert( section.data.end(), packed.begin(), packed.end() );
+            ++section.object_count;
+         });
+      }
+   return result;
+} FC_CAPTURE_AND_RETHROW() }
+
+void object_database::save_snapshot( const object_snapshot& snapshot, const fc::path& filename )
+{ try {
+   // a partially written snapshot is never found under the final name
+   const fc::path tmp_filename = filename.generic_string() + ".tmp";
+   {
+      std::ofstream out( tmp_filename.generic_string(),
+                         std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out, "Unable to open ${f}", ("f",tmp_filename) );
+      detail::snapshot_header header;
+      header.index_count = static_cast<uint32_t>( snapshot.indexes.size() );
+      fc::raw::pack( out, header );
+      for( const auto& section : snapshot.indexes )
+      {
+         detail::snapshot_index_header index_header;
+         index_header.next_id = section.next_id;
+         index_header.object_count = section.object_count;
+         index_header.data_size = section.data.size();
+         index_header.data_hash = hash_data( section.data.data(), section.data.size() );
+         fc::raw::pack( out, index_header );
+         out.write( section.data.data(), section.data.size() );
+      }
+      fc::raw::pack( out, snapshot.attachment );
+      out.flush();
+      FC_ASSERT( out, "Unable to write to ${f}", ("f",tmp_filename) );
+   }
+   fc::rename( tmp_filename, filename );
+} FC_CAPTURE_AND_RETHROW( (filename) ) }
+
+std::vector<char> object_database::load_snapshot( const fc::path& filename )
+{ try {
+   FC_ASSERT( fc::exists( filename ), "Snapshot ${f} does not exist", ("f",filename) );
+   const uint64_t file_size = fc::file_size( filename );
+   fc::file_mapping fm( filename.generic_string().c_str(), fc::read_only );
+   fc::mapped_region mr( fm, fc::read_only, 0, file_size );
+   const char* const begin = (const char*)mr.get_address();
+   fc::datastream<const char*> ds( begin, file_size );
+
+   detail::snapshot_header header;
+   fc::raw::unpack( ds, header );
+   FC_ASSERT( header.format == detail::snapshot_header::current_format,
+              "Unsupported snapshot format ${f}", ("f",header.format) );
+
+   ilog( "Loading object database snapshot from ${f} ...", ("f",filename) );
+   const bool undo_enabled = _undo_db.enabled();
+   _undo_db.disable();
+   uint64_t total_objects = 0;
+   std::vector<char> packed;
+   for( uint32_t i = 0; i < header.index_count; ++i )
+   {
+      detail::snapshot_index_header index_header;
+      fc::raw::unpack( ds, index_header );
+      const auto space = index_header.next_id.space();
+      const auto type = index_header.next_id.type();
+      FC_ASSERT( ds.remaining() >= index_header.data_size, "Snapshot is truncated" );
+      const char* const data = begin + ( file_size - ds.remaining() );
+      FC_ASSERT( hash_data( data, index_header.data_size ) == index_header.data_hash,
+                 "Snapshot data of index ${s}.${t} is corrupted", ("s",space)("t",type) );
+      ds.skip( index_header.data_size );
+
+      FC_ASSERT( space < _index.size() && type < _index[space].size() && _index[space][type],
+                 "Snapshot contains unknown index ${s}.${t}", ("s",space)("t",type) );
+      index& idx = *_index[space][type];
+      FC_ASSERT( idx.get_next_id().instance() == 0, "Index ${s}.${t} is not empty", ("s",space)("t",type) );
+      idx.set_next_id( index_header.next_id );
+      fc::datastream<const char*> objects( data, index_header.data_size );
+      for( uint64_t n = 0; n < index_header.object_count; ++n )
+      {
+         fc::raw::unpack( objects, packed );
+         idx.load( packed );
+      }
+      total_objects += index_header.object_count;
+   }
+   std::vector<char> attachment;
+   fc::raw::unpack( ds, attachment );
+   if( undo_enabled )
+      _undo_db.enable();
+   ilog( "Done loading ${n} objects from the snapshot", ("n",total_objects) );
+   return attachment;
+} FC_CAPTURE_AND_RETHROW( (filename) ) }
+
 void object_database::wipe(const fc::path& data_dir)
 {
    close();
    ilog("Wiping object database...");
    fc::remove_all(data_dir / "object_database");
+   fc::remove_all(data_dir / "object_database.log");
+   _dirty_objects.clear();
    ilog("Done wiping object database.");
 }
 
@@ -113,6 +368,8 @@ void object_database::open(const fc::path& data_dir)
    if( fc::exists( _data_dir / "object_database" / "lock" ) )
    {
        wlog("Ignoring locked object_database");
+       if( fc::exists( checkpoint_log_filename() ) )
+          fc::remove( checkpoint_log_filename() );
        return;
    }
    std::vector<fc::future<void>> tasks;
@@ -135,11 +392,182 @@ void object_database::open(const fc::path& data_dir)
    }
    for( auto& task : tasks )
       task.wait();
+   replay_checkpoint_log();
+   _dirty_objects.clear();
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
 
+void object_database::enable_checkpoints( bool enable )
+{
+   _checkpoints_enabled = enable;
+   if( !enable )
+      _dirty_objects.clear();
+}
+
+void object_database::checkpoint( uint32_t reversible_states, std::function<void()> before_write )
+{ try {
+   FC_ASSERT( _checkpoints_enabled, "Checkpoints are not enabled" );
+   if( reversible_states > _undo_db.size() )
+   {
+      dlog( "Not enough undo history to write a checkpoint of the irreversible state" );
+      return;
+   }
+
+   // The state before the oldest reversible undo state, walking from the newest to the oldest one so that
+   // the value recorded by the oldest state wins.  A null object did not exist yet.
+   std::map< object_id_type, object_id_type > next_ids;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+         {
+            const object_id_type next_id = idx->get_next_id();
+            next_ids[ object_id_type( next_id.space(), next_id.type(), 0 ) ] = next_id;
+         }
+   std::unordered_map< object_id_type, const object* > irreversible_values;
+   for( uint32_t depth = 0; depth < reversible_states; ++depth )
+   {
+      const undo_state& state = _undo_db.at_depth( depth );
+      for( const auto& item : state.old_index_next_ids )
+         next_ids[ item.first ] = item.second;
+      for( const auto& item : state.old_values )
+         irreversible_values[ item.first ] = item.second;
+      for( const auto& item : state.removed )
+         irreversible_values[ item.first ] = item.second;
+      for( const auto& id : state.new_ids )
+         irreversible_values[ id ] = nullptr;
+   }
+
+   auto record = std::make_shared<detail::checkpoint_record>();
+   record->next_ids.reserve( next_ids.size() );
+   for( const auto& item : next_ids )
+      record->next_ids.push_back( item.second );
+   record->objects.reserve( _dirty_objects.size() );
+   std::unordered_set<object_id_type> still_dirty;
+   for( const auto& id : _dirty_objects )
+   {
+      const object* obj = nullptr;
+      auto itr = irreversible_values.find( id );
+      if( itr != irreversible_values.end() )
+      {
+         obj = itr->second;
+         // the current value still has to be written once it is irreversible
+         still_dirty.insert( id );
+      }
+      else
+         obj = find_object( id );
+      record->objects.emplace_back( id, obj != nullptr ? obj->pack() : std::vector<char>() );
+   }
+   _dirty_objects.swap( still_dirty );
+
+   wait_for_checkpoint();
+   _checkpoint_task = fc::do_parallel( [this,record,before_write] () {
+      if( before_write )
+         before_write();
+      const auto log_filename = checkpoint_log_filename();
+      append_to_file( log_filename, pack_checkpoint_record( *record ) );
+      if( fc::file_size( log_filename ) > std::max( 2 * _compacted_log_size, min_checkpoint_log_compaction_size ) )
+         compact_checkpoint_log();
+   } );
+} FC_CAPTURE_AND_RETHROW() }
+
+void object_database::wait_for_checkpoint()
+{
+   if( !_checkpoint_task.valid() )
+      return;
+   try
+   {
+      _checkpoint_task.wait();
+   }
+   catch( const fc::exception& e )
+   {
+      // The log still contains a consistent, older state up to the last complete record
+      elog( "Failed to write object database checkpoint: ${e}", ("e",e.to_detail_string()) );
+   }
+   _checkpoint_task = fc::future<void>();
+}
+
+void object_database::replay_checkpoint_log()
+{ try {
+   const auto log_filename = checkpoint_log_filename();
+   if( !fc::exists( log_filename ) )
+      return;
+
+   const auto find_index = [this]( const object_id_type& id ) -> index* {
+      if( id.space() >= _index.size() || id.type() >= _index[id.space()].size() )
+         return nullptr;
+      return _index[id.space()][id.type()].get();
+   };
+
+   ilog( "Replaying object database checkpoint log ..." );
+   const bool undo_enabled = _undo_db.enabled();
+   _undo_db.disable();
+   uint32_t records = 0;
+   const uint64_t valid_size = read_checkpoint_log( log_filename,
+         [&find_index,&records]( detail::checkpoint_record& record ) {
+      for( const auto& next_id : record.next_ids )
+      {
+         index* idx = find_index( next_id );
+         if( idx != nullptr )
+            idx->set_next_id( next_id );
+      }
+      for( const auto& item : record.objects )
+      {
+         index* idx = find_index( item.first );
+         if( idx == nullptr )
+            continue;
+         const object* obj = idx->find( item.first );
+         if( obj != nullptr )
+            idx->remove( *obj );
+         if( !item.second.empty() )
+            idx->load( item.second );
+      }
+      ++records;
+   } );
+   if( undo_enabled )
+      _undo_db.enable();
+
+   if( fc::file_size( log_filename ) > valid_size )
+   {
+      wlog( "Truncating incomplete checkpoint log from ${s} to ${v} bytes",
+            ("s",fc::file_size( log_filename ))("v",valid_size) );
+      fc::resize_file( log_filename, valid_size );
+   }
+   _compacted_log_size = valid_size;
+   ilog( "Done replaying ${n} checkpoints", ("n",records) );
+} FC_CAPTURE_AND_RETHROW() }
+
+void object_database::compact_checkpoint_log()
+{
+   const auto log_filename = checkpoint_log_filename();
+   const auto tmp_filename = _data_dir / "object_database.log.tmp";
+
+   std::map< object_id_type, object_id_type >    next_ids;
+   std::map< object_id_type, std::vector<char> > objects;
+   read_checkpoint_log( log_filename, [&next_ids,&objects]( detail::checkpoint_record& record ) {
+      for( const auto& next_id : record.next_ids )
+         next_ids[ object_id_type( next_id.space(), next_id.type(), 0 ) ] = next_id;
+      for( auto& item : record.objects )
+         objects[ item.first ] = std::move( item.second );
+   } );
+
+   detail::checkpoint_record merged;
+   merged.next_ids.reserve( next_ids.size() );
+   for( const auto& item : next_ids )
+      merged.next_ids.push_back( item.second );
+   merged.objects.reserve( objects.size() );
+   for( auto& item : objects )
+      merged.objects.emplace_back( item.first, std::move( item.second ) );
+
+   if( fc::exists( tmp_filename ) )
+      fc::remove( tmp_filename );
+   append_to_file( tmp_filename, pack_checkpoint_record( merged ) );
+   fc::rename( tmp_filename, log_filename );
+   _compacted_log_size = fc::file_size( log_filename );
+   dlog( "Compacted object database checkpoint log to ${s} bytes", ("s",_compacted_log_size) );
+}
+
 void object_database::pop_undo()
 { try {
    _undo_db.pop_commit();
@@ -147,16 +575,28 @@ void object_database::pop_undo()
 
 void object_database::save_undo( const object& obj )
 {
+   if( _checkpoints_enabled )
+      _dirty_objects.insert( obj.id );
+   if( _written_objects != nullptr )
+      _written_objects->push_back( obj.id );
    _undo_db.on_modify( obj );
 }
 
 void object_database::save_undo_add( const object& obj )
 {
+   if( _checkpoints_enabled )
+      _dirty_objects.insert( obj.id );
+   if( _written_objects != nullptr )
+      _written_objects->push_back( obj.id );
    _undo_db.on_create( obj );
 }
 
 void object_database::save_undo_remove(const object& obj)
 {
+   if( _checkpoints_enabled )
+      _dirty_objects.insert( obj.id );
+   if( _written_objects != nullptr )
+      _written_objects->push_back( obj.id );
    _undo_db.on_remove( obj );
 }
 
@@ -5,6 +5,77 @@
 
 namespace graphene { namespace db {
 
+undo_arena::~undo_arena()
+{
+   for( object* obj : _objects )
+      if( obj != nullptr )
+         obj->~object();
+   if( _usage != nullptr )
+      *_usage -= _bytes_allocated;
+}
+
+void* undo_arena::allocate( size_t size )
+{
+   constexpr size_t alignment = alignof(std::max_align_t);
+   size = ( size + alignment - 1 ) & ~( alignment - 1 );
+   _bytes_allocated += size;
+   if( _usage != nullptr )
+      *_usage += size;
+   if( size > _free_size )
+   {
+      // big allocations get a chunk of their own, so that the rest of the current chunk is not wasted
+      if( size > chunk_size / 4 )
+      {
+         _chunks.emplace_back( new char[size] );
+         return _chunks.back().get();
+      }
+      _chunks.emplace_back( new char[chunk_size] );
+      _free = _chunks.back().get();
+      _free_size = chunk_size;
+   }
+   void* result = _free;
+   _free += size;
+   _free_size -= size;
+   return result;
+}
+
+object* undo_arena::clone( const object& obj )
+{
+   void* buffer = allocate( obj.object_size() );
+   _objects.emplace_back( nullptr );
+   _objects.back() = obj.clone_at( buffer );
+   return _objects.back();
+}
+
+void undo_arena::absorb( undo_arena& other )
+{
+   _chunks.reserve( _chunks.size() + other._chunks.size() );
+   for( auto& chunk : other._chunks )
+      _chunks.emplace_back( std::move( chunk ) );
+   other._chunks.clear();
+   other._free = nullptr;
+   other._free_size = 0;
+
+   _objects.insert( _objects.end(), other._objects.begin(), other._objects.end() );
+   other._objects.clear();
+
+   _bytes_allocated += other._bytes_allocated;
+   if( _usage != nullptr )
+      *_usage += other._bytes_allocated;
+   if( other._usage != nullptr )
+      *other._usage -= other._bytes_allocated;
+   other._bytes_allocated = 0;
+}
+
+undo_state::undo_state( size_t* usage )
+   : arena( std::make_unique<undo_arena>( usage ) ),
+     old_values( id_map<object*>::allocator_type( arena.get() ) ),
+     old_index_next_ids( id_map<object_id_type>::allocator_type( arena.get() ) ),
+     new_ids( id_set::allocator_type( arena.get() ) ),
+     removed( id_map<object*>::allocator_type( arena.get() ) )
+{
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -31,7 +102,7 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
    while( size() > max_size() )
       _stack.pop_front();
 
-   _stack.emplace_back();
+   _stack.emplace_back( &_memory_usage );
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
@@ -40,7 +111,7 @@ void undo_database::on_create( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_memory_usage );
    auto& state = _stack.back();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
@@ -53,34 +124,35 @@ void undo_database::on_modify( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_memory_usage );
    auto& state = _stack.back();
    if( state.new_ids.find(obj.id) != state.new_ids.end() )
       return;
    auto itr =  state.old_values.find(obj.id);
    if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.old_values[obj.id] = state.arena->clone( obj );
 }
 void undo_database::on_remove( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_memory_usage );
    undo_state& state = _stack.back();
    if( state.new_ids.count(obj.id) > 0 )
    {
       state.new_ids.erase(obj.id);
       return;
    }
-   if( state.old_values.count(obj.id) > 0 )
+   auto old_itr = state.old_values.find(obj.id);
+   if( old_itr != state.old_values.end() )
    {
-      state.removed[obj.id] = std::move(state.old_values[obj.id]);
-      state.old_values.erase(obj.id);
+      state.removed[obj.id] = old_itr->second;
+      state.old_values.erase(old_itr);
       return;
    }
    if( state.removed.count(obj.id) > 0 ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed[obj.id] = state.arena->clone( obj );
 }
 
 void undo_database::undo()
@@ -126,6 +198,10 @@ void undo_database::merge()
    auto& state = _stack.back();
    auto& prev_state = _stack[_stack.size()-2];
 
+   // The object copies of state are moved to prev_state below, so prev_state has to own their memory.
+   // The containers of state stay usable until state is popped, deallocation is a no-op.
+   prev_state.arena->absorb( *state.arena );
+
    // An object's relationship to a state can be:
    // in new_ids            : new
    // in old_values (was=X) : upd(was=X)
@@ -184,7 +260,7 @@ void undo_database::merge()
       // del+upd -> N/A
       assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
       // nop+upd(was=Y) -> upd(was=Y), type B
-      prev_state.old_values[obj.second->id] = std::move(obj.second);
+      prev_state.old_values[obj.second->id] = obj.second;
    }
 
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
@@ -221,14 +297,14 @@ void undo_database::merge()
       if( it != prev_state.old_values.end() )
       {
          // upd(was=X) + del(was=Y) -> del(was=X)
-         prev_state.removed[obj.second->id] = std::move(it->second);
-         prev_state.old_values.erase(obj.second->id);
+         prev_state.removed[obj.second->id] = it->second;
+         prev_state.old_values.erase(it);
          continue;
       }
       // del + del -> N/A
       assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
       // nop + del(was=Y) -> del(was=Y)
-      prev_state.removed[obj.second->id] = std::move(obj.second);
+      prev_state.removed[obj.second->id] = obj.second;
    }
    _stack.pop_back();
    --_active_sessions;
@@ -276,10 +352,25 @@ void undo_database::pop_commit()
    }
    enable();
 }
+undo_history_stats undo_database::get_stats()const
+{
+   undo_history_stats stats;
+   stats.depth = _stack.size();
+   stats.max_depth = _max_size;
+   stats.bytes = _memory_usage;
+   return stats;
+}
+
 const undo_state& undo_database::head()const
 {
    FC_ASSERT( !_stack.empty() );
    return _stack.back();
 }
 
+const undo_state& undo_database::at_depth( size_t depth )const
+{
+   FC_ASSERT( depth < _stack.size() );
+   return _stack[ _stack.size() - 1 - depth ];
+}
+
 } } // graphene::db
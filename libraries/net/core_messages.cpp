@@ -5,10 +5,15 @@
 
 #include <fc/io/raw.hpp>
 
+#include <cstring>
+
 namespace graphene { namespace net {
 
   const core_message_type_enum trx_message::type                             = core_message_type_enum::trx_message_type;
   const core_message_type_enum block_message::type                           = core_message_type_enum::block_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_compact_block_transactions_message::type = core_message_type_enum::fetch_compact_block_transactions_message_type;
+  const core_message_type_enum compact_block_transactions_message::type      = core_message_type_enum::compact_block_transactions_message_type;
   const core_message_type_enum item_ids_inventory_message::type              = core_message_type_enum::item_ids_inventory_message_type;
   const core_message_type_enum blockchain_item_ids_inventory_message::type   = core_message_type_enum::blockchain_item_ids_inventory_message_type;
   const core_message_type_enum fetch_blockchain_item_ids_message::type       = core_message_type_enum::fetch_blockchain_item_ids_message_type;
@@ -27,10 +32,56 @@ namespace graphene { namespace net {
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
 
+  short_transaction_id get_short_transaction_id( const transaction_id_type& trx_id )
+  {
+    short_transaction_id result;
+    memcpy( result.data, trx_id.data(), sizeof(result.data) );
+    return result;
+  }
+
+  message block_message::from_packed_block( std::vector<char> packed_block, const block_id_type& id )
+  {
+    // a packed block_message is the packed block followed by the block ID
+    message result;
+    result.msg_type = block_message::type;
+    result.data = std::move( packed_block );
+    const size_t block_size = result.data.size();
+    result.data.resize( block_size + id.data_size() );
+    memcpy( result.data.data() + block_size, id.data(), id.data_size() );
+    result.size = (uint32_t)result.data.size();
+    return result;
+  }
+
+  block_id_type block_message::id_of( const message& msg )
+  {
+    FC_ASSERT( msg.msg_type.value() == block_message::type );
+    block_id_type result;
+    FC_ASSERT( msg.data.size() >= result.data_size(), "Block message is too short" );
+    memcpy( result.data(), msg.data.data() + msg.data.size() - result.data_size(), result.data_size() );
+    return result;
+  }
+
+  compact_block_message::compact_block_message( const signed_block& blk, const item_hash_t& item_hash )
+  : item_hash(item_hash), header(blk)
+  {
+    transactions.reserve( blk.transactions.size() );
+    for( const auto& trx : blk.transactions )
+      transactions.push_back( compact_block_transaction{ get_short_transaction_id( trx.id() ),
+                                                         trx.operation_results } );
+  }
+
 } } // graphene::net
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::trx_message, BOOST_PP_SEQ_NIL, (trx) )
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::block_message, BOOST_PP_SEQ_NIL, (block)(block_id) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::compact_block_transaction, BOOST_PP_SEQ_NIL,
+                                (short_id)(operation_results) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::compact_block_message, BOOST_PP_SEQ_NIL,
+                                (item_hash)(header)(transactions) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::fetch_compact_block_transactions_message, BOOST_PP_SEQ_NIL,
+                                (block_id)(transaction_indexes) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::compact_block_transactions_message, BOOST_PP_SEQ_NIL,
+                                (block_id)(transactions) )
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::item_id, BOOST_PP_SEQ_NIL,
                                (item_type)
@@ -111,6 +162,10 @@ FC_REFLECT_DERIVED_NO_TYPENAME(graphene::net::get_current_connections_reply_mess
 
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::trx_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::block_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::compact_block_transaction )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::compact_block_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::fetch_compact_block_transactions_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::compact_block_transactions_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::item_id )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::item_ids_inventory_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::blockchain_item_ids_inventory_message )
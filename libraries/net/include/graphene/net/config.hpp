@@ -43,6 +43,20 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Queued messages are sent to a peer in batches of about this many bytes,
+ * each batch is encrypted and written to the socket at once.
+ */
+#define GRAPHENE_NET_MAX_SEND_BATCH_SIZE                     (64 * 1024)
+
+/**
+ * Received data is decrypted, and block and transaction messages are unpacked and hashed, on the worker
+ * threads instead of the thread of the node if they are at least this many bytes long.  Below that, handing
+ * the work over costs more than doing it.
+ */
+#define GRAPHENE_NET_MIN_BYTES_TO_DECRYPT_IN_PARALLEL        (16 * 1024)
+#define GRAPHENE_NET_MIN_BYTES_TO_DECODE_IN_PARALLEL         1024
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
@@ -67,6 +81,22 @@
 
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During syncing, each peer is asked for as many blocks as it has recently delivered in this
+ * many seconds, at least GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING and at most the maximum
+ * number of blocks per peer.  It is asked for more once less than half of them are outstanding.
+ */
+#define GRAPHENE_NET_SYNC_REQUEST_DURATION_SEC               5
+#define GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING      10
+
+/**
+ * If a peer has not sent any of the sync blocks we requested for this many times the time it
+ * usually takes per block, and at least GRAPHENE_NET_MIN_SYNC_STALL_SEC seconds, while blocks
+ * received from other peers wait for the missing ones, its requests are moved to faster peers.
+ */
+#define GRAPHENE_NET_SYNC_STALL_FACTOR                       4
+#define GRAPHENE_NET_MIN_SYNC_STALL_SEC                      3
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -94,6 +124,12 @@
 
 #define MAXIMUM_PEERDB_SIZE 1000
 
+/**
+ * The peer database file is rewritten once it holds at least this many records
+ * more than twice the number of peers
+ */
+#define GRAPHENE_NET_PEERDB_MIN_RECORDS_TO_COMPACT 1000
+
 constexpr size_t MAX_ADDRESSES_TO_HANDLE_AT_ONCE = 200;
 
 constexpr size_t MAX_BLOCKS_TO_HANDLE_AT_ONCE = 200;
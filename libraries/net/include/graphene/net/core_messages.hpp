@@ -4,7 +4,9 @@
 #pragma once
 
 #include <graphene/net/config.hpp>
+#include <graphene/net/message.hpp>
 
+#include <fc/array.hpp>
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/crypto/elliptic.hpp>
 #include <fc/crypto/sha256.hpp>
@@ -65,6 +67,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_compact_block_transactions_message_type = 5019,
+    compact_block_transactions_message_type      = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -92,6 +97,65 @@ namespace graphene { namespace net {
       signed_block    block;
       block_id_type   block_id;
 
+      /// Returns the message of a block packed with fc::raw::pack, without unpacking the block
+      static message from_packed_block( std::vector<char> packed_block, const block_id_type& id );
+      /// Returns the ID of the block in @p msg, a message of this type, without unpacking the block
+      static block_id_type id_of( const message& msg );
+   };
+
+   /// Identifies a transaction of a @ref compact_block_message by the first bytes of its ID
+   typedef fc::array<char, 8> short_transaction_id;
+
+   short_transaction_id get_short_transaction_id( const transaction_id_type& trx_id );
+
+   /// A transaction of a @ref compact_block_message, except the signed transaction itself
+   struct compact_block_transaction
+   {
+      short_transaction_id                               short_id;
+      std::vector<graphene::protocol::operation_result>  operation_results;
+   };
+
+   /**
+    * A block without its signed transactions, sent instead of a @ref block_message to peers which support
+    * compact blocks.  The receiver looks the transactions up among the ones it received recently and requests
+    * the missing ones with a @ref fetch_compact_block_transactions_message.
+    */
+   struct compact_block_message
+   {
+      static const core_message_type_enum type;
+
+      compact_block_message(){}
+      compact_block_message( const signed_block& blk, const item_hash_t& item_hash );
+
+      /// The hash of the @ref block_message of the block, which the receiver requested
+      item_hash_t                              item_hash;
+      graphene::protocol::signed_block_header  header;
+      std::vector<compact_block_transaction>   transactions;
+   };
+
+   /// Requests the transactions at the given positions of a block received as a @ref compact_block_message
+   struct fetch_compact_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type          block_id;
+      std::vector<uint32_t>  transaction_indexes;
+
+      fetch_compact_block_transactions_message() {}
+      fetch_compact_block_transactions_message( const block_id_type& block_id,
+                                                const std::vector<uint32_t>& transaction_indexes ) :
+        block_id(block_id),
+        transaction_indexes(transaction_indexes)
+      {}
+   };
+
+   /// Reply to a @ref fetch_compact_block_transactions_message, with the transactions in the requested order
+   struct compact_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type                                          block_id;
+      std::vector<graphene::protocol::processed_transaction> transactions;
    };
 
   struct item_ids_inventory_message
@@ -402,6 +466,9 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)
+                 (compact_block_transactions_message_type)
                  (core_message_type_last) )
 FC_REFLECT_ENUM(graphene::net::rejection_reason_code, (unspecified)
                                                  (different_chain)
@@ -423,6 +490,10 @@ FC_REFLECT_ENUM(graphene::net::firewall_check_result, (unable_to_check)
 
 FC_REFLECT_TYPENAME( graphene::net::trx_message )
 FC_REFLECT_TYPENAME( graphene::net::block_message )
+FC_REFLECT_TYPENAME( graphene::net::compact_block_transaction )
+FC_REFLECT_TYPENAME( graphene::net::compact_block_message )
+FC_REFLECT_TYPENAME( graphene::net::fetch_compact_block_transactions_message )
+FC_REFLECT_TYPENAME( graphene::net::compact_block_transactions_message )
 FC_REFLECT_TYPENAME( graphene::net::item_id )
 FC_REFLECT_TYPENAME( graphene::net::item_ids_inventory_message )
 FC_REFLECT_TYPENAME( graphene::net::blockchain_item_ids_inventory_message )
@@ -446,6 +517,10 @@ FC_REFLECT_TYPENAME( graphene::net::get_current_connections_reply_message )
 
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::trx_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::block_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::compact_block_transaction )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::compact_block_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::fetch_compact_block_transactions_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::compact_block_transactions_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::item_id )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::item_ids_inventory_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::blockchain_item_ids_inventory_message )
@@ -0,0 +1,75 @@
+/*
+ * AcloudBank
+ */
+#pragma once
+
+#include <graphene/net/core_messages.hpp>
+
+#include <functional>
+
+namespace graphene { namespace net {
+
+   /**
+    * @brief A received message, with the work which does not depend on the state of the node done already
+    */
+   struct decoded_message
+   {
+      message           msg;
+      message_hash_type hash;
+      /// Unpacked contents of block and transaction messages, empty for other messages
+      fc::optional<block_message> block;
+      fc::optional<trx_message>   trx;
+   };
+
+   /// Current state of one stage of the processing of received messages
+   struct inbound_stage_stats
+   {
+      /// Number of items waiting for or being processed by the stage
+      uint32_t queue_depth = 0;
+      uint32_t max_queue_depth = 0;
+      uint64_t processed = 0;
+      /// Total time items have spent in the stage, in microseconds
+      uint64_t total_time_us = 0;
+   };
+
+   /**
+    * @brief Counters of the stages received messages go through on the worker threads
+    *
+    * Decrypting, unpacking and hashing do not depend on the state of the node, so they are done on the
+    * worker threads while the task of the connection waits, and the thread of the node serves other peers.
+    */
+   struct inbound_pipeline_stats
+   {
+      uint32_t            worker_threads = 0;
+      /// Decryption of data read from the sockets
+      inbound_stage_stats decrypt;
+      /// Unpacking and hashing of block and transaction messages
+      inbound_stage_stats decode;
+      /// Work finished on the worker threads, until the thread of the node resumes the task waiting for it
+      inbound_stage_stats dispatch;
+   };
+
+   /**
+    * Hashes @p msg and unpacks it if it is a block or transaction message.  Large messages are decoded on
+    * the worker threads while the calling task waits.
+    */
+   decoded_message decode_message( message&& msg );
+
+   inbound_pipeline_stats get_inbound_pipeline_stats();
+
+   namespace detail
+   {
+      enum class inbound_stage
+      {
+         decrypt,
+         decode
+      };
+
+      /// Runs @p work as part of @p stage on the worker threads and waits for it, rethrowing its exceptions
+      void run_on_worker_threads( inbound_stage stage, const std::function<void()>& work );
+   }
+
+} } // graphene::net
+
+FC_REFLECT( graphene::net::inbound_stage_stats, (queue_depth)(max_queue_depth)(processed)(total_time_us) )
+FC_REFLECT( graphene::net::inbound_pipeline_stats, (worker_threads)(decrypt)(decode)(dispatch) )
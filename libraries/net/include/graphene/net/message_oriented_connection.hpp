@@ -15,7 +15,7 @@ namespace graphene { namespace net {
   class message_oriented_connection_delegate 
   {
   public:
-    virtual void on_message(message_oriented_connection* originating_connection, const message& received_message) = 0;
+    virtual void on_message(message_oriented_connection* originating_connection, message&& received_message) = 0;
     virtual void on_connection_closed(message_oriented_connection* originating_connection) = 0;
   };
 
@@ -32,6 +32,8 @@ namespace graphene { namespace net {
        void connect_to(const fc::ip::endpoint& remote_endpoint);
 
        void send_message(const message& message_to_send);
+       /// Sends the messages in order, writing them to the socket at once
+       void send_messages(const std::vector<message>& messages_to_send);
        void close_connection();
        void destroy_connection();
 
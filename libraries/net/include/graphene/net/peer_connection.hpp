@@ -5,6 +5,7 @@
 
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/message_decoder.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/config.hpp>
 
@@ -17,6 +18,7 @@
 #include <boost/multi_index/tag.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
+#include <map>
 #include <queue>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
@@ -29,7 +31,7 @@ namespace graphene { namespace net
     public:
       virtual ~peer_connection_delegate() = default;
       virtual void on_message(peer_connection* originating_peer,
-                              const message& received_message) = 0;
+                              const decoded_message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
       virtual message get_message_for_item(const item_id& item) = 0;
     };
@@ -170,6 +172,8 @@ namespace graphene { namespace net
       fc::optional<fc::time_point_sec> fc_git_revision_unix_timestamp;
       fc::optional<std::string> platform;
       fc::optional<uint32_t> bitness;
+      /// Whether the peer understands compact_block_message and the related messages
+      bool supports_compact_blocks = false;
 
       // Initially, these fields record info about our local socket,
       // they are useless (except the remote_inbound_endpoint field for outbound connections).
@@ -205,6 +209,11 @@ namespace graphene { namespace net
       fc::time_point last_sync_item_received_time;
       /// IDs of blocks we've requested from this peer during sync. Fetch from another peer if this peer disconnects
       std::set<item_hash_t> sync_items_requested_from_peer;
+      /// IDs of blocks requested from this peer which have been requested from a faster peer since,
+      /// they are ignored when they arrive
+      std::set<item_hash_t> sync_items_reassigned_from_peer;
+      /// Moving average of the time between two sync blocks received from this peer, zero if unknown
+      fc::microseconds sync_block_interval;
       /// The hash of the last block  this peer has told us about that the peer knows
       item_hash_t last_block_delegate_has_seen;
       fc::time_point_sec last_block_time_delegate_has_seen;
@@ -241,6 +250,20 @@ namespace graphene { namespace net
       /// Items we've requested from this peer during normal operation.
       /// Fetch from another peer if this peer disconnects
       item_to_time_map_type items_requested_from_peer;
+
+      /// A block received as a compact_block_message, waiting for transactions requested from this peer
+      struct partial_compact_block
+      {
+        /// The hash under which the block was requested, see @ref compact_block_message::item_hash
+        item_hash_t                                            item_hash;
+        graphene::protocol::signed_block_header                header;
+        std::vector<graphene::protocol::processed_transaction> transactions;
+        /// Positions of the requested transactions in the block
+        std::vector<uint32_t> missing_transactions;
+        /// Whether all transactions have been requested from the peer, because the ones we had did not match
+        bool                  fetched_all_transactions = false;
+      };
+      std::map<block_id_type, partial_compact_block> compact_blocks_in_progress;
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -275,7 +298,8 @@ namespace graphene { namespace net
       void connect_to(const fc::ip::endpoint& remote_endpoint,
                       const fc::optional<fc::ip::endpoint>& local_endpoint = fc::optional<fc::ip::endpoint>());
 
-      void on_message(message_oriented_connection* originating_connection, const message& received_message) override;
+      /// Decodes @p received_message, on the worker threads if it is large, and passes it to the node
+      void on_message(message_oriented_connection* originating_connection, message&& received_message) override;
       void on_connection_closed(message_oriented_connection* originating_connection) override;
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
@@ -72,6 +72,14 @@ namespace graphene { namespace net {
   }
 
 
+  /**
+   * @brief The peers this node knows about, kept in a binary file which is updated incrementally
+   *
+   * Every update and erase is appended to the file as a small record as it happens, so the database
+   * survives a crash of the node.  The file is rewritten with one record per peer when it is closed
+   * and whenever it holds many more records than there are peers.  A file written as JSON
+   * by an older version is converted when it is opened.
+   */
   class peer_database
   {
   public:
@@ -92,6 +100,10 @@ namespace graphene { namespace net {
     iterator begin() const;
     iterator end() const;
     size_t size() const;
+
+    /// When the database is closed, only this many most recently seen peers are kept
+    void set_maximum_size(size_t maximum_size);
+    size_t get_maximum_size() const;
   private:
     std::unique_ptr<detail::peer_database_impl> my;
   };
@@ -34,6 +34,9 @@ class stcp_socket : public virtual fc::iostream
     using istream::get;
     void             get( char& c ) { read( &c, 1 ); }
     fc::sha512       get_shared_secret() const { return _shared_secret; }
+
+    /// Maximum number of bytes encrypted or decrypted and passed to the TCP socket by one call
+    static constexpr size_t max_chunk_size = 64 * 1024;
   private:
     void do_key_exchange();
 
@@ -42,8 +45,11 @@ class stcp_socket : public virtual fc::iostream
     fc::tcp_socket       _sock;
     fc::aes_encoder      _send_aes;
     fc::aes_decoder      _recv_aes;
+    /// Buffers for the encrypted data, reused by all reads and writes
     std::shared_ptr<char> _read_buffer;
+    size_t                _read_buffer_size = 0;
     std::shared_ptr<char> _write_buffer;
+    size_t                _write_buffer_size = 0;
 #ifndef NDEBUG
     bool _read_buffer_in_use;
     bool _write_buffer_in_use;
@@ -0,0 +1,151 @@
+/*
+ * AcloudBank
+ */
+#include <graphene/net/message_decoder.hpp>
+#include <graphene/net/config.hpp>
+
+#include <fc/asio.hpp>
+#include <fc/thread/parallel.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace graphene { namespace net {
+
+   namespace
+   {
+      struct stage_counters
+      {
+         std::atomic<uint32_t> queue_depth{0};
+         std::atomic<uint32_t> max_queue_depth{0};
+         std::atomic<uint64_t> processed{0};
+         std::atomic<uint64_t> total_time_us{0};
+
+         void enter()
+         {
+            const uint32_t depth = ++queue_depth;
+            uint32_t max_depth = max_queue_depth.load();
+            while( depth > max_depth && !max_queue_depth.compare_exchange_weak( max_depth, depth ) )
+               ;
+         }
+
+         void leave( const fc::time_point& entered )
+         {
+            --queue_depth;
+            ++processed;
+            total_time_us += std::max<int64_t>( 0, ( fc::time_point::now() - entered ).count() );
+         }
+
+         inbound_stage_stats get()const
+         {
+            inbound_stage_stats result;
+            result.queue_depth = queue_depth.load();
+            result.max_queue_depth = max_queue_depth.load();
+            result.processed = processed.load();
+            result.total_time_us = total_time_us.load();
+            return result;
+         }
+      };
+
+      stage_counters decrypt_stage;
+      stage_counters decode_stage;
+      stage_counters dispatch_stage;
+
+      void decode_contents( decoded_message& result )
+      {
+         result.hash = result.msg.id();
+         if( result.msg.msg_type.value() == block_message_type )
+         {
+            result.block = result.msg.as<block_message>();
+            result.block->block.id();
+         }
+         else if( result.msg.msg_type.value() == trx_message_type )
+         {
+            result.trx = result.msg.as<trx_message>();
+            result.trx->trx.id();
+         }
+      }
+   }
+
+   decoded_message decode_message( message&& msg )
+   {
+      decoded_message result;
+      result.msg = std::move( msg );
+      const auto type = result.msg.msg_type.value();
+      if( ( type == block_message_type || type == trx_message_type )
+          && result.msg.size.value() >= GRAPHENE_NET_MIN_BYTES_TO_DECODE_IN_PARALLEL )
+         detail::run_on_worker_threads( detail::inbound_stage::decode, [&result]() { decode_contents( result ); } );
+      else
+         decode_contents( result );
+      return result;
+   }
+
+   inbound_pipeline_stats get_inbound_pipeline_stats()
+   {
+      inbound_pipeline_stats result;
+      result.worker_threads = (uint32_t)fc::asio::default_io_service_scope::get_num_threads();
+      result.decrypt = decrypt_stage.get();
+      result.decode = decode_stage.get();
+      result.dispatch = dispatch_stage.get();
+      return result;
+   }
+
+   namespace detail
+   {
+      void run_on_worker_threads( inbound_stage stage, const std::function<void()>& work )
+      {
+         stage_counters& counters = ( stage == inbound_stage::decrypt ? decrypt_stage : decode_stage );
+         const fc::time_point entered = fc::time_point::now();
+         // shared with the worker, which may still signal it after the caller has stopped waiting
+         struct completion
+         {
+            std::mutex              mutex;
+            std::condition_variable cond;
+            bool                    done = false;
+            fc::time_point          finished;
+         };
+         const auto state = std::make_shared<completion>();
+
+         counters.enter();
+         fc::future<void> worker = fc::do_parallel( [&counters,&work,entered,state]() {
+            auto leave = [&]() {
+               counters.leave( entered );
+               dispatch_stage.enter();
+               std::lock_guard<std::mutex> guard( state->mutex );
+               state->finished = fc::time_point::now();
+               state->done = true;
+               state->cond.notify_all();
+            };
+            try
+            {
+               work();
+            }
+            catch( ... )
+            {
+               leave();
+               throw;
+            }
+            leave();
+         } );
+
+         try
+         {
+            worker.wait();
+         }
+         catch( ... )
+         {
+            // the work refers to data of the caller, which must stay alive until the work has finished,
+            // also when the waiting task has been canceled
+            std::unique_lock<std::mutex> lock( state->mutex );
+            state->cond.wait( lock, [&state]() { return state->done; } );
+            dispatch_stage.leave( state->finished );
+            throw;
+         }
+         std::lock_guard<std::mutex> guard( state->mutex );
+         dispatch_stage.leave( state->finished );
+      }
+   }
+
+} } // graphene::net
@@ -45,6 +45,8 @@ namespace graphene { namespace net {
 
       std::atomic_bool _send_message_in_progress;
       std::atomic_bool _read_loop_in_progress;
+      /// Padded messages being sent, kept to reuse the memory
+      std::vector<char> _send_buffer;
 #ifndef NDEBUG
       fc::thread* _thread;
 #endif
@@ -62,6 +64,7 @@ namespace graphene { namespace net {
       ~message_oriented_connection_impl();
 
       void send_message(const message& message_to_send);
+      void send_messages(const message* messages_to_send, size_t count);
       void close_connection();
       void destroy_connection();
 
@@ -190,7 +193,7 @@ namespace graphene { namespace net {
           try
           {
             // message handling errors are warnings...
-            _delegate->on_message(_self, m);
+            _delegate->on_message(_self, std::move(m));
           }
           /// Dedicated catches needed to distinguish from general fc::exception
           catch ( const fc::canceled_exception& e ) { throw; }
@@ -266,27 +269,43 @@ namespace graphene { namespace net {
       } send_message_scope_logger(remote_endpoint);
 #endif
 #endif
+      send_messages( &message_to_send, 1 );
+    }
+
+    void message_oriented_connection_impl::send_messages(const message* messages_to_send, size_t count)
+    {
+      VERIFY_CORRECT_THREAD();
       no_parallel_execution_guard guard( &_send_message_in_progress );
       _ready_for_sending->wait();
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size.value();
-        if( message_to_send.size.value() > MAX_MESSAGE_SIZE )
-           elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::vector<char> padded_message( size_with_padding );
-
-        memcpy( padded_message.data(), (const char*)&message_to_send, sizeof(message_header) );
-        memcpy( padded_message.data() + sizeof(message_header), message_to_send.data.data(),
-                message_to_send.size.value() );
-        char* padding_space = padded_message.data() + sizeof(message_header) + message_to_send.size.value();
-        memset(padding_space, 0, size_with_padding - size_of_message_and_header);
-        _sock.write( padded_message.data(), size_with_padding );
+        _send_buffer.clear();
+        for( size_t i = 0; i < count; ++i )
+        {
+          const message& message_to_send = messages_to_send[i];
+          size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size.value();
+          if( message_to_send.size.value() > MAX_MESSAGE_SIZE )
+             elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
+          //pad each message we send to a multiple of 16 bytes
+          size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
+          size_t offset = _send_buffer.size();
+          _send_buffer.resize( offset + size_with_padding );
+
+          char* padded_message = _send_buffer.data() + offset;
+          memcpy( padded_message, (const char*)&message_to_send, sizeof(message_header) );
+          memcpy( padded_message + sizeof(message_header), message_to_send.data.data(),
+                  message_to_send.size.value() );
+          char* padding_space = padded_message + size_of_message_and_header;
+          memset(padding_space, 0, size_with_padding - size_of_message_and_header);
+        }
+        _sock.write( _send_buffer.data(), _send_buffer.size() );
         _sock.flush();
-        _bytes_sent += size_with_padding;
+        _bytes_sent += _send_buffer.size();
         _last_message_sent_time = fc::time_point::now();
+        // do not keep the memory of an unusually large message for every connection
+        if( _send_buffer.capacity() > 2 * GRAPHENE_NET_MAX_SEND_BATCH_SIZE )
+          std::vector<char>().swap( _send_buffer );
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" )
     }
 
@@ -392,6 +411,11 @@ namespace graphene { namespace net {
     my->send_message(message_to_send);
   }
 
+  void message_oriented_connection::send_messages(const std::vector<message>& messages_to_send)
+  {
+    my->send_messages(messages_to_send.data(), messages_to_send.size());
+  }
+
   void message_oriented_connection::close_connection()
   {
     my->close_connection();
@@ -113,6 +113,40 @@ namespace graphene { namespace net { namespace detail {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
    }
 
+    fc::optional<message> blockchain_tied_message_cache::get_message_by_contents_hash(
+             const message_hash_type& hash_of_msg_contents_to_lookup ) const
+    {
+      const auto& index = _message_cache.get<message_contents_hash_index>();
+      auto iter = index.find( hash_of_msg_contents_to_lookup );
+      if( iter != index.end() )
+        return iter->message_body;
+      return fc::optional<message>();
+    }
+
+    fc::optional<graphene::protocol::precomputable_transaction> blockchain_tied_message_cache::find_transaction(
+             const short_transaction_id& short_id ) const
+    {
+      // transactions are cached with their IDs as contents hashes, so all candidates are adjacent in the index
+      message_hash_type lowest_candidate;
+      memcpy( lowest_candidate.data(), short_id.data, sizeof(short_id.data) );
+      const auto& index = _message_cache.get<message_contents_hash_index>();
+      const message_info* found = nullptr;
+      for( auto iter = index.lower_bound( lowest_candidate );
+           iter != index.end() && memcmp( iter->message_contents_hash.data(), short_id.data, sizeof(short_id.data) ) == 0;
+           ++iter )
+      {
+        if( iter->message_body.msg_type.value() != trx_message_type )
+          continue;
+        if( found != nullptr && found->message_contents_hash != iter->message_contents_hash )
+          return fc::optional<graphene::protocol::precomputable_transaction>(); // ambiguous
+        if( found == nullptr )
+          found = &*iter;
+      }
+      if( found == nullptr )
+        return fc::optional<graphene::protocol::precomputable_transaction>();
+      return found->message_body.as<trx_message>().trx;
+    }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data(
              const message_hash_type& hash_of_msg_contents_to_lookup ) const
     {
@@ -507,10 +541,7 @@ namespace graphene { namespace net { namespace detail {
     bool node_impl::have_already_received_sync_item( const item_hash_t& item_hash )
     {
       VERIFY_CORRECT_THREAD();
-      return std::find_if(_received_sync_items.begin(), _received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _received_sync_items.end() ||
-             std::find_if(_new_received_sync_items.begin(), _new_received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _new_received_sync_items.end();                          ;
+      return _received_sync_item_ids.find( item_hash ) != _received_sync_item_ids.end();
     }
 
     void node_impl::request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request )
@@ -518,8 +549,10 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       dlog( "requesting item ${item_hash} from peer ${endpoint}", ("item_hash", item_to_request )("endpoint", peer->get_remote_endpoint() ) );
       item_id item_id_to_request( graphene::net::block_message_type, item_to_request );
-      _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
-      peer->last_sync_item_received_time = fc::time_point::now();
+      _active_sync_requests[item_to_request] = fc::time_point::now();
+      // if the peer is still sending blocks requested earlier, the time of the last one stays
+      if (peer->sync_items_requested_from_peer.empty())
+        peer->last_sync_item_received_time = fc::time_point::now();
       peer->sync_items_requested_from_peer.insert(item_to_request);
       peer->send_message( fetch_items_message(item_id_to_request.item_type, std::vector<item_hash_t>{item_id_to_request.item_hash} ) );
     }
@@ -529,10 +562,12 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       dlog( "requesting ${item_count} item(s) ${items_to_request} from peer ${endpoint}",
             ("item_count", items_to_request.size())("items_to_request", items_to_request)("endpoint", peer->get_remote_endpoint()) );
+      // if the peer is still sending blocks requested earlier, the time of the last one stays
+      if (peer->sync_items_requested_from_peer.empty())
+        peer->last_sync_item_received_time = fc::time_point::now();
       for (const item_hash_t& item_to_request : items_to_request)
       {
-        _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
-        peer->last_sync_item_received_time = fc::time_point::now();
+        _active_sync_requests[item_to_request] = fc::time_point::now();
         peer->sync_items_requested_from_peer.insert(item_to_request);
       }
       peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_request));
@@ -548,43 +583,71 @@ namespace graphene { namespace net { namespace detail {
 
         if (!_suspend_fetching_sync_blocks)
         {
+          reassign_stalled_sync_requests();
+
           std::map<peer_connection_ptr, std::vector<item_hash_t> > sync_item_requests_to_send;
 
           {
             std::set<item_hash_t> sync_items_to_request;
 
-            // for each idle peer that we're syncing with
+            // blocks requested or received but not yet handed to the client are limited, except for the first
+            // ones each peer has, which are the ones the client is waiting for
+            const size_t sync_items_on_hand = _active_sync_requests.size() + _received_sync_item_ids.size();
+            size_t sync_items_allowed = _max_sync_blocks_to_prefetch > sync_items_on_hand ?
+                                        _max_sync_blocks_to_prefetch - sync_items_on_hand : 0;
+
+            // for each peer that we're syncing with and that can take more requests, fastest first, so that
+            // the fastest peers get the blocks the client needs first
             fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
+            std::vector<peer_connection_ptr> peers_to_request_from;
             for( const peer_connection_ptr& peer : _active_connections )
             {
               if( peer->we_need_sync_items_from_peer &&
-                  // if we've already scheduled a request for this peer, don't consider scheduling another
-                  sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() &&
-                  peer->idle() )
+                  !peer->inhibit_fetching_sync_blocks &&
+                  can_request_more_sync_items(*peer) )
+                peers_to_request_from.push_back( peer );
+            }
+            std::stable_sort( peers_to_request_from.begin(), peers_to_request_from.end(),
+                              [this]( const peer_connection_ptr& a, const peer_connection_ptr& b ) {
+                                 return sync_request_size(*a) > sync_request_size(*b);
+                              } );
+
+            for( const peer_connection_ptr& peer : peers_to_request_from )
+            {
+              const size_t outstanding = peer->sync_items_requested_from_peer.size();
+              const size_t request_size = sync_request_size(*peer);
+              if( outstanding >= request_size )
+                continue;
+              std::vector<item_hash_t>& items_for_peer = sync_item_requests_to_send[peer];
+              size_t position = 0;
+              // loop through the items it has that we don't yet have on our blockchain
+              for( const auto& item_to_potentially_request : peer->ids_of_items_to_get )
               {
-                if (!peer->inhibit_fetching_sync_blocks)
+                // if we don't already have this item in our temporary storage
+                // and we haven't requested from another syncing peer
+                if( // already got it, but for some reson it's still in our list of items to fetch
+                    !have_already_received_sync_item(item_to_potentially_request) )
                 {
-                  // loop through the items it has that we don't yet have on our blockchain
-                  for( const auto& item_to_potentially_request : peer->ids_of_items_to_get )
+                  const bool needed_first = ( position++ < GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+                  if( // we have already decided to request it from another peer during this iteration
+                      sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&
+                      // we've requested it in a previous iteration and we're still waiting for it to arrive
+                      _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() )
                   {
-                    // if we don't already have this item in our temporary storage
-                    // and we haven't requested from another syncing peer
-                    if( // already got it, but for some reson it's still in our list of items to fetch
-                        !have_already_received_sync_item(item_to_potentially_request) &&
-                        // we have already decided to request it from another peer during this iteration
-                        sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&
-                        // we've requested it in a previous iteration and we're still waiting for it to arrive
-                        _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() )
-                    {
-                      // then schedule a request from this peer
-                      sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                      sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _max_sync_blocks_per_peer)
-                        break;
-                    }
+                    if( !needed_first && sync_items_allowed == 0 )
+                      break;
+                    // then schedule a request from this peer
+                    items_for_peer.push_back(item_to_potentially_request);
+                    sync_items_to_request.insert( item_to_potentially_request );
+                    if( sync_items_allowed > 0 )
+                      --sync_items_allowed;
+                    if( outstanding + items_for_peer.size() >= request_size )
+                      break;
                   }
                 }
               }
+              if( items_for_peer.empty() )
+                sync_item_requests_to_send.erase( peer );
             }
           } // end non-preemptable section
 
@@ -601,12 +664,139 @@ namespace graphene { namespace net { namespace detail {
           dlog( "no sync items to fetch right now, going to sleep" );
           _retrigger_fetch_sync_items_loop_promise
                 = fc::promise<void>::create("graphene::net::retrigger_fetch_sync_items_loop");
-          _retrigger_fetch_sync_items_loop_promise->wait();
+          if( _active_sync_requests.empty() )
+            _retrigger_fetch_sync_items_loop_promise->wait();
+          else
+          {
+            // wake up regularly to check for stalled requests
+            try
+            {
+              _retrigger_fetch_sync_items_loop_promise->wait( fc::seconds( GRAPHENE_NET_MIN_SYNC_STALL_SEC ) );
+            }
+            catch( const fc::timeout_exception& )
+            {
+            }
+          }
           _retrigger_fetch_sync_items_loop_promise.reset();
         }
       } // while( !canceled )
     }
 
+    size_t node_impl::sync_request_size( const peer_connection& peer ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      const size_t min_size = std::min<size_t>( GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING,
+                                                _max_sync_blocks_per_peer );
+      if( peer.sync_block_interval.count() <= 0 )
+        return min_size;
+      const int64_t blocks_per_request = fc::seconds( GRAPHENE_NET_SYNC_REQUEST_DURATION_SEC ).count()
+                                         / peer.sync_block_interval.count();
+      return std::max<size_t>( min_size, std::min<uint64_t>( _max_sync_blocks_per_peer, blocks_per_request ) );
+    }
+
+    bool node_impl::can_request_more_sync_items( const peer_connection& peer ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      if( peer.idle() )
+        return true;
+      // we only ask a peer for more item IDs when it is idle, so let it become idle when its list runs low
+      if( peer.item_ids_requested_from_peer || !peer.items_requested_from_peer.empty() ||
+          ( peer.number_of_unfetched_item_ids > 0 &&
+            peer.ids_of_items_to_get.size() < GRAPHENE_NET_MIN_BLOCK_IDS_TO_PREFETCH ) )
+        return false;
+      return peer.sync_items_requested_from_peer.size() <= sync_request_size( peer ) / 2;
+    }
+
+    void node_impl::update_sync_throughput( peer_connection* peer )
+    {
+      VERIFY_CORRECT_THREAD();
+      const fc::time_point now = fc::time_point::now();
+      const fc::microseconds interval = now - peer->last_sync_item_received_time;
+      // moving average, the latest block has a weight of 1/8
+      if( peer->sync_block_interval.count() <= 0 )
+        peer->sync_block_interval = interval;
+      else
+        peer->sync_block_interval = fc::microseconds( ( peer->sync_block_interval.count() * 7 + interval.count() ) / 8 );
+      peer->last_sync_item_received_time = now;
+    }
+
+    bool node_impl::reassign_stalled_sync_requests()
+    {
+      VERIFY_CORRECT_THREAD();
+      // stalled requests only hold back the client if blocks received after them are waiting
+      if( _received_sync_item_ids.empty() )
+        return false;
+
+      const fc::time_point now = fc::time_point::now();
+      std::vector<peer_connection_ptr> stalled_peers;
+      std::vector<peer_connection_ptr> other_peers;
+      {
+        fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
+        for( const peer_connection_ptr& peer : _active_connections )
+        {
+          if( !peer->we_need_sync_items_from_peer )
+            continue;
+          const fc::microseconds stall_time = std::max( fc::seconds( GRAPHENE_NET_MIN_SYNC_STALL_SEC ),
+                fc::microseconds( peer->sync_block_interval.count() * GRAPHENE_NET_SYNC_STALL_FACTOR ) );
+          if( !peer->sync_items_requested_from_peer.empty() && now - peer->last_sync_item_received_time > stall_time )
+            stalled_peers.push_back( peer );
+          else if( !peer->inhibit_fetching_sync_blocks && can_request_more_sync_items( *peer ) )
+            other_peers.push_back( peer );
+        }
+      }
+      if( stalled_peers.empty() || other_peers.empty() )
+        return false;
+
+      std::stable_sort( other_peers.begin(), other_peers.end(),
+                        [this]( const peer_connection_ptr& a, const peer_connection_ptr& b ) {
+                           return sync_request_size(*a) > sync_request_size(*b);
+                        } );
+
+      bool reassigned = false;
+      for( const peer_connection_ptr& stalled_peer : stalled_peers )
+      {
+        // it is not as fast as we thought
+        stalled_peer->sync_block_interval = std::max( stalled_peer->sync_block_interval,
+                                                      now - stalled_peer->last_sync_item_received_time );
+        std::set<item_hash_t> items_to_move = stalled_peer->sync_items_requested_from_peer;
+        for( const peer_connection_ptr& peer : other_peers )
+        {
+          const size_t request_size = sync_request_size(*peer);
+          const size_t outstanding = peer->sync_items_requested_from_peer.size();
+          if( outstanding >= request_size )
+            continue;
+          // in the order of the chain, so that the blocks the client is waiting for move first
+          std::vector<item_hash_t> items_for_peer;
+          for( const item_hash_t& item : peer->ids_of_items_to_get )
+          {
+            if( items_to_move.erase( item ) > 0 )
+            {
+              items_for_peer.push_back( item );
+              if( outstanding + items_for_peer.size() >= request_size || items_to_move.empty() )
+                break;
+            }
+          }
+          if( items_for_peer.empty() )
+            continue;
+
+          for( const item_hash_t& item : items_for_peer )
+          {
+            stalled_peer->sync_items_requested_from_peer.erase( item );
+            stalled_peer->sync_items_reassigned_from_peer.insert( item );
+          }
+          _reassigned_sync_requests += items_for_peer.size();
+          wlog( "Requesting ${count} sync blocks from peer ${peer} instead of stalled peer ${stalled_peer}",
+                ("count", items_for_peer.size())("peer", peer->get_remote_endpoint())
+                ("stalled_peer", stalled_peer->get_remote_endpoint()) );
+          request_sync_items_from_peer( peer, items_for_peer );
+          reassigned = true;
+          if( items_to_move.empty() )
+            break;
+        }
+      }
+      return reassigned;
+    }
+
     void node_impl::trigger_fetch_sync_items_loop()
     {
       VERIFY_CORRECT_THREAD();
@@ -1366,10 +1556,11 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    void node_impl::on_message( peer_connection* originating_peer, const message& received_message )
+    void node_impl::on_message( peer_connection* originating_peer, const decoded_message& decoded )
     {
       VERIFY_CORRECT_THREAD();
-      message_hash_type message_hash = received_message.id();
+      const message& received_message = decoded.msg;
+      const message_hash_type& message_hash = decoded.hash;
       dlog("handling message ${type} ${hash} size ${size} from peer ${endpoint}",
            ("type", graphene::net::core_message_type_enum(received_message.msg_type.value()))("hash", message_hash)
            ("size", received_message.size)
@@ -1423,7 +1614,18 @@ namespace graphene { namespace net { namespace detail {
         on_closing_connection_message(originating_peer, received_message.as<closing_connection_message>());
         break;
       case core_message_type_enum::block_message_type:
-        process_block_message(originating_peer, received_message, message_hash);
+        process_block_message(originating_peer, *decoded.block, message_hash);
+        break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_compact_block_transactions_message_type:
+        on_fetch_compact_block_transactions_message(originating_peer,
+              received_message.as<fetch_compact_block_transactions_message>());
+        break;
+      case core_message_type_enum::compact_block_transactions_message_type:
+        on_compact_block_transactions_message(originating_peer,
+              received_message.as<compact_block_transactions_message>());
         break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
@@ -1445,7 +1647,7 @@ namespace graphene { namespace net { namespace detail {
         // to allow us to add messages in the future
         if (received_message.msg_type.value() < core_message_type_enum::core_message_type_first ||
             received_message.msg_type.value() > core_message_type_enum::core_message_type_last)
-          process_ordinary_message(originating_peer, received_message, message_hash);
+          process_ordinary_message(originating_peer, decoded);
         break;
       }
     }
@@ -1475,6 +1677,7 @@ namespace graphene { namespace net { namespace detail {
       user_data["bitness"] = sizeof(void*) * 8;
 
       user_data["node_id"] = fc::variant( _node_id, 1 );
+      user_data["compact_blocks"] = true;
 
       item_hash_t head_block_id = _delegate->get_head_block_id();
       user_data["last_known_block_hash"] = fc::variant( head_block_id, 1 );
@@ -1508,6 +1711,8 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->node_id = user_data["node_id"].as<node_id_t>(1);
       if (user_data.contains("last_known_fork_block_number"))
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>(1);
+      if (user_data.contains("compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as_bool();
     }
 
    void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -2673,9 +2878,18 @@ namespace graphene { namespace net { namespace detail {
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
                ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            // a block which is still cached is recent, the peer most likely has its transactions already
+            if (originating_peer->supports_compact_blocks)
+            {
+              reply_messages.push_back(
+                    compact_block_message(requested_message.as<graphene::net::block_message>().block, item_hash));
+              continue;
+            }
+          }
+          reply_messages.push_back(requested_message);
           continue;
         }
         catch (fc::key_not_found_exception&)
@@ -2707,20 +2921,208 @@ namespace graphene { namespace net { namespace detail {
       // if we sent them a block, update our record of the last block they've seen accordingly
       if (last_block_message_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        const block_id_type block_id = graphene::net::block_message::id_of( *last_block_message_sent );
+        originating_peer->last_block_delegate_has_seen = block_id;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block_id);
       }
 
       for (const message& reply : reply_messages)
       {
         if (reply.msg_type.value() == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+          originating_peer->send_item(item_id(block_message_type, graphene::net::block_message::id_of(reply)));
         else
           originating_peer->send_message(reply);
       }
     }
 
+    void node_impl::on_compact_block_message( peer_connection* originating_peer,
+                                              const compact_block_message& compact_block_message_received )
+    {
+      VERIFY_CORRECT_THREAD();
+      const block_id_type block_id = compact_block_message_received.header.id();
+      const auto& compact_transactions = compact_block_message_received.transactions;
+      dlog( "received compact block ${id} with ${n} transactions from peer ${endpoint}",
+            ("id", block_id)("n", compact_transactions.size())("endpoint", originating_peer->get_remote_endpoint()) );
+
+      // Gatekeeping code, compact blocks are only sent in reply to our requests for blocks.  During normal
+      // operation blocks are requested by the hash of their block_message, which is checked against the
+      // reassembled block in process_compact_block()
+      if( originating_peer->items_requested_from_peer.find( item_id( block_message_type,
+                                                                     compact_block_message_received.item_hash ) )
+               == originating_peer->items_requested_from_peer.end()
+          && originating_peer->sync_items_requested_from_peer.find( block_id )
+               == originating_peer->sync_items_requested_from_peer.end() )
+      {
+        wlog( "received a compact block ${id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+              ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()) );
+        disconnect_from_peer( originating_peer, "You sent me a block that I didn't ask for" );
+        return;
+      }
+
+      peer_connection::partial_compact_block& partial = originating_peer->compact_blocks_in_progress[block_id];
+      partial = peer_connection::partial_compact_block();
+      partial.item_hash = compact_block_message_received.item_hash;
+      partial.header = compact_block_message_received.header;
+      partial.transactions.resize( compact_transactions.size() );
+      for( uint32_t i = 0; i < compact_transactions.size(); ++i )
+      {
+        fc::optional<graphene::protocol::precomputable_transaction> trx
+              = _message_cache.find_transaction( compact_transactions[i].short_id );
+        if( trx.valid() )
+        {
+          partial.transactions[i] = graphene::protocol::processed_transaction( *trx );
+          partial.transactions[i].operation_results = compact_transactions[i].operation_results;
+        }
+        else
+          partial.missing_transactions.push_back( i );
+      }
+
+      if( partial.missing_transactions.empty() )
+        process_compact_block( originating_peer, block_id );
+      else
+      {
+        dlog( "requesting ${n} missing transactions of compact block ${id} from peer ${endpoint}",
+              ("n", partial.missing_transactions.size())("id", block_id)
+              ("endpoint", originating_peer->get_remote_endpoint()) );
+        originating_peer->send_message(
+              fetch_compact_block_transactions_message( block_id, partial.missing_transactions ) );
+      }
+    }
+
+    void node_impl::on_fetch_compact_block_transactions_message( peer_connection* originating_peer,
+                                                                 const fetch_compact_block_transactions_message& request )
+    {
+      VERIFY_CORRECT_THREAD();
+      // Gatekeeping code
+      if( originating_peer->their_state != peer_connection::their_connection_state::connection_accepted )
+      {
+         wlog( "Unexpected fetch_compact_block_transactions_message from peer ${peer}, disconnecting",
+               ("peer", originating_peer->get_remote_endpoint()) );
+         disconnect_from_peer( originating_peer, "Received an unexpected fetch_compact_block_transactions_message" );
+         return;
+      }
+
+      fc::optional<signed_block> block;
+      fc::optional<message> cached_message = _message_cache.get_message_by_contents_hash( request.block_id );
+      if( cached_message.valid() && cached_message->msg_type.value() == block_message_type )
+        block = cached_message->as<graphene::net::block_message>().block;
+      else
+      {
+        try
+        {
+          block = _delegate->get_item( item_id( block_message_type, request.block_id ) )
+                           .as<graphene::net::block_message>().block;
+        }
+        catch( const fc::key_not_found_exception& )
+        {
+          // the reply without transactions tells the peer to get the block elsewhere
+        }
+      }
+
+      compact_block_transactions_message reply;
+      reply.block_id = request.block_id;
+      if( block.valid() )
+      {
+        reply.transactions.reserve( request.transaction_indexes.size() );
+        for( uint32_t index : request.transaction_indexes )
+        {
+          if( index >= block->transactions.size() )
+          {
+            reply.transactions.clear();
+            break;
+          }
+          reply.transactions.push_back( block->transactions[index] );
+        }
+      }
+      originating_peer->send_message( reply );
+    }
+
+    void node_impl::on_compact_block_transactions_message( peer_connection* originating_peer,
+                                                           const compact_block_transactions_message& reply )
+    {
+      VERIFY_CORRECT_THREAD();
+      auto iter = originating_peer->compact_blocks_in_progress.find( reply.block_id );
+      if( iter == originating_peer->compact_blocks_in_progress.end() )
+      {
+        dlog( "received transactions of compact block ${id} I am not waiting for from peer ${endpoint}",
+              ("id", reply.block_id)("endpoint", originating_peer->get_remote_endpoint()) );
+        return;
+      }
+
+      peer_connection::partial_compact_block& partial = iter->second;
+      if( reply.transactions.empty() && !partial.missing_transactions.empty() )
+      {
+        // The peer does not have the block any more.  Drop what we have of it and fetch the full block
+        // from another peer, as if the peer had replied with an item_not_available_message.
+        dlog( "peer ${endpoint} does not have the transactions of compact block ${id} any more",
+              ("id", reply.block_id)("endpoint", originating_peer->get_remote_endpoint()) );
+        item_id requested_item( block_message_type, partial.item_hash );
+        if( originating_peer->items_requested_from_peer.find( requested_item )
+              == originating_peer->items_requested_from_peer.end() )
+          requested_item.item_hash = reply.block_id; // requested while syncing
+        originating_peer->compact_blocks_in_progress.erase( iter );
+        on_item_not_available_message( originating_peer, item_not_available_message( requested_item ) );
+        return;
+      }
+      if( reply.transactions.size() != partial.missing_transactions.size() )
+      {
+        wlog( "peer ${endpoint} did not send the transactions of compact block ${id}, disconnecting from peer",
+              ("id", reply.block_id)("endpoint", originating_peer->get_remote_endpoint()) );
+        originating_peer->compact_blocks_in_progress.erase( iter );
+        // the block will be fetched from another peer
+        disconnect_from_peer( originating_peer, "You did not send me the transactions of a block I asked for" );
+        return;
+      }
+
+      for( size_t i = 0; i < reply.transactions.size(); ++i )
+        partial.transactions[ partial.missing_transactions[i] ] = reply.transactions[i];
+      partial.missing_transactions.clear();
+      process_compact_block( originating_peer, reply.block_id );
+    }
+
+    void node_impl::process_compact_block( peer_connection* originating_peer, const block_id_type& block_id )
+    {
+      VERIFY_CORRECT_THREAD();
+      auto iter = originating_peer->compact_blocks_in_progress.find( block_id );
+      if( iter == originating_peer->compact_blocks_in_progress.end() )
+        return;
+      peer_connection::partial_compact_block& partial = iter->second;
+
+      signed_block block;
+      static_cast<graphene::protocol::signed_block_header&>( block ) = partial.header;
+      block.transactions = partial.transactions;
+      if( block.calculate_merkle_root() != block.transaction_merkle_root && !partial.fetched_all_transactions )
+      {
+        // A transaction we have differs from the one in the block, e.g. by its signatures,
+        // or a short ID matched the wrong one.  Get all of them from the peer.
+        dlog( "transactions of compact block ${id} do not match its header, requesting all of them from peer ${endpoint}",
+              ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()) );
+        partial.fetched_all_transactions = true;
+        partial.missing_transactions.resize( partial.transactions.size() );
+        for( uint32_t i = 0; i < partial.missing_transactions.size(); ++i )
+          partial.missing_transactions[i] = i;
+        originating_peer->send_message(
+              fetch_compact_block_transactions_message( block_id, partial.missing_transactions ) );
+        return;
+      }
+      const item_hash_t requested_item_hash = partial.item_hash;
+      originating_peer->compact_blocks_in_progress.erase( iter );
+
+      // from here on, the block is handled as if it had been received in a block_message
+      graphene::net::block_message block_message_to_process( block );
+      const message_hash_type message_hash = message( block_message_to_process ).id();
+      if( message_hash != requested_item_hash
+          && originating_peer->sync_items_requested_from_peer.find( block_id )
+               == originating_peer->sync_items_requested_from_peer.end() )
+      {
+        wlog( "compact block ${id} from peer ${endpoint} is not the block I asked for, disconnecting from peer",
+              ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()) );
+        disconnect_from_peer( originating_peer, "You sent me a block that I didn't ask for" );
+        return;
+      }
+      process_block_message( originating_peer, block_message_to_process, message_hash );
+    }
+
     void node_impl::on_item_not_available_message( peer_connection* originating_peer, const item_not_available_message& item_not_available_message_received )
     {
       VERIFY_CORRECT_THREAD();
@@ -3219,6 +3621,7 @@ namespace graphene { namespace net { namespace detail {
                           received_block_iter->block_id) == _most_recent_blocks_accepted.end())
             {
               graphene::net::block_message block_message_to_process = *received_block_iter;
+              _received_sync_item_ids.erase(received_block_iter->block_id);
               _received_sync_items.erase(received_block_iter);
               _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process](){
                 send_sync_block_to_node_delegate(block_message_to_process);
@@ -3296,6 +3699,7 @@ namespace graphene { namespace net { namespace detail {
       // add it to the front of _received_sync_items, then process _received_sync_items to try to
       // pass as many messages as possible to the client.
       _new_received_sync_items.push_front( block_message_to_process );
+      _received_sync_item_ids.insert( block_message_to_process.block_id );
       trigger_process_backlog_of_sync_blocks();
     }
 
@@ -3462,7 +3866,7 @@ namespace graphene { namespace net { namespace detail {
       }
     }
     void node_impl::process_block_message(peer_connection* originating_peer,
-                                          const message& message_to_process,
+                                          const graphene::net::block_message& block_message_to_process,
                                           const message_hash_type& message_hash)
     {
       VERIFY_CORRECT_THREAD();
@@ -3470,7 +3874,6 @@ namespace graphene { namespace net { namespace detail {
       // (it's possible that we request an item during normal operation and then get kicked into sync
       // mode before we receive and process the item.  In that case, we should process the item as a normal
       // item to avoid confusing the sync code)
-      graphene::net::block_message block_message_to_process(message_to_process.as<graphene::net::block_message>());
       auto item_iter = originating_peer->items_requested_from_peer.find(
                              item_id(graphene::net::block_message_type, message_hash));
       if (item_iter != originating_peer->items_requested_from_peer.end())
@@ -3493,7 +3896,7 @@ namespace graphene { namespace net { namespace detail {
           // of the function so we can log if this ever happens.
           try
           {
-            originating_peer->last_sync_item_received_time = fc::time_point::now();
+            update_sync_throughput(originating_peer);
             _active_sync_requests.erase(block_message_to_process.block_id);
             process_block_during_syncing(originating_peer, block_message_to_process, message_hash);
             if (originating_peer->idle())
@@ -3506,6 +3909,8 @@ namespace graphene { namespace net { namespace detail {
               else
                 trigger_fetch_sync_items_loop();
             }
+            else if (can_request_more_sync_items(*originating_peer))
+              trigger_fetch_sync_items_loop(); // keep the peer busy while it sends the rest
             return;
           }
           catch (const fc::canceled_exception& e)
@@ -3527,6 +3932,20 @@ namespace graphene { namespace net { namespace detail {
             elog("Caught unexpected exception, could break sync operation");
           }
         }
+
+        // we requested it, but it was late and we have requested it from another peer since
+        auto reassigned_item_iter = originating_peer->sync_items_reassigned_from_peer.find(
+                                          block_message_to_process.block_id );
+        if (reassigned_item_iter != originating_peer->sync_items_reassigned_from_peer.end())
+        {
+          originating_peer->sync_items_reassigned_from_peer.erase(reassigned_item_iter);
+          update_sync_throughput(originating_peer);
+          dlog("ignoring sync block ${block_id} from peer ${endpoint}, it has been requested from another peer",
+               ("block_id", block_message_to_process.block_id)("endpoint", originating_peer->get_remote_endpoint()));
+          if (can_request_more_sync_items(*originating_peer))
+            trigger_fetch_sync_items_loop();
+          return;
+        }
       }
 
       // if we get here, we didn't request the message, we must have a misbehaving peer
@@ -3574,10 +3993,11 @@ namespace graphene { namespace net { namespace detail {
     // this just passes the message to the client, and does the bookkeeping
     // related to requesting and rebroadcasting the message.
     void node_impl::process_ordinary_message( peer_connection* originating_peer,
-                                              const message& message_to_process,
-                                              const message_hash_type& message_hash )
+                                              const decoded_message& decoded )
     {
       VERIFY_CORRECT_THREAD();
+      const message& message_to_process = decoded.msg;
+      const message_hash_type& message_hash = decoded.hash;
       fc::time_point message_receive_time = fc::time_point::now();
 
       // only process it if we asked for it
@@ -3605,7 +4025,7 @@ namespace graphene { namespace net { namespace detail {
         {
           if (message_to_process.msg_type.value() == trx_message_type)
           {
-            trx_message transaction_message_to_process = message_to_process.as<trx_message>();
+            const trx_message& transaction_message_to_process = *decoded.trx;
             dlog( "passing message containing transaction ${trx} to client",
                   ("trx", transaction_message_to_process.trx.id()) );
             _delegate->handle_transaction(transaction_message_to_process);
@@ -4250,6 +4670,11 @@ namespace graphene { namespace net { namespace detail {
       fc::path potential_peer_database_file_name(_node_configuration_directory / POTENTIAL_PEER_DATABASE_FILENAME);
       try
       {
+        // the peer database converts the file written by older versions when it opens it
+        fc::path legacy_potential_peer_database_file_name(_node_configuration_directory / LEGACY_POTENTIAL_PEER_DATABASE_FILENAME);
+        if (!fc::exists(potential_peer_database_file_name) && fc::exists(legacy_potential_peer_database_file_name))
+          fc::rename(legacy_potential_peer_database_file_name, potential_peer_database_file_name);
+
         _potential_peer_db.open(potential_peer_database_file_name);
 
         // push back the time on all peers loaded from the database so we will be able to retry them immediately
@@ -4836,6 +5261,8 @@ namespace graphene { namespace net { namespace detail {
 
         peer_details["peer_needs_sync_items_from_us"] = peer->peer_needs_sync_items_from_us;
         peer_details["we_need_sync_items_from_peer"] = peer->we_need_sync_items_from_peer;
+        peer_details["sync_items_requested"] = peer->sync_items_requested_from_peer.size();
+        peer_details["sync_block_interval_us"] = peer->sync_block_interval.count();
 
         this_peer_status.info = peer_details;
         statuses.push_back(this_peer_status);
@@ -4922,6 +5349,8 @@ namespace graphene { namespace net { namespace detail {
         _max_sync_blocks_to_prefetch = params["max_sync_blocks_to_prefetch"].as<uint32_t>(1);
       if (params.contains("max_sync_blocks_per_peer"))
         _max_sync_blocks_per_peer = params["max_sync_blocks_per_peer"].as<uint32_t>(1);
+      if (params.contains("maximum_peer_database_size"))
+        _potential_peer_db.set_maximum_size(params["maximum_peer_database_size"].as<uint32_t>(1));
 
       _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -4942,6 +5371,7 @@ namespace graphene { namespace net { namespace detail {
       result["max_blocks_to_handle_at_once"] = _max_blocks_to_handle_at_once;
       result["max_sync_blocks_to_prefetch"] = _max_sync_blocks_to_prefetch;
       result["max_sync_blocks_per_peer"] = _max_sync_blocks_per_peer;
+      result["maximum_peer_database_size"] = uint64_t(_potential_peer_db.get_maximum_size());
       return result;
     }
 
@@ -5008,6 +5438,10 @@ namespace graphene { namespace net { namespace detail {
       info["listening_on"] = std::string( _actual_listening_endpoint );
       info["node_public_key"] = fc::variant( _node_public_key, 1 );
       info["node_id"] = fc::variant( _node_id, 1 );
+      info["inbound_pipeline"] = fc::variant( get_inbound_pipeline_stats(), 2 );
+      info["active_sync_requests"] = _active_sync_requests.size();
+      info["buffered_sync_blocks"] = _received_sync_item_ids.size();
+      info["reassigned_sync_requests"] = _reassigned_sync_requests;
       return info;
     }
     fc::variant_object node_impl::network_get_usage_stats() const
@@ -211,6 +211,11 @@ public:
    message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
    message_propagation_data get_message_propagation_data(
          const message_hash_type& hash_of_msg_contents_to_lookup ) const;
+   /// Returns the cached message whose contents hash is @p hash_of_msg_contents_to_lookup
+   fc::optional<message> get_message_by_contents_hash( const message_hash_type& hash_of_msg_contents_to_lookup ) const;
+   /// Returns the cached transaction whose ID starts with @p short_id, if there is exactly one
+   fc::optional<graphene::protocol::precomputable_transaction> find_transaction(
+         const short_transaction_id& short_id ) const;
    size_t size() const { return _message_cache.size(); }
 };
 
@@ -407,7 +412,9 @@ public:
       fc::sha256           _chain_id;
 
 #define NODE_CONFIGURATION_FILENAME      "node_config.json"
-#define POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
+#define POTENTIAL_PEER_DATABASE_FILENAME "peers.dat"
+/// Name of the peer database file written as JSON by older versions
+#define LEGACY_POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
       fc::path             _node_configuration_directory;
       node_configuration   _node_configuration;
 
@@ -444,6 +451,10 @@ public:
       /// List of sync blocks we've received, but can't yet process because we are still missing blocks
       /// that come earlier in the chain
       std::list<graphene::net::block_message> _received_sync_items;
+      /// IDs of the blocks in the two lists above
+      std::unordered_set<graphene::net::block_id_type> _received_sync_item_ids;
+      /// Number of sync requests moved from a stalled peer to another one
+      uint64_t _reassigned_sync_requests = 0;
       /// @}
 
       fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -626,6 +637,14 @@ public:
       bool have_already_received_sync_item( const item_hash_t& item_hash );
       void request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request );
       void request_sync_items_from_peer( const peer_connection_ptr& peer, const std::vector<item_hash_t>& items_to_request );
+      /// Number of blocks to request from @p peer at a time during sync, based on its throughput
+      size_t sync_request_size( const peer_connection& peer ) const;
+      /// Whether @p peer can be asked for more sync blocks before it has sent all those requested already
+      bool can_request_more_sync_items( const peer_connection& peer ) const;
+      /// Records that a sync block has arrived from @p peer, to measure its throughput
+      void update_sync_throughput( peer_connection* peer );
+      /// Moves the sync requests of stalled peers to faster ones, returns whether any request was moved
+      bool reassign_stalled_sync_requests();
       void fetch_sync_items_loop();
       void trigger_fetch_sync_items_loop();
 
@@ -658,7 +677,7 @@ public:
       void parse_hello_user_data_for_peer( peer_connection* originating_peer, const fc::variant_object& user_data );
 
       void on_message( peer_connection* originating_peer,
-                       const message& received_message ) override;
+                       const decoded_message& decoded ) override;
 
       void on_hello_message( peer_connection* originating_peer,
                              const hello_message& hello_message_received );
@@ -686,6 +705,19 @@ public:
       void on_item_not_available_message( peer_connection* originating_peer,
                                           const item_not_available_message& item_not_available_message_received );
 
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+
+      void on_fetch_compact_block_transactions_message( peer_connection* originating_peer,
+                                                        const fetch_compact_block_transactions_message& request );
+
+      void on_compact_block_transactions_message( peer_connection* originating_peer,
+                                                  const compact_block_transactions_message& reply );
+
+      /// Hands a block reassembled from a compact_block_message to the regular block processing,
+      /// unless its transactions do not match the header and can still be fetched from the peer
+      void process_compact_block( peer_connection* originating_peer, const block_id_type& block_id );
+
       void on_item_ids_inventory_message( peer_connection* originating_peer,
                                           const item_ids_inventory_message& item_ids_inventory_message_received );
 
@@ -713,13 +745,12 @@ public:
                   const message_hash_type& message_hash);
       void process_block_message(
                   peer_connection* originating_peer,
-                  const message& message_to_process,
+                  const graphene::net::block_message& block_message_to_process,
                   const message_hash_type& message_hash);
 
       void process_ordinary_message(
                   peer_connection* originating_peer,
-                  const message& message_to_process,
-                  const message_hash_type& message_hash);
+                  const decoded_message& decoded);
 
       void start_synchronizing();
       void start_synchronizing_with_peer(const peer_connection_ptr& peer);
@@ -284,14 +284,14 @@ namespace graphene { namespace net
     } // connect_to()
 
     void peer_connection::on_message( message_oriented_connection* originating_connection,
-                                      const message& received_message )
+                                      message&& received_message )
     {
       VERIFY_CORRECT_THREAD();
       _currently_handling_message = true;
       BOOST_SCOPE_EXIT(this_) {
         this_->_currently_handling_message = false;
       } BOOST_SCOPE_EXIT_END
-      _node->on_message( this, received_message );
+      _node->on_message( this, decode_message( std::move(received_message) ) );
     }
 
     void peer_connection::on_connection_closed( message_oriented_connection* originating_connection )
@@ -313,20 +313,31 @@ namespace graphene { namespace net
 #endif
       while (!_queued_messages.empty())
       {
-        _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        // take the messages at the front of the queue, they are encrypted and written to the socket at once
+        std::vector<std::unique_ptr<queued_message>> batch;
+        std::vector<message> messages_to_send;
+        size_t batch_size = 0;
+        do
+        {
+          std::unique_ptr<queued_message>& next_message = _queued_messages.front();
+          next_message->transmission_start_time = fc::time_point::now();
+          messages_to_send.push_back(next_message->get_message(_node));
+          batch_size += sizeof(message_header) + messages_to_send.back().size.value();
+          batch.push_back(std::move(next_message));
+          _queued_messages.pop();
+        } while (!_queued_messages.empty() && batch_size < GRAPHENE_NET_MAX_SEND_BATCH_SIZE);
         try
         {
-          //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
-          //     "to send message of type ${type} for peer ${endpoint}",
-          //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
-          //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
+          //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_messages() "
+          //     "to send ${count} messages for peer ${endpoint}",
+          //     ("count", messages_to_send.size())("endpoint", get_remote_endpoint()));
+          _message_connection.send_messages(messages_to_send);
+          //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_messages() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
         catch (const fc::canceled_exception&)
         {
-          dlog("message_oriented_connection::send_message() was canceled, rethrowing canceled_exception");
+          dlog("message_oriented_connection::send_messages() was canceled, rethrowing canceled_exception");
           throw;
         }
         catch (const fc::exception& send_error)
@@ -350,9 +361,12 @@ namespace graphene { namespace net
         {
           wlog("message_oriented_exception::send_message() threw an unhandled exception");
         }
-        _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-        _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-        _queued_messages.pop();
+        fc::time_point transmission_finish_time = fc::time_point::now();
+        for (const auto& sent_message : batch)
+        {
+          sent_message->transmission_finish_time = transmission_finish_time;
+          _total_queued_messages_size -= sent_message->get_size_in_queue();
+        }
       }
       //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
@@ -16,11 +16,45 @@
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/config.hpp>
 
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace graphene { namespace net {
   namespace detail
   {
     using namespace boost::multi_index;
 
+    namespace
+    {
+      /// The peer database file starts with these bytes, followed by the version of its format
+      const char peer_database_magic[4] = { 'G', 'P', 'D', 'B' };
+      constexpr uint32_t peer_database_version = 1;
+
+      /// Operation of a record of the peer database log
+      enum class peer_log_operation : uint8_t
+      {
+        upsert = 1,
+        erase = 2
+      };
+
+      /// Frames @p data as a log record: size of the rest of the record, operation, data
+      std::vector<char> make_log_record(peer_log_operation operation, const std::vector<char>& data)
+      {
+        std::vector<char> record(sizeof(uint32_t) + 1 + data.size());
+        fc::datastream<char*> ds(record.data(), record.size());
+        fc::raw::pack(ds, uint32_t(1 + data.size()));
+        fc::raw::pack(ds, uint8_t(operation));
+        ds.write(data.data(), data.size());
+        return record;
+      }
+    }
+
     class peer_database_impl
     {
     public:
@@ -41,8 +75,27 @@ namespace graphene { namespace net {
     private:
       potential_peer_set     _potential_peer_set;
       fc::path _peer_database_filename;
+      /// The peer database file, open for appending records, or null if the database is not open
+      FILE*    _log_file = nullptr;
+      /// Number of records in the peer database file
+      uint64_t _log_records = 0;
+      size_t   _maximum_size = MAXIMUM_PEERDB_SIZE;
+
+      /// Reads the peer database file, returns false if it should be rewritten
+      bool load();
+      void apply_update(const potential_peer_record& updatedRecord);
+      bool apply_erase(const fc::ip::endpoint& endpointToErase);
+      void append_to_log(peer_log_operation operation, const std::vector<char>& data);
+      /// Whether the peer database file holds so many outdated records that it should be rewritten
+      bool log_needs_compaction() const;
+      /// Rewrites the peer database file with one record per peer
+      void compact();
+      /// Removes the least recently seen peers beyond the maximum size
+      void prune();
 
     public:
+      ~peer_database_impl();
+
       void open(const fc::path& databaseFilename);
       void close();
       void clear();
@@ -50,6 +103,8 @@ namespace graphene { namespace net {
       void update_entry(const potential_peer_record& updatedRecord);
       potential_peer_record lookup_or_create_entry_for_ep(const fc::ip::endpoint& endpointToLookup)const;
       fc::optional<potential_peer_record> lookup_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup)const;
+      void set_maximum_size(size_t maximum_size);
+      size_t get_maximum_size() const;
 
       peer_database::iterator begin() const;
       peer_database::iterator end() const;
@@ -68,66 +123,146 @@ namespace graphene { namespace net {
     peer_database_iterator::peer_database_iterator( const peer_database_iterator& c ) :
       boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>(c){}
 
+    peer_database_impl::~peer_database_impl()
+    {
+      if (_log_file)
+        fclose(_log_file);
+    }
+
     void peer_database_impl::open(const fc::path& peer_database_filename)
     {
+      if (_log_file)
+      {
+        fclose(_log_file);
+        _log_file = nullptr;
+      }
+      _potential_peer_set.clear();
+      _log_records = 0;
       _peer_database_filename = peer_database_filename;
+
+      bool needs_compaction = true;
       if (fc::exists(_peer_database_filename))
       {
         try
         {
-          std::vector<potential_peer_record> peer_records = fc::json::from_file(_peer_database_filename).as<std::vector<potential_peer_record> >( GRAPHENE_NET_MAX_NESTED_OBJECTS );
-          std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
-          if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
+          needs_compaction = !load();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error opening peer database file ${peer_database_filename}, starting with a clean database: ${error}",
+               ("peer_database_filename", _peer_database_filename)("error", e.to_detail_string()));
+          _potential_peer_set.clear();
+        }
+      }
+
+      // also rewrite a file which has grown since it was last compacted, e.g. because the node was not shut down
+      // cleanly, so that it is not read in full at the next start again
+      if (needs_compaction || log_needs_compaction())
+        compact();
+      else
+      {
+        _log_file = fopen(_peer_database_filename.generic_string().c_str(), "ab");
+        if (!_log_file)
+          wlog("unable to open peer database file ${peer_database_filename} for writing, changes will not be saved",
+               ("peer_database_filename", _peer_database_filename));
+      }
+    }
+
+    bool peer_database_impl::load()
+    {
+      std::string contents;
+      fc::read_file_contents(_peer_database_filename, contents);
+
+      if (contents.size() < sizeof(peer_database_magic)
+          || memcmp(contents.data(), peer_database_magic, sizeof(peer_database_magic)) != 0)
+      {
+        // written by an older version, which saved the whole database as JSON on close
+        std::vector<potential_peer_record> peer_records = fc::json::from_string(contents).as<std::vector<potential_peer_record> >( GRAPHENE_NET_MAX_NESTED_OBJECTS );
+        std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
+        ilog("converting peer database file ${peer_database_filename} with ${count} peers from JSON",
+             ("peer_database_filename", _peer_database_filename)("count", _potential_peer_set.size()));
+        return false;
+      }
+
+      fc::datastream<const char*> ds(contents.data() + sizeof(peer_database_magic),
+                                     contents.size() - sizeof(peer_database_magic));
+      uint32_t version = 0;
+      fc::raw::unpack(ds, version);
+      FC_ASSERT(version == peer_database_version, "unsupported peer database version ${version}", ("version", version));
+
+      while (ds.remaining() > 0)
+      {
+        try
+        {
+          uint32_t record_size = 0;
+          fc::raw::unpack(ds, record_size);
+          FC_ASSERT(record_size > 0 && record_size <= ds.remaining());
+          fc::datastream<const char*> record(contents.data() + contents.size() - ds.remaining(), record_size);
+          ds.skip(record_size);
+
+          uint8_t operation = 0;
+          fc::raw::unpack(record, operation);
+          if (operation == uint8_t(peer_log_operation::upsert))
           {
-            // prune database to a reasonable size
-            auto iter = _potential_peer_set.begin();
-            std::advance(iter, MAXIMUM_PEERDB_SIZE);
-            _potential_peer_set.erase(iter, _potential_peer_set.end());
+            potential_peer_record updated_record;
+            fc::raw::unpack(record, updated_record, GRAPHENE_NET_MAX_NESTED_OBJECTS);
+            apply_update(updated_record);
           }
+          else if (operation == uint8_t(peer_log_operation::erase))
+          {
+            fc::ip::endpoint endpoint_to_erase;
+            fc::raw::unpack(record, endpoint_to_erase);
+            apply_erase(endpoint_to_erase);
+          }
+          else
+            FC_THROW("unknown peer database operation ${operation}", ("operation", operation));
+          ++_log_records;
         }
         catch (const fc::exception& e)
         {
-          elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
-               ("peer_database_filename", _peer_database_filename));
+          // a record which was being written when the node stopped, the ones before it are intact
+          wlog("ignoring the end of peer database file ${peer_database_filename} after ${count} valid records: ${error}",
+               ("peer_database_filename", _peer_database_filename)("count", _log_records)("error", e.to_string()));
+          return false;
         }
       }
+      return true;
     }
 
     void peer_database_impl::close()
     {
-      std::vector<potential_peer_record> peer_records;
-      peer_records.reserve(_potential_peer_set.size());
-      std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
-
-      try
+      if (_log_file)
       {
-        fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
-        if (!fc::exists(peer_database_filename_dir))
-          fc::create_directories(peer_database_filename_dir);
-        fc::json::save_to_file( peer_records, _peer_database_filename, GRAPHENE_NET_MAX_NESTED_OBJECTS );
+        prune();
+        compact();
+        fclose(_log_file);
+        _log_file = nullptr;
         dlog( "Saved peer database to file ${filename}", ( "filename", _peer_database_filename) );
       }
-      catch (const fc::exception& e)
-      {
-        wlog( "error saving peer database to file ${peer_database_filename}: ${error}",
-              ("peer_database_filename", _peer_database_filename)("error", e.to_detail_string()) );
-      }
       _potential_peer_set.clear();
+      _log_records = 0;
     }
 
     void peer_database_impl::clear()
     {
       _potential_peer_set.clear();
+      if (_log_file)
+        compact();
     }
 
     void peer_database_impl::erase(const fc::ip::endpoint& endpointToErase)
     {
-      auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
-      if (iter != _potential_peer_set.get<endpoint_index>().end())
-        _potential_peer_set.get<endpoint_index>().erase(iter);
+      if (apply_erase(endpointToErase))
+        append_to_log(peer_log_operation::erase, fc::raw::pack(endpointToErase));
     }
 
     void peer_database_impl::update_entry(const potential_peer_record& updatedRecord)
+    {
+      apply_update(updatedRecord);
+      append_to_log(peer_log_operation::upsert, fc::raw::pack(updatedRecord));
+    }
+
+    void peer_database_impl::apply_update(const potential_peer_record& updatedRecord)
     {
       auto iter = _potential_peer_set.get<endpoint_index>().find(updatedRecord.endpoint);
       if (iter != _potential_peer_set.get<endpoint_index>().end())
@@ -136,6 +271,114 @@ namespace graphene { namespace net {
         _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
     }
 
+    bool peer_database_impl::apply_erase(const fc::ip::endpoint& endpointToErase)
+    {
+      auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
+      if (iter == _potential_peer_set.get<endpoint_index>().end())
+        return false;
+      _potential_peer_set.get<endpoint_index>().erase(iter);
+      return true;
+    }
+
+    void peer_database_impl::append_to_log(peer_log_operation operation, const std::vector<char>& data)
+    {
+      if (!_log_file)
+        return;
+
+      const std::vector<char> record = make_log_record(operation, data);
+      if (fwrite(record.data(), 1, record.size(), _log_file) != record.size() || fflush(_log_file) != 0)
+      {
+        wlog("error writing to peer database file ${peer_database_filename}, rewriting it",
+             ("peer_database_filename", _peer_database_filename));
+        compact();
+        return;
+      }
+
+      ++_log_records;
+      if (log_needs_compaction())
+        compact();
+    }
+
+    bool peer_database_impl::log_needs_compaction() const
+    {
+      return _log_records >= 2 * _potential_peer_set.size() + GRAPHENE_NET_PEERDB_MIN_RECORDS_TO_COMPACT;
+    }
+
+    void peer_database_impl::compact()
+    {
+      if (_log_file)
+      {
+        fclose(_log_file);
+        _log_file = nullptr;
+      }
+
+      fc::path temp_filename(_peer_database_filename.generic_string() + ".tmp");
+      FILE* temp_file = nullptr;
+      try
+      {
+        fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
+        if (!fc::exists(peer_database_filename_dir))
+          fc::create_directories(peer_database_filename_dir);
+
+        temp_file = fopen(temp_filename.generic_string().c_str(), "wb");
+        FC_ASSERT(temp_file, "unable to create ${filename}", ("filename", temp_filename));
+
+        std::vector<char> contents(peer_database_magic, peer_database_magic + sizeof(peer_database_magic));
+        const std::vector<char> version = fc::raw::pack(peer_database_version);
+        contents.insert(contents.end(), version.begin(), version.end());
+        for (const potential_peer_record& record : _potential_peer_set.get<last_seen_time_index>())
+        {
+          const std::vector<char> log_record = make_log_record(peer_log_operation::upsert, fc::raw::pack(record));
+          contents.insert(contents.end(), log_record.begin(), log_record.end());
+        }
+
+        FC_ASSERT(fwrite(contents.data(), 1, contents.size(), temp_file) == contents.size()
+                  && fflush(temp_file) == 0, "unable to write ${filename}", ("filename", temp_filename));
+#ifdef _WIN32
+        _commit(_fileno(temp_file));
+#else
+        fsync(fileno(temp_file));
+#endif
+        fclose(temp_file);
+        temp_file = nullptr;
+
+        fc::rename(temp_filename, _peer_database_filename);
+        _log_records = _potential_peer_set.size();
+      }
+      catch (const fc::exception& e)
+      {
+        if (temp_file)
+          fclose(temp_file);
+        wlog( "error saving peer database to file ${peer_database_filename}: ${error}",
+              ("peer_database_filename", _peer_database_filename)("error", e.to_detail_string()) );
+      }
+
+      _log_file = fopen(_peer_database_filename.generic_string().c_str(), "ab");
+      if (!_log_file)
+        wlog("unable to open peer database file ${peer_database_filename} for writing, changes will not be saved",
+             ("peer_database_filename", _peer_database_filename));
+    }
+
+    void peer_database_impl::prune()
+    {
+      if (_potential_peer_set.size() > _maximum_size)
+      {
+        auto iter = _potential_peer_set.get<last_seen_time_index>().begin();
+        std::advance(iter, _maximum_size);
+        _potential_peer_set.get<last_seen_time_index>().erase(iter, _potential_peer_set.get<last_seen_time_index>().end());
+      }
+    }
+
+    void peer_database_impl::set_maximum_size(size_t maximum_size)
+    {
+      _maximum_size = maximum_size;
+    }
+
+    size_t peer_database_impl::get_maximum_size() const
+    {
+      return _maximum_size;
+    }
+
     potential_peer_record peer_database_impl::lookup_or_create_entry_for_ep(
           const fc::ip::endpoint& endpointToLookup ) const
     {
@@ -261,6 +504,16 @@ namespace graphene { namespace net {
     return my->size();
   }
 
+  void peer_database::set_maximum_size(size_t maximum_size)
+  {
+    my->set_maximum_size(maximum_size);
+  }
+
+  size_t peer_database::get_maximum_size() const
+  {
+    return my->get_maximum_size();
+  }
+
 } } // end namespace graphene::net
 
 FC_REFLECT_ENUM( graphene::net::potential_peer_last_connection_disposition,
@@ -10,10 +10,25 @@
 #include <fc/network/ip.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <graphene/net/config.hpp>
+#include <graphene/net/message_decoder.hpp>
 #include <graphene/net/stcp_socket.hpp>
 
 namespace graphene { namespace net {
 
+namespace {
+  /// Makes sure @p buffer holds at least @p required bytes, keeping it if it is large enough
+  void reserve_buffer( std::shared_ptr<char>& buffer, size_t& capacity, size_t required )
+  {
+    if( buffer && capacity >= required )
+      return;
+    buffer.reset( new char[required], [](char* p){ delete[] p; } );
+    capacity = required;
+  }
+}
+
+constexpr size_t stcp_socket::max_chunk_size;
+
 stcp_socket::stcp_socket()
 //:_buf_len(0)
 #ifndef NDEBUG
@@ -78,11 +93,8 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     } buffer_in_use_checker(_read_buffer_in_use);
 #endif
 
-    const size_t read_buffer_length = 4096;
-    if (!_read_buffer)
-      _read_buffer.reset(new char[read_buffer_length], [](char* p){ delete[] p; });
-
-    len = std::min<size_t>(read_buffer_length, len);
+    len = std::min<size_t>(max_chunk_size, len);
+    reserve_buffer( _read_buffer, _read_buffer_size, len );
 
     size_t s = _sock.readsome( _read_buffer, len, 0 );
     if( s % 16 ) 
@@ -90,7 +102,12 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
       _sock.read(_read_buffer, 16 - (s%16), s);
       s += 16-(s%16);
     }
-    _recv_aes.decode( _read_buffer.get(), s, buffer );
+    // everything that has arrived is decrypted in one pass, large amounts on the worker threads
+    if( s >= GRAPHENE_NET_MIN_BYTES_TO_DECRYPT_IN_PARALLEL )
+      detail::run_on_worker_threads( detail::inbound_stage::decrypt,
+                                     [this,s,buffer]() { _recv_aes.decode( _read_buffer.get(), s, buffer ); } );
+    else
+      _recv_aes.decode( _read_buffer.get(), s, buffer );
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
@@ -119,11 +136,8 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
     } buffer_in_use_checker(_write_buffer_in_use);
 #endif
 
-    const std::size_t write_buffer_length = 4096;
-    if (!_write_buffer)
-      _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
-    len = std::min<size_t>(write_buffer_length, len);
-    memset(_write_buffer.get(), 0, len); // just in case aes.encode screws up
+    len = std::min<size_t>(max_chunk_size, len);
+    reserve_buffer( _write_buffer, _write_buffer_size, len );
     /**
      * every sizeof(crypt_buf) bytes the aes channel
      * has an error and doesn't decrypt properly...  disable
@@ -4,6 +4,7 @@
 
 
 #include <graphene/account_history/account_history_plugin.hpp>
+#include <graphene/account_history/account_history_store.hpp>
 
 #include <graphene/chain/impacted.hpp>
 
@@ -20,6 +21,9 @@
 
 #include <fc/thread/thread.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace graphene { namespace account_history {
 
 namespace detail
@@ -38,6 +42,15 @@ class account_history_plugin_impl
        * and will process/index all operations that were applied in the block.
        */
       void update_account_histories( const signed_block& b );
+      /// Like @ref update_account_histories, but adds the histories to @ref _store instead of the object database
+      void store_account_histories( const signed_block& b );
+
+      /// Returns the accounts whose history should include @p op
+      flat_set<account_id_type> get_impacted_accounts( const operation_history_object& op,
+                                                       const signed_block& b );
+
+      /// Opens @ref _store if needed, and removes operations of blocks from @p block_num on
+      void prepare_store( uint32_t block_num );
 
       graphene::chain::database& database()
       {
@@ -59,6 +72,14 @@ class account_history_plugin_impl
 
       uint32_t _latest_block_number_to_remove = 0;
 
+      /// Whether to keep histories in @ref _store instead of the object database
+      bool _history_on_disk = false;
+      account_history_store _store;
+
+      /// Whether to keep @ref _by_operation_index
+      bool _index_by_operation = false;
+      account_history_by_operation_index* _by_operation_index = nullptr;
+
       uint64_t get_max_ops_to_keep( const account_id_type& account_id );
 
       /** add one history record, then check and remove the earliest history record(s) */
@@ -84,6 +105,12 @@ static T get_biggest_number_to_remove( T biggest_number, T amount_to_keep )
 
 void account_history_plugin_impl::update_account_histories( const signed_block& b )
 {
+   if( _history_on_disk )
+   {
+      store_account_histories( b );
+      return;
+   }
+
    _latest_block_number_to_remove = get_biggest_number_to_remove( b.block_num(), _min_blocks_to_keep );
 
    graphene::chain::database& db = database();
@@ -135,35 +162,7 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
       const operation_history_object& op = *o_op;
 
       // get the set of accounts this operation applies to
-      flat_set<account_id_type> impacted;
-      vector<authority> other;
-      // fee payer is added here
-      operation_get_required_authorities( op.op, impacted, impacted, other,
-                                          MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( db.head_block_time() ) );
-
-      if( op.op.is_type< account_create_operation >() )
-         impacted.insert( account_id_type( op.result.get<object_id_type>() ) );
-
-      // https://github.com/Acloudbank/Acloudbank-core/issues/265
-      if( HARDFORK_CORE_265_PASSED(b.timestamp) || !op.op.is_type< account_create_operation >() )
-      {
-         operation_get_impacted_accounts( op.op, impacted,
-                                          MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( db.head_block_time() ) );
-      }
-
-      if( op.result.is_type<extendable_operation_result>() )
-      {
-         const auto& op_result = op.result.get<extendable_operation_result>();
-         if( op_result.value.impacted_accounts.valid() )
-         {
-            for( const auto& a : *op_result.value.impacted_accounts )
-               impacted.insert( a );
-         }
-      }
-
-      for( auto& a : other )
-         for( auto& item : a.account_auths )
-            impacted.insert( item.first );
+      flat_set<account_id_type> impacted = get_impacted_accounts( op, b );
 
       // be here, either _max_ops_per_account > 0, or _partial_operations == false, or both
       // if _partial_operations == false, oho should have been created above
@@ -221,6 +220,109 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
    remove_old_histories();
 }
 
+flat_set<account_id_type> account_history_plugin_impl::get_impacted_accounts( const operation_history_object& op,
+                                                                              const signed_block& b )
+{
+   const graphene::chain::database& db = database();
+   flat_set<account_id_type> impacted;
+   vector<authority> other;
+   // fee payer is added here
+   operation_get_required_authorities( op.op, impacted, impacted, other,
+                                       MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( db.head_block_time() ) );
+
+   if( op.op.is_type< account_create_operation >() )
+      impacted.insert( account_id_type( op.result.get<object_id_type>() ) );
+
+   // https://github.com/Acloudbank/Acloudbank-core/issues/265
+   if( HARDFORK_CORE_265_PASSED(b.timestamp) || !op.op.is_type< account_create_operation >() )
+   {
+      operation_get_impacted_accounts( op.op, impacted,
+                                       MUST_IGNORE_CUSTOM_OP_REQD_AUTHS( db.head_block_time() ) );
+   }
+
+   if( op.result.is_type<extendable_operation_result>() )
+   {
+      const auto& op_result = op.result.get<extendable_operation_result>();
+      if( op_result.value.impacted_accounts.valid() )
+      {
+         for( const auto& a : *op_result.value.impacted_accounts )
+            impacted.insert( a );
+      }
+   }
+
+   for( auto& a : other )
+      for( auto& item : a.account_auths )
+         impacted.insert( item.first );
+
+   return impacted;
+}
+
+void account_history_plugin_impl::prepare_store( uint32_t block_num )
+{
+   if( !_store.is_open() )
+   {
+      // the object database is open here, the store is kept next to it
+      _store.open( database().get_data_dir() / "account_history" );
+      if( _store.next_operation_id() > _oho_index->get_next_id() )
+         ilog( "Account history store is ahead of the object database, removing operations from block ${n} on",
+               ("n",block_num) );
+      else if( _store.next_operation_id() < _oho_index->get_next_id() )
+         wlog( "Account history store is behind the object database, history of operations from ${o} to ${n} "
+               "is missing, replay the blockchain to restore it",
+               ("o",_store.next_operation_id())("n",_oho_index->get_next_id()) );
+   }
+   // blocks are applied again after a fork switch
+   if( _store.last_block_num() >= block_num )
+      _store.remove_from_block( block_num );
+}
+
+void account_history_plugin_impl::store_account_histories( const signed_block& b )
+{
+   prepare_store( b.block_num() );
+
+   graphene::chain::database& db = database();
+   const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
+   bool is_first = true;
+   // Operation IDs are allocated like in update_account_histories, so that they are the same in both modes,
+   // and so that they are rolled back on undo
+   auto use_oho_id = [&is_first,&db,this]() {
+      if( is_first && db._undo_db.enabled() )
+      {
+         db.remove( db.create<operation_history_object>( []( operation_history_object& obj) {} ) );
+         is_first = false;
+      }
+      else
+         _oho_index->use_next_id();
+   };
+
+   for( const optional< operation_history_object >& o_op : hist )
+   {
+      const object_id_type op_id = _oho_index->get_next_id();
+      use_oho_id();
+      if( !o_op.valid() )
+         continue;
+
+      flat_set<account_id_type> impacted = get_impacted_accounts( *o_op, b );
+      if( !_tracked_accounts.empty() )
+      {
+         flat_set<account_id_type> tracked_impacted;
+         std::set_intersection( impacted.begin(), impacted.end(), _tracked_accounts.begin(), _tracked_accounts.end(),
+                                std::inserter( tracked_impacted, tracked_impacted.end() ) );
+         impacted = std::move( tracked_impacted );
+      }
+      if( impacted.empty() )
+         continue;
+
+      operation_history_object oho = *o_op;
+      oho.id = op_id;
+      _store.append_operation( oho );
+      for( const auto& account_id : impacted )
+         _store.append_account_operation( account_id, oho.get_id() );
+   }
+
+   _store.flush();
+}
+
 void account_history_plugin_impl::add_account_history( const account_id_type& account_id,
                                                        const operation_history_object& op )
 {
@@ -232,6 +334,7 @@ void account_history_plugin_impl::add_account_history( const account_id_type& ac
        obj.account = account_id;
        obj.sequence = stats_obj.total_ops + 1;
        obj.next = stats_obj.most_recent_op;
+       obj.operation_type = op.op.which();
    });
    db.modify( stats_obj, [&aho]( account_statistics_object& obj ){
        obj.most_recent_op = aho.id;
@@ -382,6 +485,39 @@ void account_history_plugin_impl::remove_old_histories_by_account( const account
 
 } // end namespace detail
 
+// The operation type is taken from the entry rather than from its operation, because the operation may not exist
+// while entries are inserted or removed, e.g. when a block is undone
+void account_history_by_operation_index::object_inserted( const object& obj )
+{
+   const auto& entry = static_cast<const account_history_object&>( obj );
+   _entries[ std::make_tuple( entry.account, entry.operation_type, entry.sequence ) ] = entry.get_id();
+}
+
+void account_history_by_operation_index::object_removed( const object& obj )
+{
+   const auto& entry = static_cast<const account_history_object&>( obj );
+   _entries.erase( std::make_tuple( entry.account, entry.operation_type, entry.sequence ) );
+}
+
+vector<account_history_id_type> account_history_by_operation_index::get_entries( account_id_type account,
+                                                                                 int64_t operation_type,
+                                                                                 uint64_t min_sequence,
+                                                                                 uint64_t max_sequence,
+                                                                                 uint32_t limit )const
+{
+   vector<account_history_id_type> result;
+   if( min_sequence > max_sequence )
+      return result;
+   auto itr = _entries.upper_bound( std::make_tuple( account, operation_type, max_sequence ) );
+   auto begin = _entries.lower_bound( std::make_tuple( account, operation_type, min_sequence ) );
+   while( itr != begin && result.size() < limit )
+   {
+      --itr;
+      result.push_back( itr->second );
+   }
+   return result;
+}
+
 
 account_history_plugin::account_history_plugin(graphene::app::application& app) :
    plugin(app),
@@ -430,6 +566,13 @@ void account_history_plugin::plugin_set_program_options(
           "when the min-blocks-to-keep option causes the amount to exceed the limit defined by the "
           "max-ops-per-account option. If this is less than max-ops-per-account, max-ops-per-account will be used. "
           "(default: 1000)")
+         ("history-on-disk", boost::program_options::value<bool>(),
+          "Keep operation and account histories in files in the blockchain directory instead of in memory, "
+          "and keep all of them. The partial-operations option and the limits on the number of operations "
+          "per account are ignored in this mode. Changing this option requires a replay. (default: false)")
+         ("index-history-by-operation", boost::program_options::value<bool>(),
+          "Keep an index of the account histories by operation type in memory, to speed up queries of the "
+          "history of an account filtered by operation type. Ignored if history-on-disk is set. (default: false)")
          ;
    cfg.add(cli);
 }
@@ -450,6 +593,8 @@ void detail::account_history_plugin_impl::init_program_options(const boost::prog
 {
    LOAD_VALUE_SET(options, "track-account", _tracked_accounts, graphene::chain::account_id_type);
 
+   utilities::get_program_option( options, "history-on-disk", _history_on_disk );
+   utilities::get_program_option( options, "index-history-by-operation", _index_by_operation );
    utilities::get_program_option( options, "partial-operations", _partial_operations );
    utilities::get_program_option( options, "max-ops-per-account", _max_ops_per_account );
    utilities::get_program_option( options, "extended-max-ops-per-account", _extended_max_ops_per_account );
@@ -469,6 +614,21 @@ void detail::account_history_plugin_impl::init_program_options(const boost::prog
 
 void account_history_plugin::plugin_startup()
 {
+   if( my->_history_on_disk )
+      my->prepare_store( database().head_block_num() + 1 );
+   else if( my->_index_by_operation )
+   {
+      auto& by_operation = *database().add_secondary_index< primary_index< account_history_index >,
+                                                            account_history_by_operation_index >();
+      for( const auto& entry : database().get_index_type< account_history_index >().indices() )
+         by_operation.object_inserted( entry );
+      my->_by_operation_index = &by_operation;
+   }
+}
+
+void account_history_plugin::plugin_shutdown()
+{
+   my->_store.close();
 }
 
 flat_set<account_id_type> account_history_plugin::tracked_accounts() const
@@ -476,4 +636,14 @@ flat_set<account_id_type> account_history_plugin::tracked_accounts() const
    return my->_tracked_accounts;
 }
 
+const account_history_store* account_history_plugin::history_store()const
+{
+   return my->_history_on_disk ? &my->_store : nullptr;
+}
+
+const account_history_by_operation_index* account_history_plugin::history_by_operation_index()const
+{
+   return my->_by_operation_index;
+}
+
 } }
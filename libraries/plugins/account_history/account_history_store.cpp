@@ -0,0 +1,537 @@
+/*
+ * Acloudbank
+ */
+#include <graphene/account_history/account_history_store.hpp>
+
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace graphene { namespace account_history {
+
+namespace detail {
+
+   /// A read-only mapping of the flushed part of one of the files of the store
+   struct mapped_file
+   {
+      mapped_file( const fc::path& filename, uint64_t file_size ) : size( file_size )
+      {
+         if( size == 0 )
+            return;
+         mapping.reset( new fc::file_mapping( filename.generic_string().c_str(), fc::read_only ) );
+         region.reset( new fc::mapped_region( *mapping, fc::read_only, 0, size ) );
+         data = (const char*)region->get_address();
+      }
+
+      std::unique_ptr<fc::file_mapping>  mapping;
+      std::unique_ptr<fc::mapped_region> region;
+      const char*                        data = nullptr;
+      uint64_t                           size = 0;
+   };
+
+}
+
+namespace {
+
+   constexpr uint64_t npos = std::numeric_limits<uint64_t>::max();
+
+   void seek_file( FILE* f, uint64_t pos )
+   {
+#ifdef _WIN32
+      int r = _fseeki64( f, int64_t(pos), SEEK_SET );
+#else
+      int r = fseeko( f, off_t(pos), SEEK_SET );
+#endif
+      FC_ASSERT( r == 0, "Unable to seek to position ${pos} in account history store", ("pos",pos) );
+   }
+
+   void write_file( FILE* f, uint64_t pos, const char* data, size_t size )
+   {
+      if( size == 0 )
+         return;
+      seek_file( f, pos );
+      FC_ASSERT( fwrite( data, 1, size, f ) == size, "Unable to write to account history store" );
+   }
+
+   void sync_file( FILE* f )
+   {
+      FC_ASSERT( fflush( f ) == 0, "Unable to flush account history store" );
+#ifdef _WIN32
+      _commit( _fileno( f ) );
+#else
+      fsync( fileno( f ) );
+#endif
+   }
+
+   uint64_t invert_lowest_one( uint64_t n ) { return n & (n - 1); }
+
+   /// Sequence number of the entry which the entry with sequence number @p seq skips to, 0 for none.
+   /// The choice of skip targets makes it possible to reach any older entry in a logarithmic number of steps.
+   uint64_t get_skip_sequence( uint64_t seq )
+   {
+      if( seq < 2 )
+         return 0;
+      return ( seq & 1 ) ? invert_lowest_one( invert_lowest_one( seq - 1 ) ) + 1 : invert_lowest_one( seq );
+   }
+
+}
+
+account_history_store::account_history_store() = default;
+
+account_history_store::~account_history_store()
+{
+   try
+   {
+      close();
+   }
+   FC_CAPTURE_AND_LOG( (_dir) )
+}
+
+void account_history_store::open( const fc::path& dir )
+{ try {
+   FC_ASSERT( !is_open(), "Account history store is already open" );
+   fc::create_directories( dir );
+   _dir = dir;
+
+   const fc::path operations_filename = _dir / "operations";
+   const fc::path operation_index_filename = _dir / "operation_index";
+   const fc::path account_index_filename = _dir / "account_index";
+   // start over unless all files exist
+   const char* mode = ( fc::exists( operations_filename ) && fc::exists( operation_index_filename )
+                        && fc::exists( account_index_filename ) ) ? "r+b" : "w+b";
+   _operations_file = fopen( operations_filename.generic_string().c_str(), mode );
+   _operation_index_file = fopen( operation_index_filename.generic_string().c_str(), mode );
+   _account_index_file = fopen( account_index_filename.generic_string().c_str(), mode );
+   if( _operations_file == nullptr || _operation_index_file == nullptr || _account_index_file == nullptr )
+   {
+      for( FILE* f : { _operations_file, _operation_index_file, _account_index_file } )
+         if( f != nullptr )
+            fclose( f );
+      _operations_file = _operation_index_file = _account_index_file = nullptr;
+      FC_THROW( "Unable to open account history store in ${d}", ("d",_dir) );
+   }
+
+   _operations_size = fc::file_size( operations_filename );
+   _operation_count = fc::file_size( operation_index_filename ) / sizeof(detail::operation_entry);
+   _account_entry_count = fc::file_size( account_index_filename ) / sizeof(detail::account_entry);
+
+   // After an unclean shutdown the files may end with entries whose data was not written completely
+   while( _operation_count > 0 )
+   {
+      const auto e = read_operation_entry( _operation_count - 1 );
+      if( e.pos.value() + e.size.value() <= _operations_size )
+         break;
+      --_operation_count;
+   }
+   while( _account_entry_count > 0
+          && read_account_entry( _account_entry_count - 1 ).operation.value() >= _operation_count )
+      --_account_entry_count;
+   unmap_files();
+   if( _operation_count * sizeof(detail::operation_entry) != fc::file_size( operation_index_filename ) )
+      fc::resize_file( operation_index_filename, _operation_count * sizeof(detail::operation_entry) );
+   if( _account_entry_count * sizeof(detail::account_entry) != fc::file_size( account_index_filename ) )
+      fc::resize_file( account_index_filename, _account_entry_count * sizeof(detail::account_entry) );
+
+   load_account_heads();
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool account_history_store::is_open()const
+{
+   return _operations_file != nullptr;
+}
+
+void account_history_store::close()
+{
+   if( !is_open() )
+      return;
+   flush();
+   unmap_files();
+   for( FILE* f : { _operations_file, _operation_index_file, _account_index_file } )
+   {
+      sync_file( f );
+      fclose( f );
+   }
+   _operations_file = _operation_index_file = _account_index_file = nullptr;
+   save_account_heads();
+   _account_heads.clear();
+}
+
+void account_history_store::flush()
+{
+   if( _pending_operation_entries.empty() && _pending_account_entries.empty() )
+      return;
+
+   write_file( _operations_file, _operations_size, _pending_operations.data(), _pending_operations.size() );
+   write_file( _operation_index_file, _operation_count * sizeof(detail::operation_entry),
+               (const char*)_pending_operation_entries.data(),
+               _pending_operation_entries.size() * sizeof(detail::operation_entry) );
+   write_file( _account_index_file, _account_entry_count * sizeof(detail::account_entry),
+               (const char*)_pending_account_entries.data(),
+               _pending_account_entries.size() * sizeof(detail::account_entry) );
+   // the operations have to be written before the entries pointing to them
+   FC_ASSERT( fflush( _operations_file ) == 0, "Unable to flush account history store" );
+   FC_ASSERT( fflush( _operation_index_file ) == 0, "Unable to flush account history store" );
+   FC_ASSERT( fflush( _account_index_file ) == 0, "Unable to flush account history store" );
+
+   _operations_size += _pending_operations.size();
+   _operation_count += _pending_operation_entries.size();
+   _account_entry_count += _pending_account_entries.size();
+   _pending_operations.clear();
+   _pending_operation_entries.clear();
+   _pending_account_entries.clear();
+}
+
+uint32_t account_history_store::last_block_num()const
+{
+   const uint64_t count = next_operation_id().instance.value;
+   return ( count == 0 ) ? 0 : read_operation_entry( count - 1 ).block_num.value();
+}
+
+operation_history_id_type account_history_store::next_operation_id()const
+{
+   return operation_history_id_type( _operation_count + _pending_operation_entries.size() );
+}
+
+void account_history_store::remove_from_block( uint32_t block_num )
+{ try {
+   FC_ASSERT( is_open() );
+   flush();
+
+   // operations and account entries are ordered by block number
+   uint64_t first_op = 0;
+   uint64_t end_op = _operation_count;
+   while( first_op < end_op )
+   {
+      const uint64_t mid = first_op + ( end_op - first_op ) / 2;
+      if( read_operation_entry( mid ).block_num.value() < block_num )
+         first_op = mid + 1;
+      else
+         end_op = mid;
+   }
+   if( first_op == _operation_count )
+      return;
+   const uint64_t operations_size = read_operation_entry( first_op ).pos.value();
+
+   uint64_t first_entry = 0;
+   uint64_t end_entry = _account_entry_count;
+   while( first_entry < end_entry )
+   {
+      const uint64_t mid = first_entry + ( end_entry - first_entry ) / 2;
+      if( read_account_entry( mid ).operation.value() < first_op )
+         first_entry = mid + 1;
+      else
+         end_entry = mid;
+   }
+   for( uint64_t entry_num = _account_entry_count; entry_num > first_entry; --entry_num )
+   {
+      const auto e = read_account_entry( entry_num - 1 );
+      auto& head = _account_heads[e.account.value()];
+      head.last_entry = e.prev.value();
+      head.total_ops = e.sequence.value() - 1;
+   }
+
+   unmap_files();
+   fc::resize_file( _dir / "operations", operations_size );
+   fc::resize_file( _dir / "operation_index", first_op * sizeof(detail::operation_entry) );
+   fc::resize_file( _dir / "account_index", first_entry * sizeof(detail::account_entry) );
+   _operations_size = operations_size;
+   _operation_count = first_op;
+   _account_entry_count = first_entry;
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void account_history_store::append_operation( const operation_history_object& op )
+{
+   FC_ASSERT( is_open() );
+   const uint64_t op_num = op.id.instance();
+   uint64_t next_op = next_operation_id().instance.value;
+   FC_ASSERT( op_num >= next_op, "Operation ${id} is already stored", ("id",op.id) );
+
+   detail::operation_entry e;
+   e.pos = _operations_size + _pending_operations.size();
+   e.size = 0;
+   e.block_num = op.block_num;
+   for( ; next_op < op_num; ++next_op )
+      _pending_operation_entries.push_back( e );
+
+   const auto data = fc::raw::pack( op );
+   e.size = data.size();
+   _pending_operations.insert( _pending_operations.end(), data.begin(), data.end() );
+   _pending_operation_entries.push_back( e );
+}
+
+void account_history_store::append_account_operation( account_id_type account,
+                                                      operation_history_id_type op_id )
+{
+   FC_ASSERT( is_open() );
+   FC_ASSERT( op_id < next_operation_id(), "Operation ${id} is not stored", ("id",op_id) );
+   const uint64_t account_num = account.instance.value;
+   if( _account_heads.size() <= account_num )
+      _account_heads.resize( account_num + 1 );
+   auto& head = _account_heads[account_num];
+
+   detail::account_entry e;
+   e.account = account_num;
+   e.operation = op_id.instance.value;
+   e.sequence = head.total_ops + 1;
+   e.prev = head.last_entry;
+   const uint64_t skip_seq = get_skip_sequence( e.sequence.value() );
+   e.skip = ( skip_seq > 0 ) ? find_by_sequence( head.last_entry, skip_seq ) : npos;
+   _pending_account_entries.push_back( e );
+
+   head.last_entry = _account_entry_count + _pending_account_entries.size() - 1;
+   head.total_ops = e.sequence.value();
+}
+
+optional<operation_history_object> account_history_store::get_operation( operation_history_id_type op_id )const
+{
+   if( op_id >= next_operation_id() )
+      return {};
+   const auto e = read_operation_entry( op_id.instance.value );
+   if( e.size.value() == 0 )
+      return {};
+   return read_operation( e );
+}
+
+uint64_t account_history_store::get_account_total_ops( account_id_type account )const
+{
+   const uint64_t account_num = account.instance.value;
+   return ( account_num < _account_heads.size() ) ? _account_heads[account_num].total_ops : 0;
+}
+
+vector<operation_history_object> account_history_store::get_account_history( account_id_type account,
+                                                                             operation_history_id_type stop,
+                                                                             uint32_t limit,
+                                                                             operation_history_id_type start )const
+{
+   vector<operation_history_object> result;
+   const uint64_t account_num = account.instance.value;
+   if( account_num >= _account_heads.size() || start < stop )
+      return result;
+
+   // like in the object database, an operation with ID 0 is included when stop is 0
+   uint64_t entry_num = find_by_operation( _account_heads[account_num].last_entry, start.instance.value );
+   while( entry_num != npos && result.size() < limit )
+   {
+      const auto e = read_account_entry( entry_num );
+      if( e.operation.value() <= stop.instance.value && ( stop.instance.value > 0 || e.operation.value() > 0 ) )
+         break;
+      result.emplace_back( read_operation( read_operation_entry( e.operation.value() ) ) );
+      entry_num = e.prev.value();
+   }
+   return result;
+}
+
+vector<operation_history_object> account_history_store::get_account_history_operations(
+      account_id_type account,
+      int64_t operation_type,
+      operation_history_id_type start,
+      operation_history_id_type stop,
+      uint32_t limit )const
+{
+   vector<operation_history_object> result;
+   const uint64_t account_num = account.instance.value;
+   if( account_num >= _account_heads.size() )
+      return result;
+
+   uint64_t entry_num = _account_heads[account_num].last_entry;
+   if( start != operation_history_id_type() )
+      entry_num = find_by_operation( entry_num, start.instance.value );
+   while( entry_num != npos && result.size() < limit )
+   {
+      const auto e = read_account_entry( entry_num );
+      if( e.operation.value() <= stop.instance.value && ( stop.instance.value > 0 || e.operation.value() > 0 ) )
+         break;
+      auto op = read_operation( read_operation_entry( e.operation.value() ) );
+      if( op.op.which() == operation_type )
+         result.emplace_back( std::move( op ) );
+      entry_num = e.prev.value();
+   }
+   return result;
+}
+
+vector<operation_history_object> account_history_store::get_relative_account_history( account_id_type account,
+                                                                                      uint64_t stop,
+                                                                                      uint32_t limit,
+                                                                                      uint64_t start )const
+{
+   vector<operation_history_object> result;
+   const uint64_t total_ops = get_account_total_ops( account );
+   start = ( start == 0 ) ? total_ops : std::min( total_ops, start );
+   stop = std::max<uint64_t>( stop, 1 );
+   if( start < stop || limit == 0 )
+      return result;
+
+   uint64_t entry_num = find_by_sequence( _account_heads[account.instance.value].last_entry, start );
+   while( entry_num != npos && result.size() < limit )
+   {
+      const auto e = read_account_entry( entry_num );
+      if( e.sequence.value() < stop )
+         break;
+      result.emplace_back( read_operation( read_operation_entry( e.operation.value() ) ) );
+      entry_num = e.prev.value();
+   }
+   return result;
+}
+
+detail::operation_entry account_history_store::read_operation_entry( uint64_t op_num )const
+{
+   if( op_num >= _operation_count )
+      return _pending_operation_entries.at( op_num - _operation_count );
+   const uint64_t pos = op_num * sizeof(detail::operation_entry);
+   const char* data = mapped( _operation_index_map, _dir / "operation_index",
+                              pos + sizeof(detail::operation_entry),
+                              _operation_count * sizeof(detail::operation_entry) );
+   detail::operation_entry e;
+   memcpy( (char*)&e, data + pos, sizeof(e) );
+   return e;
+}
+
+detail::account_entry account_history_store::read_account_entry( uint64_t entry_num )const
+{
+   if( entry_num >= _account_entry_count )
+      return _pending_account_entries.at( entry_num - _account_entry_count );
+   const uint64_t pos = entry_num * sizeof(detail::account_entry);
+   const char* data = mapped( _account_index_map, _dir / "account_index",
+                              pos + sizeof(detail::account_entry),
+                              _account_entry_count * sizeof(detail::account_entry) );
+   detail::account_entry e;
+   memcpy( (char*)&e, data + pos, sizeof(e) );
+   return e;
+}
+
+operation_history_object account_history_store::read_operation( const detail::operation_entry& e )const
+{
+   const uint64_t pos = e.pos.value();
+   const uint32_t size = e.size.value();
+   FC_ASSERT( size > 0, "Operation is not stored" );
+   const char* data = nullptr;
+   if( pos >= _operations_size )
+   {
+      FC_ASSERT( pos - _operations_size + size <= _pending_operations.size() );
+      data = _pending_operations.data() + ( pos - _operations_size );
+   }
+   else
+      data = mapped( _operations_map, _dir / "operations", pos + size, _operations_size ) + pos;
+
+   operation_history_object op;
+   fc::datastream<const char*> ds( data, size );
+   fc::raw::unpack( ds, op );
+   return op;
+}
+
+uint64_t account_history_store::find_by_sequence( uint64_t entry_num, uint64_t sequence )const
+{
+   while( entry_num != npos )
+   {
+      const auto e = read_account_entry( entry_num );
+      const uint64_t seq = e.sequence.value();
+      FC_ASSERT( seq >= sequence );
+      if( seq == sequence )
+         return entry_num;
+      // take the skip unless it jumps past the target while the skip of the previous entry would not
+      const uint64_t skip_seq = get_skip_sequence( seq );
+      const uint64_t prev_skip_seq = get_skip_sequence( seq - 1 );
+      if( e.skip.value() != npos
+            && ( skip_seq == sequence
+                 || ( skip_seq > sequence && !( prev_skip_seq + 2 < skip_seq && prev_skip_seq >= sequence ) ) ) )
+         entry_num = e.skip.value();
+      else
+         entry_num = e.prev.value();
+   }
+   return npos;
+}
+
+uint64_t account_history_store::find_by_operation( uint64_t entry_num, uint64_t op_num )const
+{
+   while( entry_num != npos )
+   {
+      const auto e = read_account_entry( entry_num );
+      if( e.operation.value() <= op_num )
+         return entry_num;
+      if( e.skip.value() != npos && read_account_entry( e.skip.value() ).operation.value() > op_num )
+         entry_num = e.skip.value();
+      else
+         entry_num = e.prev.value();
+   }
+   return npos;
+}
+
+const char* account_history_store::mapped( std::unique_ptr<detail::mapped_file>& file, const fc::path& filename,
+                                           uint64_t required, uint64_t file_size )const
+{
+   FC_ASSERT( required <= file_size );
+   if( !file || file->size < required )
+   {
+      file.reset();
+      file = std::make_unique<detail::mapped_file>( filename, file_size );
+   }
+   return file->data;
+}
+
+void account_history_store::unmap_files()
+{
+   _operations_map.reset();
+   _operation_index_map.reset();
+   _account_index_map.reset();
+}
+
+void account_history_store::save_account_heads()const
+{
+   std::ofstream out( ( _dir / "account_heads" ).generic_string().c_str(),
+                      std::ios::out | std::ios::binary | std::ios::trunc );
+   const auto data = fc::raw::pack( std::make_pair( _account_entry_count, _account_heads ) );
+   out.write( data.data(), data.size() );
+}
+
+void account_history_store::load_account_heads()
+{
+   // The saved heads are only valid for the files as they were when the store was closed, they are removed
+   // right away so that they are not used after an unclean shutdown
+   const fc::path heads_filename = _dir / "account_heads";
+   uint64_t loaded_entries = 0;
+   _account_heads.clear();
+   if( fc::exists( heads_filename ) )
+   {
+      try
+      {
+         std::string data;
+         fc::read_file_contents( heads_filename, data );
+         std::pair<uint64_t, vector<detail::account_head>> heads;
+         fc::raw::unpack( std::vector<char>( data.begin(), data.end() ), heads );
+         if( heads.first <= _account_entry_count )
+         {
+            loaded_entries = heads.first;
+            _account_heads = std::move( heads.second );
+         }
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "Unable to load account history heads, rebuilding them: ${e}", ("e",e.to_detail_string()) );
+         _account_heads.clear();
+      }
+      fc::remove( heads_filename );
+   }
+
+   if( loaded_entries < _account_entry_count )
+      ilog( "Indexing ${n} account history entries", ("n",_account_entry_count - loaded_entries) );
+   for( uint64_t entry_num = loaded_entries; entry_num < _account_entry_count; ++entry_num )
+   {
+      const auto e = read_account_entry( entry_num );
+      const uint64_t account_num = e.account.value();
+      if( _account_heads.size() <= account_num )
+         _account_heads.resize( account_num + 1 );
+      _account_heads[account_num].last_entry = entry_num;
+      _account_heads[account_num].total_ops = e.sequence.value();
+   }
+}
+
+} } // graphene::account_history
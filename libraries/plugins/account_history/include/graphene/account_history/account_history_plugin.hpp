@@ -2,9 +2,13 @@
 #pragma once
 
 #include <graphene/app/plugin.hpp>
+#include <graphene/chain/operation_history_object.hpp>
 
 #include <boost/multi_index/composite_key.hpp>
 
+#include <map>
+#include <tuple>
+
 namespace graphene { namespace account_history {
    using namespace chain;
 
@@ -57,11 +61,36 @@ using exceeded_account_multi_idx_type = multi_index_container<
 
 using exceeded_account_index = generic_index< exceeded_account_object, exceeded_account_multi_idx_type >;
 
+/**
+ * @brief Keeps the account history entries of all accounts by operation type
+ *
+ * Entries are kept by account, operation type and sequence number, so that the history of an account can be paged
+ * through for one operation type without visiting the operations of other types.
+ */
+class account_history_by_operation_index : public secondary_index
+{
+   public:
+      void object_inserted( const object& obj ) override;
+      void object_removed( const object& obj ) override;
+
+      /// Returns the entries of @p account for operations of type @p operation_type whose sequence numbers are
+      /// between @p min_sequence and @p max_sequence inclusive, most recent first, at most @p limit of them
+      vector<account_history_id_type> get_entries( account_id_type account, int64_t operation_type,
+                                                   uint64_t min_sequence, uint64_t max_sequence,
+                                                   uint32_t limit )const;
+
+   private:
+      /// Entries by account, operation type and sequence number
+      std::map< std::tuple< account_id_type, int64_t, uint64_t >, account_history_id_type > _entries;
+};
+
 namespace detail
 {
     class account_history_plugin_impl;
 }
 
+class account_history_store;
+
 class account_history_plugin : public graphene::app::plugin
 {
    public:
@@ -74,8 +103,13 @@ class account_history_plugin : public graphene::app::plugin
          boost::program_options::options_description& cfg) override;
       void plugin_initialize(const boost::program_options::variables_map& options) override;
       void plugin_startup() override;
+      void plugin_shutdown() override;
 
       flat_set<account_id_type> tracked_accounts()const;
+      /// Returns the store which keeps the histories if they are kept on disk, otherwise nullptr
+      const account_history_store* history_store()const;
+      /// Returns the index of the histories by operation type if it is kept, otherwise nullptr
+      const account_history_by_operation_index* history_by_operation_index()const;
 
    private:
       std::unique_ptr<detail::account_history_plugin_impl> my;
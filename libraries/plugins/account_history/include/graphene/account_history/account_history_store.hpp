@@ -0,0 +1,157 @@
+/*
+ * Acloudbank
+ */
+#pragma once
+
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <boost/endian/buffers.hpp>
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+
+namespace graphene { namespace account_history {
+   using namespace chain;
+
+   namespace detail
+   {
+      /// Location of an operation in the operation log, empty if the operation is not stored
+      struct operation_entry
+      {
+         boost::endian::little_uint64_buf_t pos;
+         boost::endian::little_uint32_buf_t size;
+         /// Block of the operation, for empty entries the block of the next stored operation
+         boost::endian::little_uint32_buf_t block_num;
+      };
+
+      /// One operation in the history of an account
+      struct account_entry
+      {
+         boost::endian::little_uint64_buf_t account;
+         boost::endian::little_uint64_buf_t operation;
+         /// Sequence number of the operation in the history of the account, starting at 1
+         boost::endian::little_uint64_buf_t sequence;
+         /// Previous entry of the same account
+         boost::endian::little_uint64_buf_t prev;
+         /// Older entry of the same account to skip to when searching
+         boost::endian::little_uint64_buf_t skip;
+      };
+
+      struct account_head
+      {
+         /// Latest entry of the account
+         uint64_t last_entry = std::numeric_limits<uint64_t>::max();
+         uint64_t total_ops = 0;
+      };
+
+      struct mapped_file;
+   }
+
+   /**
+    * @brief Keeps operation history and account histories in files instead of the object database
+    *
+    * Operations are appended to a log in the order they are applied, an index with one fixed-size entry per
+    * operation ID locates them in the log.  The history of every account is a chain of fixed-size entries in an
+    * account index, each entry pointing to the previous one of the same account and to an older one for skipping,
+    * so that any sequence number or operation ID of an account is found in a logarithmic number of steps.
+    * Only the latest entry and the number of entries of each account are kept in memory.
+    *
+    * Files are read through read-only memory mappings.  Data appended since the last @ref flush is kept in memory.
+    *
+    * Operations of blocks which are applied again after a fork switch are removed by @ref remove_from_block.
+    */
+   class account_history_store
+   {
+      public:
+         account_history_store();
+         ~account_history_store();
+
+         void open( const fc::path& dir );
+         bool is_open()const;
+         void close();
+         /// Writes the data appended since the last call to the files, without syncing them to disk
+         void flush();
+
+         /// Block number of the latest operation stored, 0 if none
+         uint32_t last_block_num()const;
+         /// ID of the next operation to be appended
+         operation_history_id_type next_operation_id()const;
+
+         /// Removes all operations of the block @p block_num and later blocks
+         void remove_from_block( uint32_t block_num );
+         /// Appends @p op, IDs between the last stored operation and the ID of @p op are left empty
+         void append_operation( const operation_history_object& op );
+         /// Appends the operation @p op_id to the history of @p account, @p op_id must have been appended already
+         void append_account_operation( account_id_type account, operation_history_id_type op_id );
+
+         optional<operation_history_object> get_operation( operation_history_id_type op_id )const;
+         /// Number of operations in the history of @p account
+         uint64_t get_account_total_ops( account_id_type account )const;
+
+         /// These methods behave like those of the same name in @ref graphene::app::history_api
+         /// @{
+         vector<operation_history_object> get_account_history( account_id_type account,
+                                                               operation_history_id_type stop,
+                                                               uint32_t limit,
+                                                               operation_history_id_type start )const;
+         vector<operation_history_object> get_account_history_operations( account_id_type account,
+                                                                          int64_t operation_type,
+                                                                          operation_history_id_type start,
+                                                                          operation_history_id_type stop,
+                                                                          uint32_t limit )const;
+         vector<operation_history_object> get_relative_account_history( account_id_type account,
+                                                                        uint64_t stop,
+                                                                        uint32_t limit,
+                                                                        uint64_t start )const;
+         /// @}
+
+      private:
+         detail::operation_entry read_operation_entry( uint64_t op_num )const;
+         detail::account_entry   read_account_entry( uint64_t entry_num )const;
+         /// Reads the operation referenced by @p e
+         operation_history_object read_operation( const detail::operation_entry& e )const;
+
+         /// Returns the entry of @p account with the given sequence number, walking back from @p entry_num
+         uint64_t find_by_sequence( uint64_t entry_num, uint64_t sequence )const;
+         /// Returns the latest entry of @p account whose operation is not newer than @p op_num, or npos
+         uint64_t find_by_operation( uint64_t entry_num, uint64_t op_num )const;
+
+         /// Returns the mapping of @p filename, re-mapping the flushed part of the file if the mapping is shorter
+         /// than @p required
+         const char* mapped( std::unique_ptr<detail::mapped_file>& file, const fc::path& filename,
+                             uint64_t required, uint64_t file_size )const;
+         void unmap_files();
+
+         void save_account_heads()const;
+         void load_account_heads();
+
+         fc::path _dir;
+
+         FILE*    _operations_file = nullptr;
+         FILE*    _operation_index_file = nullptr;
+         FILE*    _account_index_file = nullptr;
+
+         /// Sizes of the files, without the data which has not been flushed
+         uint64_t _operations_size = 0;
+         uint64_t _operation_count = 0;
+         uint64_t _account_entry_count = 0;
+
+         /// Data appended since the last flush
+         vector<char>                    _pending_operations;
+         vector<detail::operation_entry> _pending_operation_entries;
+         vector<detail::account_entry>   _pending_account_entries;
+
+         /// Latest entry and number of entries of every account, indexed by account instance
+         vector<detail::account_head>    _account_heads;
+
+         mutable std::unique_ptr<detail::mapped_file> _operations_map;
+         mutable std::unique_ptr<detail::mapped_file> _operation_index_map;
+         mutable std::unique_ptr<detail::mapped_file> _account_index_map;
+   };
+
+} } // graphene::account_history
+
+FC_REFLECT( graphene::account_history::detail::account_head, (last_entry)(total_ops) )
@@ -3,6 +3,7 @@
  */
 
 #include <graphene/api_helper_indexes/api_helper_indexes.hpp>
+#include <graphene/chain/account_object.hpp>
 #include <graphene/chain/liquidity_pool_object.hpp>
 #include <graphene/chain/market_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
@@ -110,6 +111,48 @@ const flat_set<liquidity_pool_id_type>& asset_in_liquidity_pools_index::get_liqu
    return empty_set;
 }
 
+void asset_holders_index::object_inserted( const object& objct )
+{ try {
+   const account_balance_object& o = static_cast<const account_balance_object&>( objct );
+   auto& count = counts[o.asset_type];
+   ++count.balances;
+   if( o.balance != 0 )
+      ++count.holders;
+} FC_CAPTURE_AND_RETHROW( (objct) ) } // GCOVR_EXCL_LINE
+
+void asset_holders_index::object_removed( const object& objct )
+{ try {
+   const account_balance_object& o = static_cast<const account_balance_object&>( objct );
+   auto itr = counts.find( o.asset_type );
+   if( itr == counts.end() ) // should not happen
+      return;
+   --itr->second.balances;
+   if( o.balance != 0 )
+      --itr->second.holders;
+} FC_CAPTURE_AND_RETHROW( (objct) ) } // GCOVR_EXCL_LINE
+
+void asset_holders_index::about_to_modify( const object& objct )
+{ try {
+   object_removed( objct );
+} FC_CAPTURE_AND_RETHROW( (objct) ) } // GCOVR_EXCL_LINE
+
+void asset_holders_index::object_modified( const object& objct )
+{ try {
+   object_inserted( objct );
+} FC_CAPTURE_AND_RETHROW( (objct) ) } // GCOVR_EXCL_LINE
+
+uint64_t asset_holders_index::get_balance_count( const asset_id_type& asset )const
+{
+   auto itr = counts.find( asset );
+   return itr == counts.end() ? 0 : itr->second.balances;
+}
+
+uint64_t asset_holders_index::get_holder_count( const asset_id_type& asset )const
+{
+   auto itr = counts.find( asset );
+   return itr == counts.end() ? 0 : itr->second.holders;
+}
+
 namespace detail
 {
 
@@ -181,6 +224,10 @@ void api_helper_indexes::plugin_startup()
    for( const auto& pool : database().get_index_type<liquidity_pool_index>().indices() )
       asset_in_liquidity_pools_idx->object_inserted( pool );
 
+   asset_holders_idx = database().add_secondary_index< primary_index<account_balance_index>, asset_holders_index >();
+   for( const auto& balance : database().get_index_type<account_balance_index>().indices() )
+      asset_holders_idx->object_inserted( balance );
+
    next_object_ids_idx = database().add_secondary_index< primary_index<simple_index<chain_property_object>>,
                                                         next_object_ids_index >();
    refresh_next_ids();
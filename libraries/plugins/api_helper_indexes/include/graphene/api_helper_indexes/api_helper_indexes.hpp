@@ -52,6 +52,33 @@ class asset_in_liquidity_pools_index: public secondary_index
       flat_map<asset_id_type, flat_set<liquidity_pool_id_type>> asset_in_pools_map;
 };
 
+/**
+ *  @brief This secondary index tracks the number of balance objects and the number of holders of every asset.
+ *  @note This is implemented with \c flat_map considering new assets are rarely created, while balances change
+ *        often, so lookups are more frequent than insertions.
+ */
+class asset_holders_index : public secondary_index
+{
+   public:
+      void object_inserted( const object& obj ) override;
+      void object_removed( const object& obj ) override;
+      void about_to_modify( const object& before ) override;
+      void object_modified( const object& after ) override;
+
+      /// Number of balance objects of @p asset, including those with a zero balance
+      uint64_t get_balance_count( const asset_id_type& asset )const;
+      /// Number of accounts with a non-zero balance of @p asset
+      uint64_t get_holder_count( const asset_id_type& asset )const;
+
+   private:
+      struct holder_count
+      {
+         uint64_t balances = 0;
+         uint64_t holders = 0;
+      };
+      flat_map<asset_id_type, holder_count> counts;
+};
+
 /**
  *  @brief This secondary index tracks the next ID of all object types.
  *  @note This is implemented with \c flat_map considering there aren't too many object types in the system thus
@@ -92,6 +119,7 @@ class api_helper_indexes : public graphene::app::plugin
       std::unique_ptr<detail::api_helper_indexes_impl> my;
       amount_in_collateral_index* amount_in_collateral_idx = nullptr;
       asset_in_liquidity_pools_index* asset_in_liquidity_pools_idx = nullptr;
+      asset_holders_index* asset_holders_idx = nullptr;
       next_object_ids_index* next_object_ids_idx = nullptr;
 
       bool _next_ids_map_initialized = false;
@@ -397,6 +397,7 @@ void elasticsearch_plugin_impl::add_elasticsearch( const account_id_type& accoun
       obj.account = account_id;
       obj.sequence = stats_obj.total_ops + 1;
       obj.next = stats_obj.most_recent_op;
+      obj.operation_type = oho->op.which();
    });
 
    db.modify( stats_obj, [&ath]( account_statistics_object &obj ) {
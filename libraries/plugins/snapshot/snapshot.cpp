@@ -7,6 +7,7 @@
 #include <graphene/chain/database.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/thread/parallel.hpp>
 
 using namespace graphene::snapshot_plugin;
 using std::string;
@@ -17,6 +18,8 @@ namespace bpo = boost::program_options;
 static const char* OPT_BLOCK_NUM  = "snapshot-at-block";
 static const char* OPT_BLOCK_TIME = "snapshot-at-time";
 static const char* OPT_DEST       = "snapshot-to";
+static const char* OPT_FORMAT     = "snapshot-format";
+static const char* OPT_LOAD       = "snapshot-load-from";
 
 void snapshot_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
@@ -26,6 +29,11 @@ void snapshot_plugin::plugin_set_program_options(
          (OPT_BLOCK_NUM, bpo::value<uint32_t>(), "Block number after which to do a snapshot")
          (OPT_BLOCK_TIME, bpo::value<string>(), "Block time (ISO format) after which to do a snapshot")
          (OPT_DEST, bpo::value<string>(), "Pathname of JSON file where to store the snapshot")
+         (OPT_FORMAT, bpo::value<string>()->default_value("json"),
+               "Format of the snapshot, 'json' for one JSON object per line, or 'binary' for packed objects "
+               "which are written in a background thread")
+         (OPT_LOAD, bpo::value<string>(),
+               "Pathname of a binary snapshot to initialize the object database from if it is empty")
          ;
    config_file_options.add(command_line_options);
 }
@@ -44,11 +52,20 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
 { try {
    ilog("snapshot plugin: plugin_initialize() begin");
 
+   if( options.count(OPT_LOAD) > 0 )
+      database().set_snapshot_to_load( options[OPT_LOAD].as<std::string>() );
+
    if( options.count(OPT_BLOCK_NUM) > 0 || options.count(OPT_BLOCK_TIME) > 0 )
    {
       FC_ASSERT( options.count(OPT_DEST) > 0,
                  "Must specify snapshot-to in addition to snapshot-at-block or snapshot-at-time!" );
       dest = options[OPT_DEST].as<std::string>();
+      if( options.count(OPT_FORMAT) > 0 )
+      {
+         const auto& format = options[OPT_FORMAT].as<std::string>();
+         FC_ASSERT( format == "json" || format == "binary", "Unknown snapshot-format ${f}", ("f",format) );
+         binary_format = ( format == "binary" );
+      }
       if( options.count(OPT_BLOCK_NUM) > 0 )
          snapshot_block = options[OPT_BLOCK_NUM].as<uint32_t>();
       if( options.count(OPT_BLOCK_TIME) > 0 )
@@ -97,12 +114,50 @@ static void create_snapshot( const graphene::chain::database& db, const fc::path
    ilog("snapshot plugin: created snapshot");
 }
 
+void snapshot_plugin::plugin_shutdown()
+{
+   wait_for_snapshot();
+}
+
+void snapshot_plugin::create_binary_snapshot()
+{
+   ilog("snapshot plugin: creating binary snapshot");
+   wait_for_snapshot();
+   // only packing the objects blocks the chain, the file is written in another thread
+   auto snapshot = database().take_snapshot();
+   const fc::path filename = dest;
+   write_task = fc::do_parallel( [snapshot,filename] () {
+      graphene::db::object_database::save_snapshot( *snapshot, filename );
+      ilog("snapshot plugin: created binary snapshot");
+   });
+}
+
+void snapshot_plugin::wait_for_snapshot()
+{
+   if( !write_task.valid() )
+      return;
+   try
+   {
+      write_task.wait();
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Failed to write snapshot: ${ex}", ("ex",e) );
+   }
+   write_task = fc::future<void>();
+}
+
 void snapshot_plugin::check_snapshot( const graphene::chain::signed_block& b )
 { try {
     uint32_t current_block = b.block_num();
     if( (last_block < snapshot_block && snapshot_block <= current_block)
            || (last_time < snapshot_time && snapshot_time <= b.timestamp) )
-       create_snapshot( database(), dest );
+    {
+       if( binary_format )
+          create_binary_snapshot();
+       else
+          create_snapshot( database(), dest );
+    }
     last_block = current_block;
     last_time = b.timestamp;
 } FC_LOG_AND_RETHROW() }
@@ -0,0 +1,87 @@
+// AcloudBank
+#pragma once
+
+#include <graphene/protocol/types.hpp>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace protocol {
+
+   /// Counters of the @ref signature_cache
+   struct signature_cache_stats
+   {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t size = 0;
+      uint64_t capacity = 0;
+   };
+
+   /**
+    * @brief Process-wide cache of the public keys recovered from transaction signatures
+    *
+    * A transaction is usually seen several times as separate objects, e.g. first in a transaction message and
+    * later in a block, so keys are cached by signed digest and signature rather than per transaction object.
+    * The least recently used keys are evicted when the cache is full.  The cache is split into shards with
+    * separate locks so that the threads precomputing transactions rarely wait for each other.
+    */
+   class signature_cache
+   {
+      public:
+         static constexpr size_t default_capacity = 100000;
+
+         static signature_cache& instance();
+
+         /// Returns the public key which created @p sig over @p digest, recovering it if it is not cached
+         public_key_type recover( const signature_type& sig, const digest_type& digest );
+
+         /// Sets the maximum number of cached keys, 0 disables the cache
+         void set_capacity( size_t capacity );
+         void clear();
+
+         signature_cache_stats get_stats()const;
+
+      private:
+         struct cache_key
+         {
+            digest_type    digest;
+            signature_type signature;
+
+            bool operator==( const cache_key& other )const
+            {
+               return digest == other.digest && signature == other.signature;
+            }
+         };
+         struct cache_key_hash
+         {
+            size_t operator()( const cache_key& key )const;
+         };
+
+         struct shard
+         {
+            using lru_list = std::list<std::pair<cache_key, public_key_type>>;
+
+            std::mutex                                                        mutex;
+            /// Most recently used entries first
+            lru_list                                                          entries;
+            std::unordered_map<cache_key, lru_list::iterator, cache_key_hash> lookup;
+         };
+
+         static constexpr size_t shard_count = 16;
+
+         signature_cache();
+
+         shard& get_shard( const cache_key& key );
+
+         std::unique_ptr<shard[]> _shards;
+         std::atomic<size_t>      _capacity_per_shard;
+         std::atomic<uint64_t>    _hits{ 0 };
+         std::atomic<uint64_t>    _misses{ 0 };
+   };
+
+} } // graphene::protocol
+
+FC_REFLECT( graphene::protocol::signature_cache_stats, (hits)(misses)(size)(capacity) )
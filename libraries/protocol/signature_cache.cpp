@@ -0,0 +1,115 @@
+// AcloudBank
+
+#include <graphene/protocol/signature_cache.hpp>
+
+#include <cstring>
+
+namespace graphene { namespace protocol {
+
+constexpr size_t signature_cache::default_capacity;
+constexpr size_t signature_cache::shard_count;
+
+signature_cache& signature_cache::instance()
+{
+   static signature_cache cache;
+   return cache;
+}
+
+signature_cache::signature_cache()
+: _shards( new shard[shard_count] ), _capacity_per_shard( default_capacity / shard_count )
+{}
+
+size_t signature_cache::cache_key_hash::operator()( const cache_key& key )const
+{
+   // digest and signature are both uniformly distributed, a few bytes of each are enough
+   uint64_t d;
+   uint64_t s;
+   memcpy( &d, key.digest.data(), sizeof(d) );
+   memcpy( &s, key.signature.data + 1, sizeof(s) );
+   return std::hash<uint64_t>()( d ^ s );
+}
+
+signature_cache::shard& signature_cache::get_shard( const cache_key& key )
+{
+   return _shards[ cache_key_hash()( key ) % shard_count ];
+}
+
+public_key_type signature_cache::recover( const signature_type& sig, const digest_type& digest )
+{
+   const size_t capacity = _capacity_per_shard;
+   if( capacity == 0 )
+      return fc::ecc::public_key( sig, digest );
+
+   cache_key key{ digest, sig };
+   shard& s = get_shard( key );
+   {
+      std::lock_guard<std::mutex> lock( s.mutex );
+      auto itr = s.lookup.find( key );
+      if( itr != s.lookup.end() )
+      {
+         s.entries.splice( s.entries.begin(), s.entries, itr->second );
+         ++_hits;
+         return itr->second->second;
+      }
+   }
+
+   // recover without holding the lock, it is by far the most expensive part
+   public_key_type result = fc::ecc::public_key( sig, digest );
+   ++_misses;
+
+   std::lock_guard<std::mutex> lock( s.mutex );
+   if( s.lookup.find( key ) == s.lookup.end() )
+   {
+      s.entries.emplace_front( key, result );
+      s.lookup.emplace( key, s.entries.begin() );
+      while( s.entries.size() > capacity )
+      {
+         s.lookup.erase( s.entries.back().first );
+         s.entries.pop_back();
+      }
+   }
+   return result;
+}
+
+void signature_cache::set_capacity( size_t capacity )
+{
+   _capacity_per_shard = ( capacity + shard_count - 1 ) / shard_count;
+   for( size_t i = 0; i < shard_count; ++i )
+   {
+      shard& s = _shards[i];
+      std::lock_guard<std::mutex> lock( s.mutex );
+      while( s.entries.size() > _capacity_per_shard )
+      {
+         s.lookup.erase( s.entries.back().first );
+         s.entries.pop_back();
+      }
+   }
+}
+
+void signature_cache::clear()
+{
+   for( size_t i = 0; i < shard_count; ++i )
+   {
+      shard& s = _shards[i];
+      std::lock_guard<std::mutex> lock( s.mutex );
+      s.lookup.clear();
+      s.entries.clear();
+   }
+}
+
+signature_cache_stats signature_cache::get_stats()const
+{
+   signature_cache_stats result;
+   result.hits = _hits;
+   result.misses = _misses;
+   result.capacity = _capacity_per_shard * shard_count;
+   for( size_t i = 0; i < shard_count; ++i )
+   {
+      shard& s = _shards[i];
+      std::lock_guard<std::mutex> lock( s.mutex );
+      result.size += s.entries.size();
+   }
+   return result;
+}
+
+} } // graphene::protocol
@@ -6,6 +6,7 @@
 #include <graphene/protocol/fee_schedule.hpp>
 #include <graphene/protocol/pts_address.hpp>
 #include <graphene/protocol/restriction_predicate.hpp>
+#include <graphene/protocol/signature_cache.hpp>
 
 #include <fc/io/raw.hpp>
 
@@ -329,10 +330,11 @@ const flat_set<public_key_type>& signed_transaction::get_signature_keys( const c
 { try {
    auto d = sig_digest( chain_id );
    flat_set<public_key_type> result;
+   signature_cache& cache = signature_cache::instance();
    for( const auto&  sig : signatures )
    {
       GRAPHENE_ASSERT(
-         result.insert( fc::ecc::public_key(sig,d) ).second,
+         result.insert( cache.recover( sig, d ) ).second,
             tx_duplicate_sig,
             "Duplicate Signature detected" );
    }
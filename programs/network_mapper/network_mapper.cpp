@@ -68,9 +68,10 @@ public:
   } }
 
   void on_message(graphene::net::peer_connection* originating_peer,
-                  const graphene::net::message& received_message) override
+                  const graphene::net::decoded_message& decoded) override
   {
-    graphene::net::message_hash_type message_hash = received_message.id();
+    const graphene::net::message& received_message = decoded.msg;
+    const graphene::net::message_hash_type& message_hash = decoded.hash;
     dlog( "handling message ${type} ${hash} size ${size} from peer ${endpoint}",
           ("type", graphene::net::core_message_type_enum(received_message.msg_type.value() ) )
           ("hash", message_hash )
@@ -16,6 +16,8 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <fstream>
+
 #include "../../libraries/app/application_impl.hxx"
 
 #include "../common/init_unit_test_suite.hpp"
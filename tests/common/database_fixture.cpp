@@ -194,6 +194,21 @@ std::shared_ptr<boost::program_options::variables_map> database_fixture_base::in
       fc::set_option( options, "min-blocks-to-keep", (uint32_t)3 );
       fc::set_option( options, "max-ops-per-acc-by-min-blocks", (uint64_t)5 );
    }
+   if (fixture.current_test_name == "history_on_disk")
+   {
+      fc::set_option( options, "history-on-disk", true );
+   }
+   if (fixture.current_test_name == "history_by_operation_index")
+   {
+      fc::set_option( options, "index-history-by-operation", true );
+   }
+   if (fixture.current_test_name == "history_by_operation_index_undo")
+   {
+      fc::set_option( options, "index-history-by-operation", true );
+      fc::set_option( options, "partial-operations", true );
+      fc::set_option( options, "max-ops-per-account", (uint64_t)3 );
+      fc::set_option( options, "min-blocks-to-keep", (uint32_t)0 );
+   }
    if (fixture.current_test_name == "get_account_history_operations")
    {
       fc::set_option( options, "max-ops-per-account", (uint64_t)75 );
@@ -429,6 +444,7 @@ std::shared_ptr<boost::program_options::variables_map> database_fixture_base::in
    if( fixture.current_test_name == "asset_in_collateral"
             || fixture.current_test_name == "htlc_database_api"
             || fixture.current_test_name == "liquidity_pool_apis_test"
+            || fixture.current_test_name == "asset_holders_index"
             || fixture.current_suite_name == "database_api_tests"
             || fixture.current_suite_name == "api_limit_tests" )
    {
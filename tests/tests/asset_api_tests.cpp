@@ -23,6 +23,7 @@
  */
 
 #include <boost/test/unit_test.hpp>
+#include <boost/range/distance.hpp>
 
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/app/api.hpp>
@@ -80,5 +81,51 @@ BOOST_AUTO_TEST_CASE( api_limit_get_asset_holders )
    auto holders = asset_api.get_asset_holders(std::string( asset_id_type() ), 0, 210);
    BOOST_REQUIRE_EQUAL( holders.size(), 4u );
 }
+BOOST_AUTO_TEST_CASE( asset_holders_index )
+{ try {
+   graphene::app::asset_api asset_api(app);
+   const auto& holders_index = db.get_index_type< primary_index< account_balance_index > >()
+                                 .get_secondary_index< graphene::api_helper_indexes::asset_holders_index >();
+
+   create_bitasset("USD", account_id_type());
+   auto dan = create_account("dan");
+   auto bob = create_account("bob");
+   auto alice = create_account("alice");
+
+   transfer(account_id_type()(db), dan, asset(100));
+   transfer(account_id_type()(db), alice, asset(200));
+   transfer(account_id_type()(db), bob, asset(300));
+   generate_block();
+
+   const auto& bal_idx = db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
+   auto range = bal_idx.equal_range( boost::make_tuple( asset_id_type() ) );
+   const int64_t balance_count = boost::distance( range );
+   BOOST_CHECK_EQUAL( asset_api.get_asset_holders_count( std::string( asset_id_type() ) ), balance_count - 1 );
+   BOOST_CHECK_EQUAL( holders_index.get_holder_count( asset_id_type() ), 4u );
+
+   auto holders = asset_api.get_asset_holders( std::string( asset_id_type() ), 1, 2 );
+   BOOST_REQUIRE_EQUAL( holders.size(), 2u );
+   BOOST_CHECK( holders[0].name == "bob" );
+   BOOST_CHECK( holders[1].name == "alice" );
+   BOOST_CHECK( asset_api.get_asset_holders( std::string( asset_id_type() ), 4, 100 ).empty() );
+
+   // a balance which becomes zero is no longer counted as a holder
+   transfer( dan, account_id_type()(db), asset(100) );
+   BOOST_CHECK_EQUAL( holders_index.get_holder_count( asset_id_type() ), 3u );
+   BOOST_CHECK_EQUAL( asset_api.get_asset_holders( std::string( asset_id_type() ), 0, 100 ).size(), 3u );
+   generate_block();
+   db.pop_block();
+   BOOST_CHECK_EQUAL( holders_index.get_holder_count( asset_id_type() ), 4u );
+
+   // all assets, and pages of them
+   const auto all = asset_api.get_all_asset_holders();
+   BOOST_REQUIRE_EQUAL( all.size(), db.get_index_type<asset_index>().indices().size() );
+   BOOST_CHECK_EQUAL( all[0].count, balance_count - 1 );
+   GRAPHENE_CHECK_THROW( asset_api.get_all_asset_holders( {}, 102u ), fc::exception );
+   const auto page = asset_api.get_all_asset_holders( all[1].asset_id, 1u );
+   BOOST_REQUIRE_EQUAL( page.size(), 1u );
+   BOOST_CHECK( page[0].asset_id == all[1].asset_id );
+   BOOST_CHECK_EQUAL( page[0].count, all[1].count );
+} FC_LOG_AND_RETHROW() }
 
 BOOST_AUTO_TEST_SUITE_END()
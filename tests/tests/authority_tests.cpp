@@ -2400,4 +2400,172 @@ BOOST_AUTO_TEST_CASE( self_deleting_proposal )
    db.get(pid1);
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( authority_change_within_block )
+{ try {
+   ACTOR( nathan );
+   fund( nathan );
+   generate_block();
+
+   fc::ecc::private_key key2 = generate_private_key( "nathan2" );
+   fc::ecc::private_key key3 = generate_private_key( "nathan3" );
+
+   auto update_keys = [&]( const fc::ecc::private_key& signing_key, const fc::ecc::private_key& new_key ) {
+      account_update_operation op;
+      op.account = nathan_id;
+      op.active = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+      op.owner = *op.active;
+      trx.clear();
+      trx.operations.push_back( op );
+      set_expiration( db, trx );
+      sign( trx, signing_key );
+      PUSH_TX( db, trx );
+   };
+   auto transfer_signed_by = [&]( const fc::ecc::private_key& signing_key, uint32_t skip ) {
+      transfer_operation op;
+      op.from = nathan_id;
+      op.to = account_id_type();
+      op.amount = asset( 1000 );
+      trx.clear();
+      trx.operations.push_back( op );
+      set_expiration( db, trx );
+      sign( trx, signing_key );
+      PUSH_TX( db, trx, skip );
+   };
+
+   // A transaction signed with a key which becomes valid earlier in the same block
+   update_keys( nathan_private_key, key2 );
+   transfer_signed_by( key2, database::skip_nothing );
+   signed_block good_block = generate_block();
+   BOOST_REQUIRE_EQUAL( good_block.transactions.size(), 2u );
+   db.pop_block();
+   db.clear_pending();
+   PUSH_BLOCK( db, good_block, database::skip_nothing );
+   BOOST_CHECK( db.head_block_id() == good_block.id() );
+   BOOST_CHECK( nathan_id(db).active == authority( 1, public_key_type( key2.get_public_key() ), 1 ) );
+
+   // A transaction signed with a key which is replaced earlier in the same block
+   update_keys( key2, key3 );
+   transfer_signed_by( key2, database::skip_transaction_signatures );
+   signed_block bad_block = generate_block();
+   BOOST_REQUIRE_EQUAL( bad_block.transactions.size(), 2u );
+   db.pop_block();
+   db.clear_pending();
+   GRAPHENE_REQUIRE_THROW( PUSH_BLOCK( db, bad_block, database::skip_nothing ), fc::exception );
+   BOOST_CHECK( db.head_block_id() == good_block.id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( parallel_authority_checks_through_account_auths )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice );
+   generate_block();
+
+   fc::ecc::private_key bob_key2 = generate_private_key( "bob2" );
+
+   {
+      // alice is controlled by bob
+      account_update_operation op;
+      op.account = alice_id;
+      op.active = authority( 1, bob_id, 1 );
+      trx.clear();
+      trx.operations.push_back( op );
+      set_expiration( db, trx );
+      sign( trx, alice_private_key );
+      PUSH_TX( db, trx );
+   }
+   generate_block();
+
+   auto transfer_from_alice = [&]( const fc::ecc::private_key& signing_key, int64_t amount ) {
+      transfer_operation op;
+      op.from = alice_id;
+      op.to = account_id_type();
+      op.amount = asset( amount );
+      trx.clear();
+      trx.operations.push_back( op );
+      set_expiration( db, trx );
+      sign( trx, signing_key );
+      PUSH_TX( db, trx );
+   };
+
+   // The last transfer is signed with a key of bob which becomes valid earlier in the same block
+   transfer_from_alice( bob_private_key, 1000 );
+   {
+      account_update_operation op;
+      op.account = bob_id;
+      op.active = authority( 1, public_key_type( bob_key2.get_public_key() ), 1 );
+      trx.clear();
+      trx.operations.push_back( op );
+      set_expiration( db, trx );
+      sign( trx, bob_private_key );
+      PUSH_TX( db, trx );
+   }
+   transfer_from_alice( bob_key2, 2000 );
+   signed_block block = generate_block();
+   BOOST_REQUIRE_EQUAL( block.transactions.size(), 3u );
+   const int64_t balance = get_balance( alice_id, asset_id_type() );
+
+   for( bool parallel : { true, false } )
+   {
+      db.pop_block();
+      db.clear_pending();
+      db.enable_parallel_authority_checks( parallel );
+      PUSH_BLOCK( db, block, database::skip_nothing );
+      BOOST_CHECK( db.head_block_id() == block.id() );
+      BOOST_CHECK_EQUAL( get_balance( alice_id, asset_id_type() ), balance );
+   }
+   db.enable_parallel_authority_checks( true );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( pending_transactions_after_authority_change )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice );
+   fund( bob );
+   generate_block();
+
+   fc::ecc::private_key alice_key2 = generate_private_key( "alice2" );
+   auto transfer_signed_by = [&]( account_id_type from, const fc::ecc::private_key& signing_key ) {
+      transfer_operation op;
+      op.from = from;
+      op.to = account_id_type();
+      op.amount = asset( 1000 );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_expiration( db, tx );
+      sign( tx, signing_key );
+      PUSH_TX( db, tx );
+      return tx.id();
+   };
+
+   // a block which replaces the key of alice
+   {
+      account_update_operation op;
+      op.account = alice_id;
+      op.active = authority( 1, public_key_type( alice_key2.get_public_key() ), 1 );
+      trx.clear();
+      trx.operations.push_back( op );
+      set_expiration( db, trx );
+      sign( trx, alice_private_key );
+      PUSH_TX( db, trx );
+   }
+   signed_block block = generate_block();
+   db.pop_block();
+   db.clear_pending();
+   db._popped_tx.clear();
+
+   // pending transactions signed with the old key of alice, and with the unchanged key of bob
+   transaction_id_type alice_trx = transfer_signed_by( alice_id, alice_private_key );
+   transaction_id_type bob_trx = transfer_signed_by( bob_id, bob_private_key );
+   BOOST_CHECK_EQUAL( db._pending_tx_authority_reads.count( alice_trx ), 1u );
+   BOOST_CHECK_EQUAL( db._pending_tx_authority_reads.count( bob_trx ), 1u );
+
+   PUSH_BLOCK( db, block );
+   // only the transaction of bob is still valid and pending
+   BOOST_CHECK_EQUAL( db._pending_tx_authority_reads.count( alice_trx ), 0u );
+   BOOST_CHECK_EQUAL( db._pending_tx_authority_reads.count( bob_trx ), 1u );
+   signed_block next_block = generate_block();
+   BOOST_REQUIRE_EQUAL( next_block.transactions.size(), 1u );
+   BOOST_CHECK( next_block.transactions[0].id() == bob_trx );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
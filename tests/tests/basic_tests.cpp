@@ -32,6 +32,8 @@
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/protocol/signature_cache.hpp>
+
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
 #include "../common/database_fixture.hpp"
@@ -709,4 +711,45 @@ BOOST_AUTO_TEST_CASE( bitasset_feed_expiration_test )
    BOOST_CHECK( !o.feed_is_expired( now ) );
 }
 
+BOOST_AUTO_TEST_CASE( signature_cache_test )
+{
+   signature_cache& cache = signature_cache::instance();
+   cache.clear();
+
+   fc::ecc::private_key key1 = generate_private_key( "key1" );
+   fc::ecc::private_key key2 = generate_private_key( "key2" );
+   signed_transaction tx;
+   transfer_operation op;
+   op.from = account_id_type(1);
+   op.to = account_id_type(2);
+   op.amount = asset( 1 );
+   tx.operations.push_back( op );
+   tx.sign( key1, db.get_chain_id() );
+   tx.sign( key2, db.get_chain_id() );
+   const flat_set<public_key_type> expected{ key1.get_public_key(), key2.get_public_key() };
+
+   // the same transaction seen again as a separate object, e.g. in a block
+   const signature_cache_stats before = cache.get_stats();
+   precomputable_transaction first( tx );
+   BOOST_CHECK( first.get_signature_keys( db.get_chain_id() ) == expected );
+   precomputable_transaction second( tx );
+   BOOST_CHECK( second.get_signature_keys( db.get_chain_id() ) == expected );
+   signature_cache_stats after = cache.get_stats();
+   BOOST_CHECK_EQUAL( after.misses - before.misses, 2u );
+   BOOST_CHECK_EQUAL( after.hits - before.hits, 2u );
+   BOOST_CHECK_EQUAL( after.size, 2u );
+
+   // a different digest is not served from the cache
+   tx.ref_block_num = 1;
+   precomputable_transaction third( tx );
+   BOOST_CHECK( third.get_signature_keys( db.get_chain_id() ) != expected );
+   BOOST_CHECK_EQUAL( cache.get_stats().misses - after.misses, 2u );
+
+   // the least recently used keys are evicted
+   cache.set_capacity( 1 );
+   BOOST_CHECK_LE( cache.get_stats().size, cache.get_stats().capacity );
+   BOOST_CHECK_LE( cache.get_stats().capacity, 16u );
+   cache.set_capacity( signature_cache::default_capacity );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
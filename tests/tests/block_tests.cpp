@@ -36,6 +36,8 @@
 #include <graphene/chain/witness_schedule_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 
+#include <graphene/net/core_messages.hpp>
+
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -43,6 +45,10 @@
 
 #include "../common/database_fixture.hpp"
 
+#include <atomic>
+#include <fstream>
+#include <thread>
+
 using namespace graphene::chain;
 using namespace graphene::chain::test;
 
@@ -127,6 +133,184 @@ BOOST_AUTO_TEST_CASE( block_database_test )
          FC_ASSERT( blk->witness == witness_id_type(blk->block_num()) );
       }
 
+      // an index whose blocks are missing is not truncated
+      bdb.close();
+      const auto index_size = fc::file_size( data_dir.path() / "index" );
+      BOOST_REQUIRE( index_size > 0 );
+      fc::remove( data_dir.path() / "blocks" );
+      BOOST_CHECK_THROW( bdb.open( data_dir.path() ), fc::exception );
+      BOOST_CHECK( !bdb.is_open() );
+      BOOST_CHECK_EQUAL( fc::file_size( data_dir.path() / "index" ), index_size );
+
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_raw_fetch_checks_index_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      clearable_block b;
+      for( uint32_t i = 0; i < 3; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+      }
+      bdb.close();
+
+      // let the index entry of block 3 point to the data of block 2
+      const fc::path index_file = data_dir.path() / "index";
+      std::string index;
+      fc::read_file_contents( index_file, index );
+      const size_t entry_size = index.size() / 4;
+      const size_t location_size = 12; // position and size of the block, followed by its id
+      index.replace( 3 * entry_size, location_size, index.substr( 2 * entry_size, location_size ) );
+      {
+         std::ofstream out( index_file.generic_string(), std::ios::binary | std::ios::trunc );
+         out.write( index.data(), index.size() );
+      }
+
+      bdb.open( data_dir.path() );
+      BOOST_CHECK( bdb.fetch_raw_by_number( 2 ).valid() );
+      BOOST_CHECK( !bdb.fetch_raw_by_number( 3 ).valid() );
+      BOOST_CHECK( !bdb.fetch_raw_optional( b.id() ).valid() );
+      BOOST_CHECK( !bdb.fetch_by_number( 3 ).valid() );
+
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_concurrent_read_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+
+      const uint32_t num_blocks = 200;
+      std::vector<signed_block> blocks;
+      clearable_block b;
+      for( uint32_t i = 0; i < num_blocks; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         blocks.push_back( b );
+         blocks.back().id(); // cache the id before it is read concurrently
+      }
+
+      // readers start while the writer is still appending
+      std::atomic<uint32_t> stored( 0 );
+      for( ; stored < num_blocks / 2; ++stored )
+         bdb.store( blocks[stored].id(), blocks[stored] );
+
+      std::atomic<uint32_t> failures( 0 );
+      std::vector<std::thread> readers;
+      for( uint32_t t = 0; t < 4; ++t )
+         readers.emplace_back( [&bdb,&stored,&failures,&blocks,t]() {
+            for( uint32_t round = 0; round < 20; ++round )
+               for( uint32_t n = 1 + t; n <= stored; n += 4 )
+               {
+                  auto blk = bdb.fetch_by_number( n );
+                  if( !blk.valid() || blk->witness != witness_id_type(n) || !bdb.contains( blocks[n-1].id() ) )
+                     ++failures;
+               }
+         } );
+
+      for( ; stored < num_blocks; ++stored )
+         bdb.store( blocks[stored].id(), blocks[stored] );
+      for( auto& reader : readers )
+         reader.join();
+
+      BOOST_CHECK_EQUAL( failures.load(), 0u );
+      bdb.flush();
+
+      auto last = bdb.last();
+      BOOST_REQUIRE( last.valid() );
+      BOOST_CHECK( last->id() == b.id() );
+      BOOST_CHECK( bdb.fetch_block_id( num_blocks ) == b.id() );
+      BOOST_CHECK( !bdb.fetch_by_number( num_blocks + 1 ).valid() );
+
+      bdb.remove( b.id() );
+      BOOST_CHECK( !bdb.contains( b.id() ) );
+      last = bdb.last();
+      BOOST_REQUIRE( last.valid() );
+      BOOST_CHECK( last->block_num() == num_blocks - 1 );
+
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_writer_thread_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      bdb.start_writer( 4, 3 );
+
+      const uint32_t num_blocks = 50;
+      clearable_block b;
+      for( uint32_t i = 0; i < num_blocks; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+
+         // the block can be read right away, whether it has been written yet or not
+         BOOST_CHECK( bdb.contains( b.id() ) );
+         BOOST_CHECK( bdb.fetch_block_id( i+1 ) == b.id() );
+         auto fetch = bdb.fetch_optional( b.id() );
+         BOOST_REQUIRE( fetch.valid() );
+         BOOST_CHECK( fetch->witness == b.witness );
+         auto raw = bdb.fetch_raw_by_number( i+1 );
+         BOOST_REQUIRE( raw.valid() );
+         BOOST_CHECK( *raw == fc::raw::pack( *fetch ) );
+         auto raw_by_id = bdb.fetch_raw_optional( b.id() );
+         BOOST_REQUIRE( raw_by_id.valid() );
+         BOOST_CHECK( *raw_by_id == *raw );
+      }
+
+      // a block of another fork replaces the stored one
+      clearable_block fork_block = b;
+      fork_block.witness = witness_id_type(num_blocks+1);
+      fork_block.clear();
+      bdb.store( fork_block.id(), fork_block );
+      BOOST_CHECK( bdb.contains( fork_block.id() ) );
+      BOOST_CHECK( !bdb.contains( b.id() ) );
+      BOOST_CHECK( !bdb.fetch_raw_optional( b.id() ).valid() );
+
+      auto last = bdb.last();
+      BOOST_REQUIRE( last.valid() );
+      BOOST_CHECK( last->id() == fork_block.id() );
+
+      bdb.close();
+      bdb.open( data_dir.path() );
+      for( uint32_t i = 1; i < num_blocks; ++i )
+      {
+         auto blk = bdb.fetch_by_number( i );
+         BOOST_REQUIRE( blk.valid() );
+         BOOST_CHECK( blk->witness == witness_id_type(i) );
+      }
+      BOOST_CHECK( bdb.fetch_block_id( num_blocks ) == fork_block.id() );
+      auto raw = bdb.fetch_raw_optional( fork_block.id() );
+      BOOST_REQUIRE( raw.valid() );
+      BOOST_CHECK( *raw == fc::raw::pack( signed_block( fork_block ) ) );
+
    } catch (fc::exception& e) {
       edump((e.to_detail_string()));
       throw;
@@ -192,6 +376,205 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( replay_with_small_lookahead )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      block_id_type head_id;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         for( uint32_t i = 0; i < 50; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                              database::skip_nothing);
+         head_id = db.head_block_id();
+         db.close();
+      }
+      {
+         database db;
+         // wipe the object database only, so that open() replays the stored blocks
+         db.wipe( data_dir.path(), false );
+         db.set_reindex_lookahead( 3 );
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                           database::skip_nothing);
+         BOOST_CHECK_EQUAL( db.head_block_num(), block_header::num_from_id( head_id ) + 1 );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( object_database_checkpoint_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      block_id_type checkpoint_id;
+      {
+         database db;
+         db.set_object_database_checkpoint_interval( 5 );
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         for( uint32_t i = 0; i < 22; ++i )
+         {
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                              database::skip_nothing);
+            if( db.head_block_num() == 20 )
+               checkpoint_id = db.head_block_id();
+         }
+         // simulate a crash, i.e. leave without close() and thus without a full save of the object database
+      }
+      BOOST_CHECK( fc::exists( data_dir.path() / "object_database.log" ) );
+      BOOST_CHECK( !fc::exists( data_dir.path() / "object_database" ) );
+      {
+         database db;
+         db.set_object_database_checkpoint_interval( 5 );
+         db.open(data_dir.path(), []{ return genesis_state_type(); }, "TEST" );
+         // the last checkpoint, written at block 20, holds the state at the last irreversible block,
+         // the remaining blocks have been replayed
+         BOOST_CHECK_EQUAL( db.head_block_num(), 22u );
+         BOOST_CHECK( db.fetch_block_by_number( 20 )->id() == checkpoint_id );
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                           database::skip_nothing);
+         BOOST_CHECK_EQUAL( db.head_block_num(), 23u );
+         db.close();
+      }
+      // a full save replaces the checkpoint log
+      BOOST_CHECK( !fc::exists( data_dir.path() / "object_database.log" ) );
+      {
+         database db;
+         db.open(data_dir.path(), []{ return genesis_state_type(); }, "TEST" );
+         BOOST_CHECK_EQUAL( db.head_block_num(), 23u );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( object_database_checkpoint_fork_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory fork_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      uint32_t crash_lib = 0;
+      {
+         database db;
+         db.set_object_database_checkpoint_interval( 5 );
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         for( uint32_t i = 0; i < 20; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                              database::skip_nothing);
+         // the checkpoint at block 20 is written while the blocks after the last irreversible one can be undone
+         crash_lib = db.get_dynamic_global_properties().last_irreversible_block_num;
+         BOOST_REQUIRE_LT( crash_lib, 20u );
+         // simulate a crash
+      }
+
+      database db;
+      db.set_object_database_checkpoint_interval( 5 );
+      db.open(data_dir.path(), []{ return genesis_state_type(); }, "TEST" );
+      BOOST_REQUIRE_EQUAL( db.head_block_num(), 20u );
+      BOOST_REQUIRE_EQUAL( db.get_dynamic_global_properties().last_irreversible_block_num, crash_lib );
+
+      // a longer fork starting right after the last irreversible block
+      database fork_db;
+      fork_db.open(fork_dir.path(), make_genesis, "TEST" );
+      for( uint32_t n = 1; n <= crash_lib; ++n )
+         PUSH_BLOCK( fork_db, *db.fetch_block_by_number( n ) );
+      std::vector<signed_block> fork;
+      uint32_t next_slot = 2; // skip a slot, so that the fork differs from the original chain
+      while( fork_db.head_block_num() <= 20 )
+      {
+         fork.push_back( fork_db.generate_block( fork_db.get_slot_time(next_slot),
+                                                 fork_db.get_scheduled_witness(next_slot),
+                                                 init_account_priv_key, database::skip_nothing ) );
+         next_slot = 1;
+      }
+
+      // the restarted node can unwind its blocks after the last irreversible one and switch to the fork
+      for( const auto& b : fork )
+         PUSH_BLOCK( db, b );
+      BOOST_CHECK( db.head_block_id() == fork_db.head_block_id() );
+      BOOST_CHECK_EQUAL( db.head_block_num(), 21u );
+      BOOST_CHECK( fc::raw::pack( db.get_dynamic_global_properties() )
+                   == fc::raw::pack( fork_db.get_dynamic_global_properties() ) );
+      BOOST_CHECK( fc::raw::pack( db.get_witness_schedule_object() )
+                   == fc::raw::pack( fork_db.get_witness_schedule_object() ) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( object_database_snapshot_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory snapshot_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory snapshot_data_dir( graphene::utilities::temp_directory_path() );
+      const auto snapshot_file = snapshot_dir.path() / "snapshot.bin";
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      block_id_type snapshot_id;
+      chain_id_type chain_id;
+      std::vector<signed_block> following_blocks;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         for( uint32_t i = 0; i < 10; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                              database::skip_nothing);
+         snapshot_id = db.head_block_id();
+         chain_id = db.get_chain_id();
+         auto snapshot = db.take_snapshot();
+         // later changes do not affect the snapshot
+         for( uint32_t i = 0; i < 2; ++i )
+            following_blocks.push_back( db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1),
+                                                          init_account_priv_key, database::skip_nothing) );
+         object_database::save_snapshot( *snapshot, snapshot_file );
+         db.close();
+      }
+      BOOST_CHECK( !fc::exists( snapshot_file.generic_string() + ".tmp" ) );
+      const uint32_t snapshot_num = block_header::num_from_id( snapshot_id );
+      {
+         database db;
+         db.set_snapshot_to_load( snapshot_file );
+         db.open(snapshot_data_dir.path(), []{ return genesis_state_type(); }, "TEST" );
+         BOOST_CHECK( db.head_block_id() == snapshot_id );
+         BOOST_CHECK( db.get_chain_id() == chain_id );
+         // a synopsis of the chain starts at the head block of the snapshot
+         BOOST_CHECK_EQUAL( db.last_non_undoable_block_num(), snapshot_num );
+         BOOST_CHECK( db.get_block_id_for_num( snapshot_num ) == snapshot_id );
+         BOOST_CHECK( db.is_known_block( snapshot_id ) );
+
+         // produce a block of our own, then sync the longer chain of the other node, which forks at the snapshot
+         db.generate_block(db.get_slot_time(2), db.get_scheduled_witness(2), init_account_priv_key,
+                           database::skip_nothing);
+         BOOST_CHECK_EQUAL( db.head_block_num(), snapshot_num + 1 );
+         BOOST_CHECK( db.head_block_id() != following_blocks.front().id() );
+         for( const auto& b : following_blocks )
+            PUSH_BLOCK( db, b );
+         BOOST_CHECK( db.head_block_id() == following_blocks.back().id() );
+         BOOST_CHECK_EQUAL( db.head_block_num(), snapshot_num + 2 );
+         db.close();
+      }
+      {
+         // the loaded objects have been saved, the snapshot is only used for an empty object database
+         database db;
+         db.set_snapshot_to_load( snapshot_dir.path() / "missing.bin" );
+         db.open(snapshot_data_dir.path(), []{ return genesis_state_type(); }, "TEST" );
+         BOOST_CHECK( db.head_block_id() == following_blocks.back().id() );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
    try {
@@ -789,6 +1172,33 @@ BOOST_AUTO_TEST_CASE( tapos )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( serve_block_from_stored_bytes, database_fixture )
+{
+   try {
+      generate_blocks( 5 );
+      const block_id_type id = db.head_block_id();
+
+      auto raw = db.fetch_raw_block_by_id( id );
+      BOOST_REQUIRE( raw.valid() );
+      auto blk = db.fetch_block_by_id( id );
+      BOOST_REQUIRE( blk.valid() );
+
+      // the message built from the stored bytes is the same as the one built from the unpacked block
+      graphene::net::message msg = graphene::net::block_message::from_packed_block( *raw, id );
+      graphene::net::message expected = graphene::net::block_message( *blk );
+      BOOST_CHECK( msg.msg_type.value() == expected.msg_type.value() );
+      BOOST_CHECK_EQUAL( msg.size, expected.size );
+      BOOST_CHECK( msg.data == expected.data );
+      BOOST_CHECK( graphene::net::block_message::id_of( msg ) == id );
+      BOOST_CHECK( msg.as<graphene::net::block_message>().block.id() == id );
+
+      BOOST_CHECK( !db.fetch_raw_block_by_id( block_id_type() ).valid() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_FIXTURE_TEST_CASE( optional_tapos, database_fixture )
 {
    try
@@ -1949,4 +2359,145 @@ BOOST_FIXTURE_TEST_CASE( block_size_test, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( pending_transaction_limits, database_fixture )
+{ try {
+   ACTORS( (alice)(bob)(carol) );
+   fund( alice );
+   fund( bob );
+   fund( carol );
+   generate_block();
+
+   auto make_transfer = [&]( account_id_type from, const fc::ecc::private_key& key, int64_t fee, int64_t amount ) {
+      transfer_operation op;
+      op.from = from;
+      op.to = account_id_type();
+      op.amount = asset( amount );
+      op.fee = asset( fee );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_expiration( db, tx );
+      sign( tx, key );
+      return tx;
+   };
+
+   // per account limit
+   db.set_pending_transaction_limits( 0, 2 );
+   PUSH_TX( db, make_transfer( alice_id, alice_private_key, 100, 1 ) );
+   PUSH_TX( db, make_transfer( alice_id, alice_private_key, 100, 2 ) );
+   GRAPHENE_REQUIRE_THROW( PUSH_TX( db, make_transfer( alice_id, alice_private_key, 100, 3 ) ), fc::exception );
+   PUSH_TX( db, make_transfer( bob_id, bob_private_key, 10000, 1 ) );
+
+   // blocks include the transactions paying more first, those of the same account in arrival order
+   signed_block block = generate_block();
+   BOOST_REQUIRE_EQUAL( block.transactions.size(), 3u );
+   BOOST_CHECK( block.transactions[0].operations[0].get<transfer_operation>().from == bob_id );
+   BOOST_CHECK( block.transactions[1].operations[0].get<transfer_operation>().amount == asset( 1 ) );
+   BOOST_CHECK( block.transactions[2].operations[0].get<transfer_operation>().amount == asset( 2 ) );
+
+   // total size limit
+   signed_transaction cheap = make_transfer( alice_id, alice_private_key, 100, 4 );
+   signed_transaction expensive = make_transfer( bob_id, bob_private_key, 10000, 2 );
+   signed_transaction cheapest = make_transfer( carol_id, carol_private_key, 10, 1 );
+   db.set_pending_transaction_limits( fc::raw::pack_size( cheap ) + fc::raw::pack_size( expensive ) - 1, 0 );
+   PUSH_TX( db, cheap );
+   // the cheap transaction is evicted for the expensive one
+   PUSH_TX( db, expensive );
+   BOOST_CHECK( !db.is_known_transaction( cheap.id() ) );
+   // nothing is evicted for a transaction paying less
+   GRAPHENE_REQUIRE_THROW( PUSH_TX( db, cheapest ), fc::exception );
+   // locally generated transactions are always accepted
+   PUSH_TX( db, cheapest, database::skip_block_size_check );
+
+   db.set_pending_transaction_limits( 0, 0 );
+   block = generate_block();
+   BOOST_REQUIRE_EQUAL( block.transactions.size(), 2u );
+   BOOST_CHECK( block.transactions[0].id() == expensive.id() );
+   BOOST_CHECK( block.transactions[1].id() == cheapest.id() );
+} FC_LOG_AND_RETHROW() }
+
+/// Nothing is evicted while the pending transactions are restored after pushing a block, the transactions
+/// which do not fit any more are dropped instead
+BOOST_FIXTURE_TEST_CASE( pending_transaction_limits_while_restoring, database_fixture )
+{ try {
+   ACTORS( (alice)(bob)(carol) );
+   fund( alice );
+   fund( bob );
+   fund( carol );
+   generate_block();
+
+   auto make_transfer = [&]( account_id_type from, const fc::ecc::private_key& key, int64_t fee, int64_t amount ) {
+      transfer_operation op;
+      op.from = from;
+      op.to = account_id_type();
+      op.amount = asset( amount );
+      op.fee = asset( fee );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_expiration( db, tx );
+      sign( tx, key );
+      return tx;
+   };
+
+   const signed_block empty_block = generate_block();
+   BOOST_REQUIRE( empty_block.transactions.empty() );
+   signed_transaction cheap = make_transfer( alice_id, alice_private_key, 100, 1 );
+   signed_transaction expensive = make_transfer( bob_id, bob_private_key, 10000, 1 );
+   PUSH_TX( db, cheap );
+   PUSH_TX( db, expensive );
+   BOOST_REQUIRE_EQUAL( generate_block().transactions.size(), 2u );
+
+   // the transactions of the popped blocks are restored before the pending ones
+   db.pop_block();
+   db.pop_block();
+   signed_transaction pending = make_transfer( carol_id, carol_private_key, 10000, 1 );
+   PUSH_TX( db, pending );
+   db.set_pending_transaction_limits( fc::raw::pack_size( cheap ) + fc::raw::pack_size( expensive ), 0 );
+
+   // the pending transaction pays more than the cheap one, but does not evict it while restoring
+   PUSH_BLOCK( db, empty_block );
+   BOOST_CHECK( db.head_block_id() == empty_block.id() );
+   BOOST_CHECK( db.is_known_transaction( cheap.id() ) );
+   BOOST_CHECK( db.is_known_transaction( expensive.id() ) );
+   BOOST_CHECK( !db.is_known_transaction( pending.id() ) );
+
+   // it does when it is pushed again
+   PUSH_TX( db, pending );
+   BOOST_CHECK( !db.is_known_transaction( cheap.id() ) );
+   BOOST_CHECK( db.is_known_transaction( expensive.id() ) );
+   BOOST_CHECK( db.is_known_transaction( pending.id() ) );
+
+   db.set_pending_transaction_limits( 0, 0 );
+   BOOST_CHECK_EQUAL( generate_block().transactions.size(), 2u );
+} FC_LOG_AND_RETHROW() }
+
+/// The undo history stats follow the blocks after the last irreversible block
+BOOST_FIXTURE_TEST_CASE( undo_history_stats_of_reversible_blocks, database_fixture )
+{ try {
+   // only half of the witnesses produce blocks, so that the last irreversible block falls behind
+   const auto& active_witnesses = db.get_global_properties().active_witnesses;
+   const std::set<witness_id_type> producers( active_witnesses.begin(),
+                                              active_witnesses.begin() + active_witnesses.size() / 2 );
+   for( int i = 0; i < 3 * GRAPHENE_MIN_UNDO_HISTORY; ++i )
+   {
+      uint32_t slot = 1;
+      while( producers.find( db.get_scheduled_witness( slot ) ) == producers.end() )
+         ++slot;
+      generate_block( ~0, init_account_priv_key, slot - 1 );
+   }
+
+   const uint32_t last_irreversible_block_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+   const uint32_t reversible_blocks = db.head_block_num() - last_irreversible_block_num;
+   BOOST_REQUIRE_GT( reversible_blocks, GRAPHENE_MIN_UNDO_HISTORY );
+   const auto stats = db.get_undo_history_stats();
+   BOOST_CHECK_EQUAL( stats.max_depth, reversible_blocks + 1 );
+   BOOST_CHECK_GE( stats.depth, reversible_blocks );
+   BOOST_CHECK_LE( stats.depth, stats.max_depth );
+   BOOST_CHECK_GT( stats.bytes, 0u );
+
+   // all of them can be undone, e.g. to switch to a fork
+   for( uint32_t i = 0; i < reversible_blocks; ++i )
+      db.pop_block();
+   BOOST_CHECK_EQUAL( db.head_block_num(), last_irreversible_block_num );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6269,4 +6269,66 @@ BOOST_AUTO_TEST_CASE(custom_auths) { try {
       FC_LOG_AND_RETHROW()
    }
 
+   /**
+    * A pending transaction which is approved only through a custom authority is verified again after a block,
+    * when the custom authority has expired meanwhile, although the custom authority object was not written
+    */
+   BOOST_AUTO_TEST_CASE(pending_transaction_after_custom_authority_expired) {
+      try {
+         generate_blocks(HARDFORK_BSIP_40_TIME);
+         generate_blocks(5);
+         db.modify(global_property_id_type()(db), [](global_property_object &gpo) {
+            gpo.parameters.extensions.value.custom_authority_options = custom_authority_options_type();
+         });
+         set_expiration(db, trx);
+         ACTORS((alice)(bob)(charlie))
+         fund(alice, asset(1000 * GRAPHENE_BLOCKCHAIN_PRECISION));
+         const uint32_t block_interval = db.get_global_properties().parameters.block_interval;
+
+         // Alice authorizes Bob to transfer from her account, until two blocks from now
+         custom_authority_create_operation op;
+         op.account = alice.get_id();
+         op.auth.add_authority(bob.get_id(), 1);
+         op.auth.weight_threshold = 1;
+         op.enabled = true;
+         op.valid_to = db.head_block_time() + 2 * block_interval;
+         op.operation_type = operation::tag<transfer_operation>::value;
+         trx.clear();
+         trx.operations = {op};
+         sign(trx, alice_private_key);
+         PUSH_TX(db, trx);
+         generate_block();
+
+         // a block after the custom authority has expired
+         signed_block block = generate_block(~0, init_account_priv_key, 1);
+         BOOST_REQUIRE(block.timestamp >= op.valid_to);
+         db.pop_block();
+         db.clear_pending();
+         db._popped_tx.clear();
+
+         // a pending transaction which is approved through the custom authority
+         transfer_operation bob_transfers_from_alice;
+         bob_transfers_from_alice.from = alice.get_id();
+         bob_transfers_from_alice.to = charlie.get_id();
+         bob_transfers_from_alice.amount.amount = 100 * GRAPHENE_BLOCKCHAIN_PRECISION;
+         trx.clear();
+         trx.operations = {bob_transfers_from_alice};
+         set_expiration(db, trx);
+         sign(trx, bob_private_key);
+         PUSH_TX(db, trx);
+         const transaction_id_type bob_trx = trx.id();
+         BOOST_REQUIRE_EQUAL(db._pending_tx_authority_reads.count(bob_trx), 1u);
+         BOOST_CHECK(db._pending_tx_authority_reads[bob_trx].custom_authorities);
+
+         // the custom authority object is still there, but no longer approves the pending transaction
+         PUSH_BLOCK(db, block);
+         BOOST_CHECK(db.find(custom_authority_id_type()) != nullptr);
+         BOOST_CHECK_EQUAL(db._pending_tx_authority_reads.count(bob_trx), 0u);
+         BOOST_CHECK_EQUAL(get_balance(charlie_id, asset_id_type()), 0);
+         signed_block next_block = generate_block();
+         BOOST_CHECK_EQUAL(next_block.transactions.size(), 0u);
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1454,6 +1454,92 @@ BOOST_AUTO_TEST_CASE(get_account_limit_orders)
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( get_order_book_depth )
+{ try {
+   graphene::app::database_api db_api( db, &( app.get_options() ));
+   ACTORS((seller)(buyer));
+
+   const auto& bitcny = create_user_issued_asset("CNY");
+   const auto& core   = asset_id_type()(db);
+
+   transfer( committee_account, seller_id, asset(10000000) );
+   issue_uia( buyer_id, bitcny.amount(10000000) );
+
+   BOOST_CHECK( create_sell_order( seller, core.amount(100), bitcny.amount(250) ) );
+   BOOST_CHECK( create_sell_order( seller, core.amount(100), bitcny.amount(250) ) );
+   const limit_order_id_type worse_bid_id = create_sell_order( seller, core.amount(100), bitcny.amount(300) )->get_id();
+   BOOST_CHECK( create_sell_order( buyer, bitcny.amount(100), core.amount(500) ) );
+   generate_block();
+
+   BOOST_CHECK_THROW( db_api.get_order_book_depth( GRAPHENE_SYMBOL, "CNY", 51 ), fc::exception );
+
+   auto depth = db_api.get_order_book_depth( GRAPHENE_SYMBOL, "CNY", 10 );
+   BOOST_REQUIRE_EQUAL( depth.bids.size(), 2u );
+   BOOST_CHECK( depth.bids[0].level_price == price( core.amount(100), bitcny.amount(250) ) );
+   BOOST_CHECK_EQUAL( depth.bids[0].base_amount.value, 200 );
+   BOOST_CHECK_EQUAL( depth.bids[0].quote_amount.value, 500 );
+   BOOST_CHECK_EQUAL( depth.bids[0].order_count, 2u );
+   BOOST_CHECK( depth.bids[1].level_price == price( core.amount(100), bitcny.amount(300) ) );
+   BOOST_CHECK_EQUAL( depth.bids[1].order_count, 1u );
+   BOOST_REQUIRE_EQUAL( depth.asks.size(), 1u );
+   BOOST_CHECK( depth.asks[0].level_price == price( core.amount(500), bitcny.amount(100) ) );
+   BOOST_CHECK_EQUAL( depth.asks[0].base_amount.value, 500 );
+   BOOST_CHECK_EQUAL( depth.asks[0].quote_amount.value, 100 );
+
+   depth = db_api.get_order_book_depth( GRAPHENE_SYMBOL, "CNY", 1 );
+   BOOST_CHECK_EQUAL( depth.bids.size(), 1u );
+   BOOST_CHECK_EQUAL( depth.asks.size(), 1u );
+
+   // The first notification contains the whole order book
+   vector<graphene::app::order_book_depth_update> updates;
+   auto callback = [&]( const variant& v )
+   {
+      updates.push_back( v.as<graphene::app::order_book_depth_update>( GRAPHENE_MAX_NESTED_OBJECTS ) );
+   };
+   db_api.subscribe_to_order_book_depth( callback, GRAPHENE_SYMBOL, "CNY", 10 );
+   fc::usleep(fc::milliseconds(200)); // sleep a while to execute callback in another thread
+   BOOST_REQUIRE_EQUAL( updates.size(), 1u );
+   BOOST_CHECK_EQUAL( updates[0].bids.size(), 2u );
+   BOOST_CHECK_EQUAL( updates[0].asks.size(), 1u );
+
+   // The formatted order book is served from the cache until the market changes
+   auto book = db_api.get_order_book( GRAPHENE_SYMBOL, "CNY", 10 );
+   BOOST_CHECK_EQUAL( book.bids.size(), 3u );
+   book = db_api.get_order_book( GRAPHENE_SYMBOL, "CNY", 1 );
+   BOOST_CHECK_EQUAL( book.bids.size(), 1u );
+   BOOST_CHECK_EQUAL( book.asks.size(), 1u );
+
+   // Only the changed levels are notified
+   BOOST_CHECK( create_sell_order( seller, core.amount(100), bitcny.amount(250) ) );
+   cancel_limit_order( worse_bid_id(db) );
+   generate_block();
+   fc::usleep(fc::milliseconds(200));
+   BOOST_REQUIRE_EQUAL( updates.size(), 2u );
+   BOOST_REQUIRE_EQUAL( updates[1].bids.size(), 2u );
+   BOOST_CHECK( updates[1].bids[0].level_price == price( core.amount(100), bitcny.amount(250) ) );
+   BOOST_CHECK_EQUAL( updates[1].bids[0].order_count, 3u );
+   BOOST_CHECK_EQUAL( updates[1].bids[0].base_amount.value, 300 );
+   BOOST_CHECK( updates[1].bids[1].level_price == price( core.amount(100), bitcny.amount(300) ) );
+   BOOST_CHECK_EQUAL( updates[1].bids[1].order_count, 0u );
+   BOOST_CHECK( updates[1].asks.empty() );
+
+   book = db_api.get_order_book( GRAPHENE_SYMBOL, "CNY", 10 );
+   BOOST_CHECK_EQUAL( book.bids.size(), 3u );
+   BOOST_CHECK_EQUAL( book.asks.size(), 1u );
+
+   // No notification if the market did not change
+   generate_block();
+   fc::usleep(fc::milliseconds(200));
+   BOOST_CHECK_EQUAL( updates.size(), 2u );
+
+   db_api.unsubscribe_from_order_book_depth( GRAPHENE_SYMBOL, "CNY" );
+   BOOST_CHECK( create_sell_order( buyer, bitcny.amount(100), core.amount(600) ) );
+   generate_block();
+   fc::usleep(fc::milliseconds(200));
+   BOOST_CHECK_EQUAL( updates.size(), 2u );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( get_transaction_hex )
 { try {
    graphene::app::database_api db_api(db);
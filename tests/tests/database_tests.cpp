@@ -30,6 +30,7 @@
 #include <graphene/chain/proposal_object.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/io/json.hpp>
 
 #include "../common/database_fixture.hpp"
 
@@ -138,6 +139,133 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( merge_modify_remove_undo_test )
+{
+   try {
+      database db;
+      const auto& bal_obj1 = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 42;
+      });
+      const auto& bal_obj2 = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.owner = account_id_type(1);
+          obj.balance = 7;
+      });
+      const auto id1 = bal_obj1.id;
+      const auto id2 = bal_obj2.id;
+
+      auto outer = db._undo_db.start_undo_session();
+      {
+         auto inner = db._undo_db.start_undo_session();
+         db.modify( bal_obj1, [&]( account_balance_object& obj ){ obj.balance = 43; } );
+         db.modify( bal_obj2, [&]( account_balance_object& obj ){ obj.balance = 8; } );
+         BOOST_CHECK_GT( db._undo_db.head().arena->bytes_allocated(), 0u );
+         inner.merge();
+      }
+      {
+         auto inner = db._undo_db.start_undo_session();
+         db.modify( db.get<account_balance_object>( id1 ), [&]( account_balance_object& obj ){ obj.balance = 44; } );
+         db.remove( db.get<account_balance_object>( id2 ) );
+         inner.merge();
+      }
+      BOOST_CHECK_EQUAL( 44, db.get_balance( account_id_type(), asset_id_type() ).amount.value );
+      BOOST_CHECK( db.find_object( id2 ) == nullptr );
+
+      outer.undo();
+
+      BOOST_CHECK_EQUAL( 42, db.get_balance( account_id_type(), asset_id_type() ).amount.value );
+      BOOST_CHECK_EQUAL( 7, db.get_balance( account_id_type(1), asset_id_type() ).amount.value );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( track_writes_test )
+{
+   try {
+      database db;
+      const auto& bal_obj1 = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 42;
+      });
+      const auto id1 = bal_obj1.id;
+      BOOST_CHECK( db.tracked_writes() == nullptr );
+
+      std::vector<object_id_type> written;
+      db.track_writes( &written );
+      BOOST_CHECK( db.tracked_writes() == &written );
+
+      const auto& bal_obj2 = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.owner = account_id_type(1);
+          obj.balance = 7;
+      });
+      const auto id2 = bal_obj2.id;
+      db.modify( bal_obj1, [&]( account_balance_object& obj ){ obj.balance = 43; } );
+      db.modify( bal_obj1, [&]( account_balance_object& obj ){ obj.balance = 44; } );
+      db.remove( bal_obj2 );
+
+      BOOST_REQUIRE_EQUAL( written.size(), 4u );
+      BOOST_CHECK( written[0] == id2 );
+      BOOST_CHECK( written[1] == id1 );
+      BOOST_CHECK( written[2] == id1 );
+      BOOST_CHECK( written[3] == id2 );
+
+      // reads are not recorded, and nothing is recorded once tracking stops
+      db.get<account_balance_object>( id1 );
+      db.track_writes( nullptr );
+      db.modify( db.get<account_balance_object>( id1 ), [&]( account_balance_object& obj ){ obj.balance = 45; } );
+      BOOST_CHECK_EQUAL( written.size(), 4u );
+      BOOST_CHECK( db.tracked_writes() == nullptr );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( undo_history_stats_test )
+{
+   try {
+      database db;
+      db._undo_db.set_max_size( 100 );
+      const auto& bal_obj = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 0;
+      });
+      for( int64_t i = 1; i <= 8; ++i )
+      {
+         auto session = db._undo_db.start_undo_session();
+         db.modify( bal_obj, [i]( account_balance_object& obj ){ obj.balance = i; } );
+         session.commit();
+      }
+
+      const auto before = db._undo_db.get_stats();
+      BOOST_CHECK_EQUAL( before.depth, 8u );
+      BOOST_CHECK_EQUAL( before.max_depth, 100u );
+      BOOST_CHECK_GT( before.bytes, 0u );
+      BOOST_CHECK_EQUAL( before.bytes, db._undo_db.memory_usage() );
+
+      // the oldest states beyond the maximum size are dropped when the next session starts, with their memory
+      db._undo_db.set_max_size( 5 );
+      db._undo_db.start_undo_session().undo();
+
+      const auto after = db._undo_db.get_stats();
+      BOOST_CHECK_EQUAL( after.depth, 5u );
+      BOOST_CHECK_EQUAL( after.max_depth, 5u );
+      BOOST_CHECK_LT( after.bytes, before.bytes );
+
+      // the remaining states can still be undone, which frees their memory
+      for( int i = 0; i < 5; ++i )
+         db._undo_db.pop_commit();
+      BOOST_CHECK_EQUAL( 3, db.get_balance( account_id_type(), asset_id_type() ).amount.value );
+      BOOST_CHECK_THROW( db._undo_db.pop_commit(), fc::exception );
+      BOOST_CHECK_EQUAL( db._undo_db.memory_usage(), 0u );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( direct_index_test )
 { try {
    try {
@@ -311,4 +439,37 @@ BOOST_AUTO_TEST_CASE( required_approval_index_test ) // see https://github.com/b
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( notified_object_variants_are_shared )
+{ try {
+   generate_block();
+
+   vector<fc::variant> received;
+   auto receiver = [this,&received]( const vector<object_id_type>& ids, const flat_set<account_id_type>& ) {
+      for( const auto& id : ids )
+      {
+         if( id == dynamic_global_property_id_type() )
+            received.push_back( db.get_notified_object_variant( db.get_object( id ) ) );
+      }
+   };
+   boost::signals2::scoped_connection first = db.changed_objects.connect( receiver );
+   boost::signals2::scoped_connection second = db.changed_objects.connect( receiver );
+
+   const auto stats_before = db.get_object_notification_stats();
+   generate_block();
+   const auto& stats = db.get_object_notification_stats();
+
+   // Both receivers got the same variant, but the object was only converted once
+   BOOST_REQUIRE_EQUAL( received.size(), 2u );
+   BOOST_CHECK_EQUAL( fc::json::to_string( received[0] ), fc::json::to_string( received[1] ) );
+   BOOST_CHECK_EQUAL( received[0]["head_block_number"].as_uint64(), db.head_block_num() );
+   BOOST_CHECK_GE( stats.notifications, stats_before.notifications + 1 );
+   BOOST_CHECK_EQUAL( stats.conversions - stats_before.conversions, 1u );
+   BOOST_CHECK_EQUAL( stats.cache_hits - stats_before.cache_hits, 1u );
+
+   // Outside of the signals objects are converted every time
+   db.get_notified_object_variant( db.get_dynamic_global_properties() );
+   BOOST_CHECK_EQUAL( db.get_object_notification_stats().conversions, stats.conversions );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -116,6 +116,214 @@ BOOST_AUTO_TEST_CASE(get_account_history) {
    }
 }
 
+BOOST_AUTO_TEST_CASE(history_on_disk) {
+   try {
+      graphene::app::history_api hist_api(app);
+
+      //account_id_type() do 3 ops
+      create_bitasset("USD", account_id_type());
+      const auto& dan = create_account( "dan", account_id_type()(db), GRAPHENE_WITNESS_ACCOUNT(db) );
+      create_account( "bob", account_id_type()(db), GRAPHENE_TEMP_ACCOUNT(db) );
+      const account_id_type dan_id = dan.get_id();
+      generate_block();
+
+      int account_create_op_id = operation::tag<account_create_operation>::value;
+      int transfer_op_id = operation::tag<transfer_operation>::value;
+
+      // nothing is kept in the object database
+      BOOST_CHECK( db.get_index_type<account_history_index>().indices().empty() );
+
+      vector<operation_history_object> histories = hist_api.get_account_history("1.2.0", operation_history_id_type(),
+                                                      100, operation_history_id_type());
+      BOOST_REQUIRE_EQUAL(histories.size(), 3u);
+      BOOST_CHECK_EQUAL(histories[2].id.instance(), 0u);
+      BOOST_CHECK( histories[2].block_time == db.head_block_time() );
+
+      histories = hist_api.get_account_history("1.2.0", operation_history_id_type(1),
+                                                      100, operation_history_id_type());
+      BOOST_REQUIRE_EQUAL(histories.size(), 1u);
+      BOOST_CHECK_EQUAL(histories[0].op.which(), account_create_op_id);
+
+      histories = hist_api.get_account_history_operations("1.2.0", account_create_op_id,
+                                                          operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_CHECK_EQUAL(histories.size(), 2u);
+
+      histories = hist_api.get_relative_account_history("1.2.0", 0, 100, 0);
+      BOOST_CHECK_EQUAL(histories.size(), 3u);
+
+      histories = hist_api.get_account_history("bob", operation_history_id_type(),
+                                                      100, operation_history_id_type());
+      BOOST_CHECK_EQUAL(histories.size(), 1u);
+
+      // blocks applied again after popping are not stored twice
+      db.pop_block();
+      generate_block();
+      generate_block();
+      histories = hist_api.get_account_history("1.2.0", operation_history_id_type(),
+                                                      100, operation_history_id_type());
+      BOOST_CHECK_EQUAL(histories.size(), 3u);
+
+      // long histories are searched by sequence number and by operation ID
+      for( int i = 0; i < 50; ++i )
+      {
+         transfer( account_id_type(), dan_id, asset(1) );
+         if( i % 10 == 0 )
+            generate_block();
+      }
+      generate_block();
+
+      const auto all = hist_api.get_relative_account_history("dan", 0, 100, 0);
+      BOOST_REQUIRE_EQUAL(all.size(), 51u);
+      BOOST_CHECK_EQUAL(all.back().op.which(), account_create_op_id);
+      BOOST_CHECK_EQUAL(all.front().op.which(), transfer_op_id);
+      for( size_t i = 1; i < all.size(); ++i )
+         BOOST_CHECK( all[i].id < all[i-1].id );
+
+      histories = hist_api.get_relative_account_history("dan", 7, 5, 13);
+      BOOST_REQUIRE_EQUAL(histories.size(), 5u);
+      for( size_t i = 0; i < histories.size(); ++i )
+         BOOST_CHECK( histories[i].id == all[all.size() - 13 + i].id );
+
+      histories = hist_api.get_account_history("dan", all[30].id, 100, all[20].id);
+      BOOST_REQUIRE_EQUAL(histories.size(), 10u);
+      BOOST_CHECK( histories.front().id == all[20].id );
+      BOOST_CHECK( histories.back().id == all[29].id );
+
+      histories = hist_api.get_account_history_operations("dan", transfer_op_id, all[40].id,
+                                                          operation_history_id_type(), 100);
+      BOOST_CHECK_EQUAL(histories.size(), 10u);
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(history_by_operation_index) {
+   try {
+      graphene::app::history_api hist_api(app);
+
+      create_bitasset("USD", account_id_type());
+      const account_id_type dan_id = create_account("dan").get_id();
+      generate_block();
+
+      int account_create_op_id = operation::tag<account_create_operation>::value;
+      int transfer_op_id = operation::tag<transfer_operation>::value;
+
+      for( int i = 0; i < 30; ++i )
+      {
+         transfer( account_id_type(), dan_id, asset(1) );
+         if( i % 3 == 0 )
+            create_account( "tmp" + std::to_string(i) );
+         if( i % 10 == 0 )
+            generate_block();
+      }
+      generate_block();
+
+      const auto transfers = hist_api.get_account_history_operations("committee-account", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_REQUIRE_EQUAL(transfers.size(), 30u);
+      for( size_t i = 0; i < transfers.size(); ++i )
+      {
+         BOOST_CHECK_EQUAL(transfers[i].op.which(), transfer_op_id);
+         if( i > 0 )
+            BOOST_CHECK( transfers[i].id < transfers[i-1].id );
+      }
+
+      auto histories = hist_api.get_account_history_operations("committee-account", account_create_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_CHECK_EQUAL(histories.size(), 11u);
+
+      histories = hist_api.get_account_history_operations("committee-account", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 5);
+      BOOST_REQUIRE_EQUAL(histories.size(), 5u);
+      BOOST_CHECK( histories.back().id == transfers[4].id );
+
+      histories = hist_api.get_account_history_operations("committee-account", transfer_op_id,
+                                                transfers[10].id, operation_history_id_type(), 100);
+      BOOST_REQUIRE_EQUAL(histories.size(), 20u);
+      BOOST_CHECK( histories.front().id == transfers[10].id );
+
+      histories = hist_api.get_account_history_operations("committee-account", transfer_op_id,
+                                                operation_history_id_type(), transfers[20].id, 100);
+      BOOST_REQUIRE_EQUAL(histories.size(), 20u);
+      BOOST_CHECK( histories.back().id == transfers[19].id );
+
+      // the window of get_account_history_by_operations is the same as without the index
+      flat_set<uint16_t> operation_types = { static_cast<uint16_t>(transfer_op_id) };
+      const auto window = hist_api.get_relative_account_history("committee-account", 5, 20, 24);
+      const auto by_operations = hist_api.get_account_history_by_operations("committee-account",
+                                                                            operation_types, 5, 20);
+      BOOST_CHECK_EQUAL(by_operations.total_count, window.size());
+      vector<operation_history_object> expected;
+      std::copy_if( window.begin(), window.end(), std::back_inserter(expected),
+                    [transfer_op_id]( const operation_history_object& o ) { return o.op.which() == transfer_op_id; } );
+      BOOST_REQUIRE_EQUAL(by_operations.operation_history_objs.size(), expected.size());
+      for( size_t i = 0; i < expected.size(); ++i )
+         BOOST_CHECK( by_operations.operation_history_objs[i].id == expected[i].id );
+
+      // entries of popped blocks are removed from the index
+      for( int i = 0; i < 3; ++i )
+         transfer( account_id_type(), dan_id, asset(1) );
+      generate_block();
+      histories = hist_api.get_account_history_operations("dan", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_CHECK_EQUAL(histories.size(), 33u);
+      db.pop_block();
+      histories = hist_api.get_account_history_operations("dan", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_CHECK_EQUAL(histories.size(), 30u);
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(history_by_operation_index_undo) {
+   try {
+      graphene::app::history_api hist_api(app);
+
+      const account_id_type dan_id = create_account("dan").get_id();
+      generate_block();
+
+      int transfer_op_id = operation::tag<transfer_operation>::value;
+      flat_set<uint16_t> operation_types = { static_cast<uint16_t>(transfer_op_id) };
+
+      for( int i = 0; i < 3; ++i )
+         transfer( account_id_type(), dan_id, asset(1) );
+      generate_block();
+      const auto before = hist_api.get_account_history_operations("dan", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_REQUIRE_EQUAL(before.size(), 3u);
+
+      // a block which removes the oldest entries of dan, and their operations
+      for( int i = 0; i < 2; ++i )
+         transfer( account_id_type(), dan_id, asset(1) );
+      generate_block();
+      auto histories = hist_api.get_account_history_operations("dan", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_REQUIRE_EQUAL(histories.size(), 3u);
+      BOOST_CHECK( histories.back().id == before.front().id );
+      BOOST_CHECK( db.find( before.back().id ) == nullptr );
+
+      // undoing the block inserts the removed entries again, in no particular order with their operations
+      db.pop_block();
+      histories = hist_api.get_account_history_operations("dan", transfer_op_id,
+                                                operation_history_id_type(), operation_history_id_type(), 100);
+      BOOST_REQUIRE_EQUAL(histories.size(), before.size());
+      for( size_t i = 0; i < before.size(); ++i )
+         BOOST_CHECK( histories[i].id == before[i].id );
+
+      const auto by_operations = hist_api.get_account_history_by_operations("dan", operation_types, 0, 100);
+      BOOST_CHECK_EQUAL(by_operations.total_count, 3u);
+      BOOST_REQUIRE_EQUAL(by_operations.operation_history_objs.size(), before.size());
+      for( size_t i = 0; i < before.size(); ++i )
+         BOOST_CHECK( by_operations.operation_history_objs[i].id == before[i].id );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(get_account_history_virtual_operation_test)
 { try {
       graphene::app::history_api hist_api(app);
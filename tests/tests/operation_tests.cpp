@@ -3027,6 +3027,47 @@ BOOST_AUTO_TEST_CASE( uia_fees )
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( limit_order_book_index_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   const asset_object& usd = create_user_issued_asset( "USDBOOK" );
+   const asset_id_type usd_id = usd.get_id();
+   const asset_id_type core_id;
+   issue_uia( alice_id, asset( 1000000, usd_id ) );
+   fund( bob, asset( 1000000 ) );
+
+   const limit_order_book_index& books = db.get_limit_order_books();
+   BOOST_CHECK( books.get_book_side( usd_id, core_id ) == nullptr );
+
+   // two orders at the same price, one at a worse price
+   limit_order_id_type first = create_sell_order( alice_id, asset( 100, usd_id ), asset( 200 ) )->get_id();
+   limit_order_id_type second = create_sell_order( alice_id, asset( 50, usd_id ), asset( 100 ) )->get_id();
+   limit_order_id_type worse = create_sell_order( alice_id, asset( 100, usd_id ), asset( 300 ) )->get_id();
+
+   const auto* asks = books.get_book_side( usd_id, core_id );
+   BOOST_REQUIRE( asks != nullptr );
+   BOOST_REQUIRE_EQUAL( asks->size(), 2u );
+   BOOST_CHECK_EQUAL( asks->begin()->second.total_for_sale.value, 150 );
+   BOOST_REQUIRE_EQUAL( asks->begin()->second.orders.size(), 2u );
+   BOOST_CHECK( asks->begin()->second.orders.begin()->first == first );
+   BOOST_CHECK( books.get_best_order( usd_id, core_id )->get_id() == first );
+   BOOST_CHECK_EQUAL( asks->rbegin()->second.total_for_sale.value, 100 );
+
+   // a bid which fills the first order partially
+   BOOST_CHECK( create_sell_order( bob_id, asset( 100 ), asset( 50, usd_id ) ) == nullptr );
+   BOOST_CHECK( books.get_book_side( core_id, usd_id ) == nullptr );
+   BOOST_CHECK_EQUAL( asks->begin()->second.total_for_sale.value, 100 );
+   BOOST_CHECK_EQUAL( first(db).for_sale.value, 50 );
+
+   // removed orders leave the book, empty levels are dropped
+   cancel_limit_order( first(db) );
+   cancel_limit_order( second(db) );
+   BOOST_REQUIRE_EQUAL( asks->size(), 1u );
+   BOOST_CHECK( books.get_best_order( usd_id, core_id )->get_id() == worse );
+   cancel_limit_order( worse(db) );
+   BOOST_CHECK( books.get_book_side( usd_id, core_id ) == nullptr );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( cancel_limit_order_test )
 { try {
 
@@ -1,4 +1,5 @@
 
+#include <fstream>
 #include <memory>
 #include <thread>
 #include <iostream>
@@ -7,13 +8,20 @@
 
 #include <fc/thread/thread.hpp>
 #include <fc/asio.hpp>
+#include <fc/network/tcp_socket.hpp>
 #include <fc/filesystem.hpp>
 #include <fc/time.hpp>
 
+#include <graphene/net/message_decoder.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_connection.hpp>
+#include <graphene/net/peer_database.hpp>
 #include <graphene/utilities/tempdir.hpp>
 
+#include <fc/io/json.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/raw.hpp>
 
 #include <fc/log/appender.hpp>
@@ -38,8 +46,9 @@ public:
    {
    }
    void on_message( graphene::net::peer_connection* originating_peer,
-         const graphene::net::message& received_message ) override
+         const graphene::net::decoded_message& decoded ) override
    {
+      const graphene::net::message& received_message = decoded.msg;
       ilog( "on_message was called with ${msg}", ("msg",received_message) );
       try {
          graphene::net::address_request_message m = received_message.as< graphene::net::address_request_message >();
@@ -120,6 +129,25 @@ public:
    }
 };
 
+/***
+ * Collects the messages received by a message_oriented_connection
+ */
+class collecting_connection_delegate : public graphene::net::message_oriented_connection_delegate
+{
+public:
+   void on_message( graphene::net::message_oriented_connection* originating_connection,
+         graphene::net::message&& received_message ) override
+   {
+      messages_received.push_back( std::move( received_message ) );
+   }
+   void on_connection_closed( graphene::net::message_oriented_connection* originating_connection ) override
+   {
+      connection_closed = true;
+   }
+   std::vector<graphene::net::message> messages_received;
+   bool connection_closed = false;
+};
+
 static void test_closing_connection_message( const graphene::net::message& msg )
 {
    BOOST_REQUIRE( msg.msg_type.value() == graphene::net::closing_connection_message::type );
@@ -158,7 +186,10 @@ public:
    bool has_item( const graphene::net::item_id& id ) { return false; }
    bool handle_block( const graphene::net::block_message& blk_msg, bool sync_mode,
          std::vector<fc::uint160_t>& contained_transaction_message_ids )
-      { return false; }
+   {
+      blocks_handled.push_back( blk_msg.block_id );
+      return false;
+   }
    void handle_transaction( const graphene::net::trx_message& trx_msg )
    {
       ilog( "${name} was asked to handle a transaction", ("name", node_name) );
@@ -222,12 +253,14 @@ public:
       ilog( "${name} get_current_block_interval_in_seconds was called", ("name",node_name) );
       return 0;
    }
+   std::vector<graphene::net::block_id_type> blocks_handled;
 };
 
 class test_node : public graphene::net::node
 {
 public:
    std::vector<std::shared_ptr<test_peer>> test_peers;
+   std::shared_ptr<test_node_delegate> node_delegate;
 
    test_node( const std::string& name, const fc::path& config_dir, int port, int seed_port = -1 )
          : node( name )
@@ -235,7 +268,8 @@ public:
       std::cout << "test_node::test_node(): current thread=" << uint64_t(&fc::thread::current()) << std::endl;
       node_name = name;
       load_configuration( config_dir );
-      set_node_delegate( std::make_shared<test_node_delegate>( name ) );
+      node_delegate = std::make_shared<test_node_delegate>( name );
+      set_node_delegate( node_delegate );
    }
    ~test_node()
    {
@@ -259,6 +293,16 @@ public:
       return my->_node_id;
    }
 
+   size_t sync_request_size( const graphene::net::peer_connection_ptr& peer )
+   {
+      return my->get_thread()->async( [&]() { return my->sync_request_size( *peer ); } ).wait();
+   }
+
+   bool can_request_more_sync_items( const graphene::net::peer_connection_ptr& peer )
+   {
+      return my->get_thread()->async( [&]() { return my->can_request_more_sync_items( *peer ); } ).wait();
+   }
+
    void start_fake_network_connect_loop()
    {
       this->my->get_thread()->async( [&]() {
@@ -276,7 +320,8 @@ public:
                     const graphene::net::message& received_message )
    {
       my->get_thread()->async( [&]() {
-         my->on_message( originating_peer.get(), received_message );
+         my->on_message( originating_peer.get(),
+                         graphene::net::decode_message( graphene::net::message( received_message ) ) );
       }).wait();
    }
 
@@ -980,4 +1025,423 @@ BOOST_AUTO_TEST_CASE( advertising_all_test )
    test_closing_connection_message( msg2 );
 }
 
+/****
+ * Received block and transaction messages are unpacked and hashed before they reach the node,
+ * large ones on the worker threads
+ */
+BOOST_AUTO_TEST_CASE( decode_received_messages )
+{ try {
+   graphene::protocol::signed_transaction trx;
+   trx.operations.push_back( graphene::protocol::transfer_operation() );
+   graphene::net::message small_trx_msg = graphene::net::trx_message( trx );
+   const graphene::protocol::transaction_id_type trx_id = trx.id();
+   BOOST_REQUIRE_LT( small_trx_msg.size.value(), GRAPHENE_NET_MIN_BYTES_TO_DECODE_IN_PARALLEL );
+
+   graphene::protocol::signed_block blk;
+   blk.timestamp = fc::time_point_sec( 1000 );
+   for( int i = 0; i < 100; ++i )
+      trx.operations.push_back( graphene::protocol::transfer_operation() );
+   blk.transactions.emplace_back( trx );
+   graphene::net::message block_msg = graphene::net::block_message( blk );
+   BOOST_REQUIRE_GE( block_msg.size.value(), GRAPHENE_NET_MIN_BYTES_TO_DECODE_IN_PARALLEL );
+
+   const auto decoded_before = graphene::net::get_inbound_pipeline_stats().decode.processed;
+
+   graphene::net::decoded_message decoded_trx = graphene::net::decode_message( graphene::net::message( small_trx_msg ) );
+   BOOST_CHECK( decoded_trx.hash == small_trx_msg.id() );
+   BOOST_REQUIRE( decoded_trx.trx.valid() );
+   BOOST_CHECK( decoded_trx.trx->trx.id() == trx_id );
+   BOOST_CHECK( !decoded_trx.block.valid() );
+
+   graphene::net::decoded_message decoded_block = graphene::net::decode_message( graphene::net::message( block_msg ) );
+   BOOST_CHECK( decoded_block.hash == block_msg.id() );
+   BOOST_CHECK( decoded_block.msg.data == block_msg.data );
+   BOOST_REQUIRE( decoded_block.block.valid() );
+   BOOST_CHECK( decoded_block.block->block_id == blk.id() );
+   BOOST_CHECK( decoded_block.block->block.id() == blk.id() );
+   BOOST_CHECK_EQUAL( decoded_block.block->block.transactions.size(), 1U );
+
+   // only the block message was large enough to be decoded on the worker threads
+   const auto stats = graphene::net::get_inbound_pipeline_stats();
+   BOOST_CHECK_EQUAL( stats.decode.processed, decoded_before + 1 );
+   BOOST_CHECK_EQUAL( stats.decode.queue_depth, 0U );
+   BOOST_CHECK_EQUAL( stats.dispatch.queue_depth, 0U );
+
+   // messages which can not be unpacked are rejected
+   graphene::net::message broken_msg = block_msg;
+   broken_msg.data.resize( broken_msg.data.size() / 2 );
+   broken_msg.size = (uint32_t)broken_msg.data.size();
+   BOOST_CHECK_THROW( graphene::net::decode_message( std::move( broken_msg ) ), fc::exception );
+} FC_CAPTURE_LOG_AND_RETHROW( (0) ) }
+
+/****
+ * During sync, the number of blocks requested from a peer at a time follows its throughput,
+ * and it is asked for more before it has sent all of them
+ */
+BOOST_AUTO_TEST_CASE( sync_requests_follow_peer_throughput )
+{ try {
+   int node1_port = fc::network::get_available_port();
+   fc::temp_directory node1_dir( graphene::utilities::temp_directory_path() );
+   test_node node1( "Node1", node1_dir.path(), node1_port );
+
+   std::pair<std::shared_ptr<test_delegate>, std::shared_ptr<test_peer>> peer3
+         = node1.create_test_peer( "1.2.3.4:5678" );
+   std::shared_ptr<test_peer> peer3_ptr = peer3.second;
+
+   // nothing is known about the peer yet
+   BOOST_CHECK_EQUAL( node1.sync_request_size( peer3_ptr ), GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+
+   peer3_ptr->sync_block_interval = fc::milliseconds( 100 );
+   const size_t blocks_per_request = GRAPHENE_NET_SYNC_REQUEST_DURATION_SEC * 10;
+   BOOST_CHECK_EQUAL( node1.sync_request_size( peer3_ptr ), blocks_per_request );
+
+   peer3_ptr->sync_block_interval = fc::microseconds( 1 );
+   BOOST_CHECK_EQUAL( node1.sync_request_size( peer3_ptr ), GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING );
+
+   peer3_ptr->sync_block_interval = fc::seconds( 60 );
+   BOOST_CHECK_EQUAL( node1.sync_request_size( peer3_ptr ), GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+
+   // more blocks are requested once no more than half of them are outstanding
+   peer3_ptr->sync_block_interval = fc::milliseconds( 100 );
+   for( size_t i = 0; i <= blocks_per_request / 2; ++i )
+      peer3_ptr->sync_items_requested_from_peer.insert( fc::ripemd160::hash( std::to_string( i ) ) );
+   BOOST_CHECK( !node1.can_request_more_sync_items( peer3_ptr ) );
+   peer3_ptr->sync_items_requested_from_peer.erase( peer3_ptr->sync_items_requested_from_peer.begin() );
+   BOOST_CHECK( node1.can_request_more_sync_items( peer3_ptr ) );
+
+   // but not while it should send us more block IDs first
+   peer3_ptr->number_of_unfetched_item_ids = 1;
+   BOOST_CHECK( !node1.can_request_more_sync_items( peer3_ptr ) );
+   peer3_ptr->sync_items_requested_from_peer.clear();
+   BOOST_CHECK( node1.can_request_more_sync_items( peer3_ptr ) );
+} FC_CAPTURE_LOG_AND_RETHROW( (0) ) }
+
+/****
+ * Messages sent in batches over the encrypted connection arrive intact and in order, whatever their
+ * sizes, and a batch may be larger than the chunks the socket encrypts at a time
+ */
+BOOST_AUTO_TEST_CASE( batched_messages_round_trip )
+{ try {
+   collecting_connection_delegate server_delegate;
+   collecting_connection_delegate client_delegate;
+   graphene::net::message_oriented_connection server_connection( &server_delegate );
+   graphene::net::message_oriented_connection client_connection( &client_delegate );
+
+   fc::tcp_server server;
+   server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), fc::network::get_available_port() ) );
+   fc::future<void> accepted = fc::async( [&server,&server_connection]() {
+      server.accept( server_connection.get_socket() );
+      server_connection.accept();
+   }, "accept test connection" );
+   client_connection.connect_to( server.get_local_endpoint() );
+   accepted.wait();
+
+   // sizes around the 16 byte padding of the messages and the chunk size of the socket
+   const std::vector<size_t> sizes = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 1000,
+                                       graphene::net::stcp_socket::max_chunk_size - 3,
+                                       graphene::net::stcp_socket::max_chunk_size + 5,
+                                       3 * GRAPHENE_NET_MAX_SEND_BATCH_SIZE + 1, 5 };
+   std::vector<graphene::net::message> messages;
+   uint64_t expected_bytes = 0;
+   for( size_t i = 0; i < sizes.size(); ++i )
+   {
+      graphene::net::message m;
+      m.msg_type = static_cast<uint32_t>( 1000 + i );
+      m.data.resize( sizes[i] );
+      for( size_t j = 0; j < sizes[i]; ++j )
+         m.data[j] = static_cast<char>( i * 31 + j * 7 );
+      m.size = static_cast<uint32_t>( sizes[i] );
+      expected_bytes += 16 * ( ( sizeof( graphene::net::message_header ) + sizes[i] + 15 ) / 16 );
+      messages.push_back( std::move( m ) );
+   }
+
+   // several batches and a single message in between
+   const auto first_batch_end = messages.begin() + 6;
+   client_connection.send_messages( std::vector<graphene::net::message>( messages.begin(), first_batch_end ) );
+   client_connection.send_message( *first_batch_end );
+   client_connection.send_messages( std::vector<graphene::net::message>( first_batch_end + 1, messages.end() ) );
+
+   for( int i = 0; i < 1000 && server_delegate.messages_received.size() < messages.size(); ++i )
+      fc::usleep( fc::milliseconds( 10 ) );
+
+   BOOST_REQUIRE_EQUAL( server_delegate.messages_received.size(), messages.size() );
+   for( size_t i = 0; i < messages.size(); ++i )
+   {
+      const graphene::net::message& received = server_delegate.messages_received[i];
+      BOOST_CHECK_EQUAL( received.msg_type.value(), messages[i].msg_type.value() );
+      BOOST_CHECK_EQUAL( received.size.value(), messages[i].size.value() );
+      BOOST_CHECK( received.data == messages[i].data );
+   }
+   BOOST_CHECK_EQUAL( client_connection.get_total_bytes_sent(), expected_bytes );
+   BOOST_CHECK_EQUAL( server_connection.get_total_bytes_received(), expected_bytes );
+   BOOST_CHECK( client_delegate.messages_received.empty() );
+
+   client_connection.close_connection();
+   server.close();
+} FC_CAPTURE_LOG_AND_RETHROW( (0) ) }
+
+/****
+ * Blocks received as compact blocks are reassembled from the transactions we have and the ones fetched from
+ * the peer, and only accepted if we asked the peer for them
+ */
+BOOST_AUTO_TEST_CASE( compact_block_reassembly )
+{ try {
+   int node1_port = fc::network::get_available_port();
+   fc::temp_directory node1_dir( graphene::utilities::temp_directory_path() );
+   test_node node1( "Node1", node1_dir.path(), node1_port );
+
+   std::pair<std::shared_ptr<test_delegate>, std::shared_ptr<test_peer>> peer3
+         = node1.create_test_peer( "1.2.3.4:5678" );
+   std::shared_ptr<test_peer> peer3_ptr = peer3.second;
+   const auto& blocks_handled = node1.node_delegate->blocks_handled;
+
+   std::vector<graphene::protocol::signed_transaction> trxs( 3 );
+   for( uint32_t i = 0; i < trxs.size(); ++i )
+   {
+      trxs[i].expiration = fc::time_point_sec( 1000 + i );
+      trxs[i].operations.push_back( graphene::protocol::transfer_operation() );
+   }
+   // node1 knows the first two transactions
+   node1.broadcast( graphene::net::trx_message( trxs[0] ) );
+   node1.broadcast( graphene::net::trx_message( trxs[1] ) );
+
+   uint32_t block_count = 0;
+   const auto make_block = [&block_count]( const std::vector<graphene::protocol::signed_transaction>& block_trxs ) {
+      graphene::protocol::signed_block blk;
+      blk.timestamp = fc::time_point_sec( 1000 + 3 * (++block_count) );
+      for( const auto& trx : block_trxs )
+         blk.transactions.emplace_back( trx );
+      blk.transaction_merkle_root = blk.calculate_merkle_root();
+      return blk;
+   };
+   const auto request_block = [&peer3_ptr]( const graphene::protocol::signed_block& blk ) {
+      const graphene::net::item_hash_t item_hash = graphene::net::message( graphene::net::block_message( blk ) ).id();
+      peer3_ptr->items_requested_from_peer[ graphene::net::item_id( graphene::net::block_message_type, item_hash ) ]
+            = fc::time_point::now();
+      return item_hash;
+   };
+   const auto reply_transactions = [&]( const graphene::protocol::signed_block& blk,
+                                        const std::vector<graphene::protocol::signed_transaction>& block_trxs ) {
+      graphene::net::compact_block_transactions_message reply;
+      reply.block_id = blk.id();
+      for( const auto& trx : block_trxs )
+         reply.transactions.emplace_back( trx );
+      node1.on_message( peer3_ptr, reply );
+   };
+
+   // all transactions are found by their short IDs
+   {
+      const auto blk = make_block( { trxs[0], trxs[1] } );
+      node1.on_message( peer3_ptr, graphene::net::compact_block_message( blk, request_block( blk ) ) );
+      BOOST_REQUIRE_EQUAL( blocks_handled.size(), 1U );
+      BOOST_CHECK( blocks_handled.back() == blk.id() );
+      BOOST_CHECK( peer3_ptr->messages_received.empty() );
+      BOOST_CHECK( peer3_ptr->items_requested_from_peer.empty() );
+   }
+
+   // a missing transaction is fetched from the peer
+   {
+      const auto blk = make_block( { trxs[0], trxs[2] } );
+      node1.on_message( peer3_ptr, graphene::net::compact_block_message( blk, request_block( blk ) ) );
+      BOOST_CHECK_EQUAL( blocks_handled.size(), 1U );
+      BOOST_REQUIRE_EQUAL( peer3_ptr->messages_received.size(), 1U );
+      const auto& fetch_msg = peer3_ptr->messages_received.back();
+      BOOST_REQUIRE( fetch_msg.msg_type.value() == graphene::net::fetch_compact_block_transactions_message::type );
+      const auto fetch = fetch_msg.as<graphene::net::fetch_compact_block_transactions_message>();
+      BOOST_CHECK( fetch.block_id == blk.id() );
+      BOOST_CHECK( fetch.transaction_indexes == std::vector<uint32_t>{ 1 } );
+
+      reply_transactions( blk, { trxs[2] } );
+      BOOST_REQUIRE_EQUAL( blocks_handled.size(), 2U );
+      BOOST_CHECK( blocks_handled.back() == blk.id() );
+      BOOST_CHECK( peer3_ptr->compact_blocks_in_progress.empty() );
+   }
+
+   // the transaction we have is signed differently than the one in the block, all of them are fetched
+   {
+      graphene::protocol::signed_transaction signed_trx = trxs[1];
+      signed_trx.signatures.push_back( fc::ecc::compact_signature() );
+      BOOST_REQUIRE( signed_trx.id() == trxs[1].id() );
+      const auto blk = make_block( { trxs[0], signed_trx } );
+      peer3_ptr->messages_received.clear();
+      node1.on_message( peer3_ptr, graphene::net::compact_block_message( blk, request_block( blk ) ) );
+      BOOST_CHECK_EQUAL( blocks_handled.size(), 2U );
+      BOOST_REQUIRE_EQUAL( peer3_ptr->messages_received.size(), 1U );
+      const auto fetch = peer3_ptr->messages_received.back()
+                                   .as<graphene::net::fetch_compact_block_transactions_message>();
+      BOOST_CHECK( fetch.transaction_indexes == std::vector<uint32_t>( { 0, 1 } ) );
+
+      reply_transactions( blk, { trxs[0], signed_trx } );
+      BOOST_REQUIRE_EQUAL( blocks_handled.size(), 3U );
+      BOOST_CHECK( blocks_handled.back() == blk.id() );
+   }
+
+   // the peer does not have the block any more, it is dropped without disconnecting
+   {
+      const auto blk = make_block( { trxs[2] } );
+      const auto item_hash = request_block( blk );
+      peer3_ptr->messages_received.clear();
+      node1.on_message( peer3_ptr, graphene::net::compact_block_message( blk, item_hash ) );
+      BOOST_REQUIRE_EQUAL( peer3_ptr->messages_received.size(), 1U );
+
+      reply_transactions( blk, {} );
+      BOOST_CHECK_EQUAL( blocks_handled.size(), 3U );
+      BOOST_CHECK( peer3_ptr->compact_blocks_in_progress.empty() );
+      BOOST_CHECK( peer3_ptr->items_requested_from_peer.find(
+                         graphene::net::item_id( graphene::net::block_message_type, item_hash ) )
+                   == peer3_ptr->items_requested_from_peer.end() );
+      BOOST_CHECK_EQUAL( peer3_ptr->messages_received.size(), 1U );
+      BOOST_CHECK( !peer3_ptr->we_have_requested_close );
+   }
+
+   // a block which was not requested is rejected, even while another one is
+   {
+      const auto requested_blk = make_block( { trxs[0] } );
+      request_block( requested_blk );
+      const auto blk = make_block( { trxs[1] } );
+      peer3_ptr->messages_received.clear();
+      node1.on_message( peer3_ptr, graphene::net::compact_block_message( blk,
+                                         graphene::net::message( graphene::net::block_message( blk ) ).id() ) );
+      BOOST_CHECK_EQUAL( blocks_handled.size(), 3U );
+      BOOST_CHECK( peer3_ptr->compact_blocks_in_progress.empty() );
+      BOOST_REQUIRE_EQUAL( peer3_ptr->messages_received.size(), 1U );
+      test_closing_connection_message( peer3_ptr->messages_received.back() );
+   }
+} FC_CAPTURE_LOG_AND_RETHROW( (0) ) }
+
+/****
+ * The peer database keeps every update in its file as it happens, survives an unclean stop,
+ * and converts the JSON file of older versions
+ */
+BOOST_AUTO_TEST_CASE( peer_database_incremental_persistence )
+{ try {
+   fc::temp_directory db_dir( graphene::utilities::temp_directory_path() );
+   const fc::path db_file = db_dir.path() / "peers.dat";
+   const fc::time_point_sec now( fc::time_point::now() );
+   const auto make_record = [&now]( uint32_t i ) {
+      return graphene::net::potential_peer_record( fc::ip::endpoint( fc::ip::address( 0x0a000000 + i ), 1776 ),
+                                                   fc::time_point_sec( now.sec_since_epoch() - i ) );
+   };
+
+   {
+      graphene::net::peer_database db;
+      db.open( db_file );
+      for( uint32_t i = 0; i < 10; ++i )
+         db.update_entry( make_record( i ) );
+      graphene::net::potential_peer_record updated = make_record( 3 );
+      updated.number_of_successful_connection_attempts = 7;
+      db.update_entry( updated );
+      db.erase( make_record( 5 ).endpoint );
+      // not closed, as if the node crashed
+      graphene::net::peer_database reopened;
+      reopened.open( db_file );
+      BOOST_CHECK_EQUAL( reopened.size(), 9u );
+      BOOST_REQUIRE( reopened.lookup_entry_for_endpoint( make_record( 3 ).endpoint ) );
+      BOOST_CHECK_EQUAL( reopened.lookup_entry_for_endpoint( make_record( 3 ).endpoint )
+                                 ->number_of_successful_connection_attempts, 7u );
+      BOOST_CHECK( !reopened.lookup_entry_for_endpoint( make_record( 5 ).endpoint ) );
+      reopened.close();
+   }
+
+   // a record only partially written is ignored, the ones before it are kept
+   {
+      std::ofstream out( db_file.generic_string(), std::ios::binary | std::ios::app );
+      const char torn[] = { 100, 0, 0, 0, 1, 2 };
+      out.write( torn, sizeof( torn ) );
+   }
+   {
+      graphene::net::peer_database db;
+      db.open( db_file );
+      BOOST_CHECK_EQUAL( db.size(), 9u );
+      db.update_entry( make_record( 5 ) );
+      db.close();
+      db.open( db_file );
+      BOOST_CHECK_EQUAL( db.size(), 10u );
+
+      // only the most recently seen peers are kept when the database is closed
+      db.set_maximum_size( 4 );
+      db.close();
+      db.open( db_file );
+      BOOST_CHECK_EQUAL( db.size(), 4u );
+      BOOST_CHECK( db.lookup_entry_for_endpoint( make_record( 3 ).endpoint ) );
+      BOOST_CHECK( !db.lookup_entry_for_endpoint( make_record( 4 ).endpoint ) );
+      db.close();
+   }
+
+   // the JSON file of older versions is converted
+   const fc::path legacy_file = db_dir.path() / "legacy";
+   std::vector<graphene::net::potential_peer_record> legacy_records = { make_record( 20 ), make_record( 21 ) };
+   fc::json::save_to_file( legacy_records, legacy_file );
+   {
+      graphene::net::peer_database db;
+      db.open( legacy_file );
+      BOOST_CHECK_EQUAL( db.size(), 2u );
+      db.erase( make_record( 20 ).endpoint );
+   }
+   {
+      graphene::net::peer_database db;
+      db.open( legacy_file );
+      BOOST_CHECK_EQUAL( db.size(), 1u );
+      BOOST_CHECK( db.lookup_entry_for_endpoint( make_record( 21 ).endpoint ) );
+   }
+} FC_CAPTURE_LOG_AND_RETHROW( (0) ) }
+
+/****
+ * A peer database file which has grown too large without being closed is compacted when it is opened
+ */
+BOOST_AUTO_TEST_CASE( peer_database_compacted_on_open )
+{ try {
+   fc::temp_directory db_dir( graphene::utilities::temp_directory_path() );
+   const fc::path db_file = db_dir.path() / "peers.dat";
+   const fc::path empty_file = db_dir.path() / "empty.dat";
+   const fc::time_point_sec now( fc::time_point::now() );
+   const uint32_t peer_count = 10;
+
+   {
+      graphene::net::peer_database db;
+      db.open( empty_file );
+   }
+   const uint64_t header_size = fc::file_size( empty_file );
+
+   // the records of the peers, as written before the node crashed
+   std::string records;
+   {
+      graphene::net::peer_database db;
+      db.open( db_file );
+      for( uint32_t i = 0; i < peer_count; ++i )
+         db.update_entry( graphene::net::potential_peer_record(
+               fc::ip::endpoint( fc::ip::address( 0x0a000000 + i ), 1776 ), now ) );
+      std::string contents;
+      fc::read_file_contents( db_file, contents );
+      records = contents.substr( header_size );
+   }
+   const uint64_t compacted_size = header_size + records.size();
+   BOOST_REQUIRE_EQUAL( fc::file_size( db_file ), compacted_size );
+
+   // the same updates over and over again, by nodes which were never shut down cleanly
+   const auto append_records = [&db_file,&records]( uint32_t times ) {
+      std::ofstream out( db_file.generic_string(), std::ios::binary | std::ios::app );
+      for( uint32_t i = 0; i < times; ++i )
+         out.write( records.data(), records.size() );
+   };
+
+   // a few outdated records are kept
+   append_records( 5 );
+   {
+      graphene::net::peer_database db;
+      db.open( db_file );
+      BOOST_CHECK_EQUAL( db.size(), peer_count );
+   }
+   BOOST_CHECK_EQUAL( fc::file_size( db_file ), compacted_size + 5 * records.size() );
+
+   // many of them are not
+   append_records( GRAPHENE_NET_PEERDB_MIN_RECORDS_TO_COMPACT / peer_count );
+   {
+      graphene::net::peer_database db;
+      db.open( db_file );
+      BOOST_CHECK_EQUAL( db.size(), peer_count );
+   }
+   BOOST_CHECK_EQUAL( fc::file_size( db_file ), compacted_size );
+} FC_CAPTURE_LOG_AND_RETHROW( (0) ) }
+
 BOOST_AUTO_TEST_SUITE_END()
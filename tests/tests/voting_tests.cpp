@@ -6,6 +6,8 @@
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
 
+#include <fc/asio.hpp>
+
 #include <iostream>
 
 #include "../common/database_fixture.hpp"
@@ -959,4 +961,78 @@ BOOST_AUTO_TEST_CASE( committee_votes_calculation )
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( parallel_vote_tally )
+{ try {
+   // votes can be tallied in parallel after hard fork core-2262
+   generate_blocks( HARDFORK_CORE_2262_TIME );
+   generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+   set_expiration( db, trx );
+
+   vector<witness_id_type> wit_ids( db.get_global_properties().active_witnesses.begin(),
+                                    db.get_global_properties().active_witnesses.end() );
+
+   const auto push_operations = [this]() {
+      for( auto& op : trx.operations )
+         db.current_fee_schedule().set_fee( op );
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+   };
+
+   // enough voters to be split between several threads
+   const uint32_t num_voters = 600;
+   for( uint32_t i = 0; i < num_voters; ++i )
+   {
+      account_create_operation op = make_account( "voter" + fc::to_string(i) );
+      op.options.votes.insert( wit_ids[ i % wit_ids.size() ](db).vote_id );
+      trx.operations.push_back( op );
+      if( trx.operations.size() == 100 )
+         push_operations();
+   }
+   vector<account_id_type> voters;
+   for( uint32_t i = 0; i < num_voters; ++i )
+   {
+      voters.push_back( get_account( "voter" + fc::to_string(i) ).get_id() );
+      transfer_operation transfer_op;
+      transfer_op.from = committee_account;
+      transfer_op.to = voters.back();
+      transfer_op.amount = asset( 1000 * GRAPHENE_BLOCKCHAIN_PRECISION );
+      trx.operations.push_back( transfer_op );
+      trx.operations.push_back( make_ticket_create_op( voters.back(), lock_720_days,
+                                                       asset( 100 * GRAPHENE_BLOCKCHAIN_PRECISION + i ) ) );
+      if( trx.operations.size() == 100 )
+         push_operations();
+   }
+
+   // the last block applied performs the chain maintenance
+   generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+   const signed_block maint_block = *db.fetch_block_by_number( db.head_block_num() );
+
+   const auto get_results = [this,&wit_ids,&voters]() {
+      vector<uint64_t> results;
+      for( const auto& wit_id : wit_ids )
+         results.push_back( wit_id(db).total_votes );
+      for( const auto& voter : voters )
+      {
+         const auto& stats = voter(db).statistics(db);
+         results.push_back( stats.vp_all );
+         results.push_back( stats.vp_witness );
+      }
+      return results;
+   };
+   const auto parallel_results = get_results();
+   BOOST_CHECK_GE( db.get_chain_maintenance_stats().accounts, num_voters );
+   if( fc::asio::default_io_service_scope::get_num_threads() > 1 )
+      BOOST_CHECK_GT( db.get_chain_maintenance_stats().tally_threads, 1u );
+   BOOST_CHECK_GT( parallel_results.front(), 0u );
+
+   // apply the same block again with a serial tally
+   db.pop_block();
+   db.enable_parallel_vote_tally( false );
+   PUSH_BLOCK( db, maint_block, ~0 );
+   BOOST_CHECK_EQUAL( db.get_chain_maintenance_stats().tally_threads, 0u );
+   BOOST_CHECK( get_results() == parallel_results );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()